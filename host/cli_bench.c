@@ -0,0 +1,676 @@
+/**
+  ******************************************************************************
+  * @file    cli_bench.c
+  * @author  Katagiri
+  * @brief   Host tool keeping benchmark results of USB command line devices.
+  *          Runs benchmarks on a device (or a simulated device on a pty),
+  *          appends the results with the build ID of the firmware to a local
+  *          store, and compares them with a baseline build. Exits with 1 if
+  *          any result regressed, so it can gate each firmware build.
+  *
+  *          Build : cc -I.. -o cli_bench cli_bench.c -lm
+  *          Usage : cli_bench [-n runs] [-i iterations] [-b baseline build]
+  *                            [-s sigma] [-t tolerance %] <port> <store file>
+  *
+  *          Results measured (runs times each) :
+  *            kernel.<name>    BENCH <name> <iterations>, time per iteration
+  *            latency.rtt_us   round trip of a command from the host [us]
+  *            throughput.kBps  response bytes per time of HELP -n [kB/s]
+  *
+  *          Store : one line per result and run, never rewritten
+  *            <unix time> TAB <build ID> TAB <target> TAB <unit> TAB <pass|fail>
+  *              TAB <name> TAB <+|-> TAB <values...>
+  *          Target and unit are reported by BENCH (e.g. "stm32f4" "cyc" of a
+  *          device, "host" "ns" of cli_sim), results of another target or unit
+  *          are never compared. "pass" : no result regressed (or no baseline),
+  *          "+" : higher is better, "-" : lower is better.
+  *
+  *          Baseline : results of the baseline build (-b), or of the passing
+  *          runs of the last other build which passed, on the same target and
+  *          unit. A result regressed if it is worse by more than sigma standard
+  *          errors (Welch) and more than tolerance.
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <getopt.h>
+
+/* Private typedef -----------------------------------------------------------*/
+// samples of a result
+typedef struct
+{
+  char name[48];            // name of result
+  char better;              // '+' : higher is better, '-' : lower is better
+  double value[64];         // samples
+  unsigned num;             // number of samples
+} Result;
+
+// set of results
+typedef struct
+{
+  Result result[48];
+  unsigned num;
+} ResultSet;
+
+// port of device
+typedef struct
+{
+  int fd;
+  char buf[1024];           // bytes read and not taken yet
+  size_t len;
+} Port;
+
+/* Private define ------------------------------------------------------------*/
+#define NUM_OF(__A__)             (sizeof(__A__) / sizeof((__A__)[0]))
+#define TIMEOUT_MS                10000
+#define LINE_LENGTH               512
+#define BUILD_LENGTH              64
+#define KEY_LENGTH                32
+#define KERNEL_LENGTH             40        // name of BENCH kernel (+1), result is "kernel.<name>"
+
+// exit codes
+#define EXIT_PASS                 0
+#define EXIT_REGRESSION           1
+#define EXIT_ERROR                2
+
+/* Private function prototypes -----------------------------------------------*/
+static int OpenPort(Port* pPort, const char* pPath);
+static int ReadLine(Port* pPort, char* pLine, size_t size);
+static int Command(Port* pPort, const char* pCmd, char* pRes, size_t size, size_t* pBytes);
+static int EnterMachineMode(Port* pPort);
+static Result* GetResult(ResultSet* pSet, const char* pName, char better);
+static void AddSample(ResultSet* pSet, const char* pName, char better, double value);
+static int Measure(Port* pPort, unsigned runs, unsigned long iterations, ResultSet* pSet,
+                   char* pTarget, char* pUnit);
+static int LoadBaseline(const char* pPath, const char* pCurrent, const char* pTarget, const char* pUnit,
+                        char* pBaseline, ResultSet* pSet);
+static int AppendStore(const char* pPath, const char* pBuild, const char* pTarget, const char* pUnit,
+                       int pass, const ResultSet* pSet);
+static int Compare(const ResultSet* pBase, const ResultSet* pNew, double sigma, double tolerance);
+static void Stats(const Result* pResult, double* pMean, double* pVar);
+static double NowUs(void);
+
+/* Exported functions --------------------------------------------------------*/
+int main(int argc, char** argv)
+{
+  static ResultSet results;
+  static ResultSet baseline;
+  unsigned runs = 5;
+  unsigned long iterations = 1000;
+  double sigma = 3.0;
+  double tolerance = 5.0;
+  char build[BUILD_LENGTH];
+  char base[BUILD_LENGTH] = "";
+  char target[KEY_LENGTH];
+  char unit[KEY_LENGTH];
+  Port port;
+  int pass = 1;
+  int opt;
+
+  while( (opt = getopt(argc, argv, "n:i:b:s:t:")) != -1 )
+  {
+    switch( opt )
+    {
+    case 'n': runs = (unsigned)strtoul(optarg, NULL, 0); break;
+    case 'i': iterations = strtoul(optarg, NULL, 0); break;
+    case 'b': snprintf(base, sizeof(base), "%s", optarg); break;
+    case 's': sigma = atof(optarg); break;
+    case 't': tolerance = atof(optarg); break;
+    default:
+      fprintf(stderr, "usage: %s [-n runs] [-i iterations] [-b baseline] [-s sigma] [-t tolerance %%] <port> <store>\n", argv[0]);
+      return EXIT_ERROR;
+    }
+  }
+  if( argc - optind != 2 || runs < 2 || NUM_OF(results.result[0].value) < runs )
+  {
+    fprintf(stderr, "usage: %s [-n runs(2-64)] [-i iterations] [-b baseline] [-s sigma] [-t tolerance %%] <port> <store>\n", argv[0]);
+    return EXIT_ERROR;
+  }
+
+  if( OpenPort(&port, argv[optind]) != 0 || EnterMachineMode(&port) != 0
+      || Command(&port, "BUILD_ID", build, sizeof(build), NULL) != 0 )
+  {
+    fprintf(stderr, "%s: no response of device\n", argv[optind]);
+    return EXIT_ERROR;
+  }
+  // build ID is a field of the store
+  for( char* p = build; *p != '\0'; p++ )
+  {
+    if( *p == ' ' || *p == '\t' )
+    {
+      *p = '_';
+    }
+  }
+
+  printf("build %s\n", build);
+  if( Measure(&port, runs, iterations, &results, target, unit) != 0 )
+  {
+    fprintf(stderr, "benchmark failed\n");
+    return EXIT_ERROR;
+  }
+  close(port.fd);
+
+  if( LoadBaseline(argv[optind + 1], build, target, unit, base, &baseline) != 0 )
+  {
+    fprintf(stderr, "%s: can not read\n", argv[optind + 1]);
+    return EXIT_ERROR;
+  }
+  if( baseline.num == 0 )
+  {
+    printf("no baseline on %s (%s)\n", target, unit);
+  }
+  else
+  {
+    printf("baseline %s on %s (%s)\n", base, target, unit);
+    pass = ( Compare(&baseline, &results, sigma, tolerance / 100.0) == 0 );
+  }
+
+  // the verdict is stored with the results, a failed run is never a baseline
+  if( AppendStore(argv[optind + 1], build, target, unit, pass, &results) != 0 )
+  {
+    fprintf(stderr, "%s: can not write\n", argv[optind + 1]);
+    return EXIT_ERROR;
+  }
+  return pass ? EXIT_PASS : EXIT_REGRESSION;
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  OpenPort: open virtual COM port (or pty) in raw mode
+  * @param  pPort: pointer of port
+  * @param  pPath: path of device
+  * @retval 0 on success
+  */
+static int OpenPort(Port* pPort, const char* pPath)
+{
+  struct termios tio;
+
+  pPort->len = 0;
+  pPort->fd = open(pPath, O_RDWR | O_NOCTTY);
+  if( pPort->fd < 0 )
+  {
+    return -1;
+  }
+  if( tcgetattr(pPort->fd, &tio) == 0 )
+  {
+    cfmakeraw(&tio);
+    tcsetattr(pPort->fd, TCSANOW, &tio);
+  }
+  tcflush(pPort->fd, TCIOFLUSH);
+  return 0;
+}
+
+/**
+  * @brief  ReadLine: read a line (CR LF removed)
+  * @param  pPort: pointer of port
+  * @param  pLine: pointer of line buffer
+  * @param  size: size of line buffer
+  * @retval Length of line, -1 on timeout or error
+  */
+static int ReadLine(Port* pPort, char* pLine, size_t size)
+{
+  for( ;; )
+  {
+    char *pEnd = memchr(pPort->buf, '\n', pPort->len);
+    struct pollfd pfd = { pPort->fd, POLLIN, 0 };
+    ssize_t n;
+
+    if( pEnd != NULL )
+    {
+      size_t length = (size_t)(pEnd - pPort->buf);
+      size_t copy = (length < size - 1) ? length : size - 1;
+
+      memcpy(pLine, pPort->buf, copy);
+      while( 0 < copy && pLine[copy - 1] == '\r' )
+      {
+        --copy;
+      }
+      pLine[copy] = '\0';
+      pPort->len -= length + 1;
+      memmove(pPort->buf, pEnd + 1, pPort->len);
+      return (int)copy;
+    }
+    if( pPort->len == sizeof(pPort->buf) )
+    {
+      // line too long, drop it
+      pPort->len = 0;
+    }
+
+    if( poll(&pfd, 1, TIMEOUT_MS) <= 0 )
+    {
+      return -1;
+    }
+    n = read(pPort->fd, &pPort->buf[pPort->len], sizeof(pPort->buf) - pPort->len);
+    if( n <= 0 )
+    {
+      return -1;
+    }
+    pPort->len += (size_t)n;
+  }
+}
+
+/**
+  * @brief  Command: run a command in machine mode
+  * @param  pPort: pointer of port
+  * @param  pCmd: command line
+  * @param  pRes: pointer of response buffer (the last line before status line)
+  * @param  size: size of response buffer
+  * @param  pBytes: pointer of number of bytes received (NULL : not needed)
+  * @retval Result of command ("$<result>"), -100 on timeout
+  */
+static int Command(Port* pPort, const char* pCmd, char* pRes, size_t size, size_t* pBytes)
+{
+  char line[LINE_LENGTH];
+  size_t bytes = 0;
+  int length;
+
+  pRes[0] = '\0';
+  if( write(pPort->fd, pCmd, strlen(pCmd)) < 0 || write(pPort->fd, "\r\n", 2) < 0 )
+  {
+    return -100;
+  }
+  while( (length = ReadLine(pPort, line, sizeof(line))) >= 0 )
+  {
+    bytes += (size_t)length + 2;
+    if( line[0] == '$' )
+    {
+      if( pBytes != NULL )
+      {
+        *pBytes = bytes;
+      }
+      return atoi(&line[1]);
+    }
+    snprintf(pRes, size, "%s", line);
+  }
+  return -100;
+}
+
+/**
+  * @brief  EnterMachineMode: switch the session to machine mode
+  *         Output of interactive mode (prompt, echo) before it is skipped.
+  * @param  pPort: pointer of port
+  * @retval 0 on success
+  */
+static int EnterMachineMode(Port* pPort)
+{
+  char res[LINE_LENGTH];
+
+  // clear a partial line, then the response of MODE ends with the first status line
+  if( write(pPort->fd, "\r\n", 2) < 0 )
+  {
+    return -1;
+  }
+  usleep(100000);
+  tcflush(pPort->fd, TCIFLUSH);
+  return ( Command(pPort, "MODE MACHINE", res, sizeof(res), NULL) == 0 ) ? 0 : -1;
+}
+
+/**
+  * @brief  GetResult: find or add a result
+  * @param  pSet: pointer of result set
+  * @param  pName: name of result
+  * @param  better: '+' or '-'
+  * @retval Pointer of result, NULL if the set is full
+  */
+static Result* GetResult(ResultSet* pSet, const char* pName, char better)
+{
+  Result *pResult;
+
+  for( unsigned i = 0; i < pSet->num; i++ )
+  {
+    if( strcmp(pSet->result[i].name, pName) == 0 )
+    {
+      return &pSet->result[i];
+    }
+  }
+  if( NUM_OF(pSet->result) <= pSet->num )
+  {
+    return NULL;
+  }
+  pResult = &pSet->result[pSet->num++];
+  snprintf(pResult->name, sizeof(pResult->name), "%s", pName);
+  pResult->better = better;
+  pResult->num = 0;
+  return pResult;
+}
+
+/**
+  * @brief  AddSample: add a sample to a result (dropped if full)
+  * @param  pSet: pointer of result set
+  * @param  pName: name of result
+  * @param  better: '+' or '-'
+  * @param  value: sample
+  * @retval None
+  */
+static void AddSample(ResultSet* pSet, const char* pName, char better, double value)
+{
+  Result *pResult = GetResult(pSet, pName, better);
+
+  if( pResult != NULL && pResult->num < NUM_OF(pResult->value) )
+  {
+    pResult->value[pResult->num++] = value;
+  }
+}
+
+/**
+  * @brief  Measure: run all benchmarks
+  * @param  pPort: pointer of port
+  * @param  runs: number of runs of each
+  * @param  iterations: iterations of BENCH
+  * @param  pSet: pointer of result set
+  * @param  pTarget: pointer of target reported by BENCH (KEY_LENGTH, set)
+  * @param  pUnit: pointer of unit of kernel times reported by BENCH (KEY_LENGTH, set)
+  * @retval 0 on success
+  */
+static int Measure(Port* pPort, unsigned runs, unsigned long iterations, ResultSet* pSet,
+                   char* pTarget, char* pUnit)
+{
+  char list[LINE_LENGTH];
+  char res[LINE_LENGTH];
+  char cmd[96];
+  char name[sizeof("kernel.") + KERNEL_LENGTH];
+  char kernels[NUM_OF(pSet->result)][KERNEL_LENGTH];
+  char target[KEY_LENGTH];
+  char unit[KEY_LENGTH];
+  unsigned numOfKernels = 0;
+  int more = 1;
+  char *pSave;
+  size_t bytes;
+  double value;
+
+  // kernels registered in the device, page by page (" ..." : the list continues)
+  while( more )
+  {
+    unsigned first = numOfKernels;
+
+    snprintf(cmd, sizeof(cmd), "BENCH %u", first);
+    if( Command(pPort, cmd, list, sizeof(list), NULL) != 0 )
+    {
+      return -1;
+    }
+    more = 0;
+    for( char* pName = strtok_r(list, " ", &pSave); pName != NULL; pName = strtok_r(NULL, " ", &pSave) )
+    {
+      if( strcmp(pName, "...") == 0 )
+      {
+        more = 1;
+      }
+      else if( numOfKernels < NUM_OF(kernels) )
+      {
+        if( snprintf(kernels[numOfKernels], sizeof(kernels[0]), "%s", pName) >= (int)sizeof(kernels[0]) )
+        {
+          fprintf(stderr, "%s: kernel name %s too long\n", cmd, pName);
+          return -1;
+        }
+        numOfKernels++;
+      }
+    }
+    if( more && (numOfKernels == first || numOfKernels == NUM_OF(kernels)) )
+    {
+      fprintf(stderr, "%s: list not continued after %u kernels\n", cmd, numOfKernels);
+      return -1;
+    }
+  }
+
+  // "<name> n=<iterations> <time> <unit>/iter base=<baseline> target=<target>"
+  pTarget[0] = '\0';
+  pUnit[0] = '\0';
+  for( unsigned k = 0; k < numOfKernels; k++ )
+  {
+    // both fit : names are shorter than KERNEL_LENGTH, iterations up to 20 digits
+    snprintf(cmd, sizeof(cmd), "BENCH %.*s %lu", KERNEL_LENGTH - 1, kernels[k], iterations);
+    snprintf(name, sizeof(name), "kernel.%.*s", KERNEL_LENGTH - 1, kernels[k]);
+    for( unsigned r = 0; r < runs; r++ )
+    {
+      if( Command(pPort, cmd, res, sizeof(res), NULL) != 0
+          || sscanf(res, "%*s n=%*u %lf %31[^/ ]/iter base=%*s target=%31s", &value, unit, target) != 3 )
+      {
+        fprintf(stderr, "%s: %s\n", cmd, res);
+        return -1;
+      }
+      if( pTarget[0] == '\0' )
+      {
+        snprintf(pTarget, KEY_LENGTH, "%s", target);
+        snprintf(pUnit, KEY_LENGTH, "%s", unit);
+      }
+      else if( strcmp(pTarget, target) != 0 || strcmp(pUnit, unit) != 0 )
+      {
+        fprintf(stderr, "%s: %s, not on %s (%s)\n", cmd, res, pTarget, pUnit);
+        return -1;
+      }
+      AddSample(pSet, name, '-', value);
+    }
+    printf("  %-24s %s\n", name, res);
+  }
+
+  // round trip of a short command
+  for( unsigned r = 0; r < runs; r++ )
+  {
+    double start = NowUs();
+
+    if( Command(pPort, "MODE", res, sizeof(res), NULL) != 0 )
+    {
+      return -1;
+    }
+    AddSample(pSet, "latency.rtt_us", '-', NowUs() - start);
+  }
+
+  // responses of a long command one after another
+  for( unsigned r = 0; r < runs; r++ )
+  {
+    double start = NowUs();
+    size_t total = 0;
+
+    for( int k = 0; k < 10; k++ )
+    {
+      if( Command(pPort, "HELP -n", res, sizeof(res), &bytes) != 0 )
+      {
+        return -1;
+      }
+      total += bytes;
+    }
+    AddSample(pSet, "throughput.kBps", '+', (double)total * 1000.0 / (NowUs() - start));
+  }
+  return 0;
+}
+
+/**
+  * @brief  LoadBaseline: read results of the baseline build from the store
+  * @param  pPath: path of store (may not exist yet)
+  * @param  pCurrent: build being measured
+  * @param  pTarget: target of the results
+  * @param  pUnit: unit of kernel times
+  * @param  pBaseline: baseline build, the last other build which passed if empty (set)
+  * @param  pSet: pointer of result set
+  * @retval 0 on success
+  */
+static int LoadBaseline(const char* pPath, const char* pCurrent, const char* pTarget, const char* pUnit,
+                        char* pBaseline, ResultSet* pSet)
+{
+  FILE *fp = fopen(pPath, "r");
+  char line[4096];
+  int passOnly = ( pBaseline[0] == '\0' );
+
+  pSet->num = 0;
+  if( fp == NULL )
+  {
+    return 0;
+  }
+
+  if( passOnly )
+  {
+    while( fgets(line, sizeof(line), fp) != NULL )
+    {
+      char build[BUILD_LENGTH];
+      char target[KEY_LENGTH];
+      char unit[KEY_LENGTH];
+      char verdict[8];
+
+      if( sscanf(line, "%*s %63s %31s %31s %7s", build, target, unit, verdict) == 4
+          && strcmp(build, pCurrent) != 0 && strcmp(target, pTarget) == 0 && strcmp(unit, pUnit) == 0
+          && strcmp(verdict, "pass") == 0 )
+      {
+        snprintf(pBaseline, BUILD_LENGTH, "%s", build);
+      }
+    }
+    rewind(fp);
+  }
+
+  while( fgets(line, sizeof(line), fp) != NULL )
+  {
+    char build[BUILD_LENGTH];
+    char target[KEY_LENGTH];
+    char unit[KEY_LENGTH];
+    char verdict[8];
+    char name[48];
+    char better;
+    int used;
+    const char *p;
+    double value;
+    int n;
+
+    if( sscanf(line, "%*s %63s %31s %31s %7s %47s %c%n", build, target, unit, verdict, name, &better, &used) != 6
+        || strcmp(build, pBaseline) != 0 || strcmp(target, pTarget) != 0 || strcmp(unit, pUnit) != 0
+        || (passOnly && strcmp(verdict, "pass") != 0) )
+    {
+      continue;
+    }
+    for( p = &line[used]; sscanf(p, "%lf%n", &value, &n) == 1; p += n )
+    {
+      AddSample(pSet, name, better, value);
+    }
+  }
+  fclose(fp);
+  return 0;
+}
+
+/**
+  * @brief  AppendStore: append results to the store
+  * @param  pPath: path of store
+  * @param  pBuild: build ID
+  * @param  pTarget: target of the results
+  * @param  pUnit: unit of kernel times
+  * @param  pass: verdict of the run (1 : no regression)
+  * @param  pSet: pointer of result set
+  * @retval 0 on success
+  */
+static int AppendStore(const char* pPath, const char* pBuild, const char* pTarget, const char* pUnit,
+                       int pass, const ResultSet* pSet)
+{
+  FILE *fp = fopen(pPath, "a");
+  long now = (long)time(NULL);
+
+  if( fp == NULL )
+  {
+    return -1;
+  }
+  for( unsigned i = 0; i < pSet->num; i++ )
+  {
+    const Result *pResult = &pSet->result[i];
+
+    fprintf(fp, "%ld\t%s\t%s\t%s\t%s\t%s\t%c\t", now, pBuild, pTarget, pUnit, pass ? "pass" : "fail",
+            pResult->name, pResult->better);
+    for( unsigned k = 0; k < pResult->num; k++ )
+    {
+      fprintf(fp, "%s%.6g", (k == 0) ? "" : " ", pResult->value[k]);
+    }
+    fputc('\n', fp);
+  }
+  return ( fclose(fp) == 0 ) ? 0 : -1;
+}
+
+/**
+  * @brief  Compare: compare results with baseline and print them
+  * @param  pBase: pointer of baseline results
+  * @param  pNew: pointer of new results
+  * @param  sigma: number of standard errors a regression has to exceed
+  * @param  tolerance: relative change a regression has to exceed
+  * @retval 0 if no regression, -1 if any
+  */
+static int Compare(const ResultSet* pBase, const ResultSet* pNew, double sigma, double tolerance)
+{
+  int regressed = 0;
+
+  printf("  %-24s %12s %12s %8s\n", "result", "baseline", "new", "change");
+  for( unsigned i = 0; i < pNew->num; i++ )
+  {
+    const Result *pResult = &pNew->result[i];
+    const Result *pRef = NULL;
+    double meanBase, varBase, meanNew, varNew, worse, error;
+    const char *pVerdict = "";
+
+    for( unsigned k = 0; k < pBase->num; k++ )
+    {
+      if( strcmp(pBase->result[k].name, pResult->name) == 0 )
+      {
+        pRef = &pBase->result[k];
+      }
+    }
+    if( pRef == NULL || pRef->num < 2 )
+    {
+      printf("  %-24s %12s\n", pResult->name, "-");
+      continue;
+    }
+
+    Stats(pRef, &meanBase, &varBase);
+    Stats(pResult, &meanNew, &varNew);
+    worse = (pResult->better == '+') ? meanBase - meanNew : meanNew - meanBase;
+    error = sqrt(varBase / pRef->num + varNew / pResult->num);
+    if( sigma * error < worse && tolerance * fabs(meanBase) < worse )
+    {
+      pVerdict = " REGRESSION";
+      regressed = 1;
+    }
+    else if( sigma * error < -worse && tolerance * fabs(meanBase) < -worse )
+    {
+      pVerdict = " improved";
+    }
+    printf("  %-24s %12.3f %12.3f %+7.1f%%%s\n", pResult->name, meanBase, meanNew,
+           (meanBase != 0.0) ? (meanNew - meanBase) * 100.0 / meanBase : 0.0, pVerdict);
+  }
+  return regressed ? -1 : 0;
+}
+
+/**
+  * @brief  Stats: mean and unbiased variance of samples
+  * @param  pResult: pointer of result (2 samples or more)
+  * @param  pMean: pointer of mean
+  * @param  pVar: pointer of variance
+  * @retval None
+  */
+static void Stats(const Result* pResult, double* pMean, double* pVar)
+{
+  double sum = 0.0;
+  double squares = 0.0;
+
+  for( unsigned k = 0; k < pResult->num; k++ )
+  {
+    sum += pResult->value[k];
+  }
+  *pMean = sum / pResult->num;
+  for( unsigned k = 0; k < pResult->num; k++ )
+  {
+    squares += (pResult->value[k] - *pMean) * (pResult->value[k] - *pMean);
+  }
+  *pVar = squares / (pResult->num - 1);
+}
+
+/**
+  * @brief  NowUs: host monotonic clock
+  * @retval Time [us]
+  */
+static double NowUs(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
@@ -0,0 +1,285 @@
+/**
+  ******************************************************************************
+  * @file    cli_mux.c
+  * @author  Katagiri
+  * @brief   Source file for host side demultiplexer of USB command line.
+  *          Bytes read from the virtual COM port are given to HostMux_Feed,
+  *          and data of each channel is passed to its handler. Credits are
+  *          granted to the device again as the handlers take the data.
+  *
+  *          HostMux_Start  : send the start command, frames follow
+  *          HostMux_Send   : send data on a channel (limited by device credits)
+  *          HostMux_Close  : back to text mode
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "cli_mux.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+// state of frame parser
+#define PARSE_SYNC                0
+#define PARSE_HEADER              1
+#define PARSE_LENGTH              2
+#define PARSE_PAYLOAD             3
+
+/* Private macro -------------------------------------------------------------*/
+#define FRAME_TYPE(__HEADER__)            ((__HEADER__) >> 4)
+#define FRAME_CHANNEL(__HEADER__)         ((__HEADER__) & 0x0F)
+#define FRAME_HEADER(__TYPE__, __CH__)    (uint8_t)(((__TYPE__) << 4) | (__CH__))
+#define MIN(__A__, __B__)                 (((__A__) < (__B__)) ? (__A__) : (__B__))
+
+/* Private function prototypes -----------------------------------------------*/
+static int SendFrame(HostMux* pMux, uint8_t header, const uint8_t* pPayload, uint8_t length);
+static int SendCredit(HostMux* pMux, uint8_t ch, uint16_t credit);
+static void ReceivePayload(HostMux* pMux, const uint8_t* pData, size_t length);
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  HostMux_Init: initialize demultiplexer
+  * @param  pMux: pointer of demultiplexer
+  * @param  write: function writing to the port
+  * @param  pCtx: context of write function
+  * @retval None
+  */
+void HostMux_Init(HostMux* pMux, HostMuxWriteFxn write, void* pCtx)
+{
+  memset(pMux, 0, sizeof(HostMux));
+  pMux->write = write;
+  pMux->pWriteCtx = pCtx;
+  pMux->parseState = PARSE_SYNC;
+}
+
+/**
+  * @brief  HostMux_SetHandler: set receiver of a channel
+  * @param  pMux: pointer of demultiplexer
+  * @param  ch: channel
+  * @param  handler: receiver function, NULL to discard data
+  * @param  pCtx: context of receiver
+  * @retval None
+  */
+void HostMux_SetHandler(HostMux* pMux, uint8_t ch, HostMuxRxFxn handler, void* pCtx)
+{
+  if( ch < CLI_MUX_NUM_OF_CHANNELS )
+  {
+    pMux->handler[ch] = handler;
+    pMux->pHandlerCtx[ch] = pCtx;
+  }
+}
+
+/**
+  * @brief  HostMux_Start: request multiplexed mode.
+  *         Text before the first frame is discarded. Credits are granted to the
+  *         device when its first frame is received (HostMux_Feed).
+  * @param  pMux: pointer of demultiplexer
+  * @retval 0 on success, otherwise error of write function
+  */
+int HostMux_Start(HostMux* pMux)
+{
+  static const char start[] = CLI_MUX_START_COMMAND CLI_STRING_NEWLINE;
+
+  pMux->open = 0;
+  pMux->parseState = PARSE_SYNC;
+  memset(pMux->txCredit, 0, sizeof(pMux->txCredit));
+  memset(pMux->rxConsumed, 0, sizeof(pMux->rxConsumed));
+  return pMux->write(pMux->pWriteCtx, (const uint8_t*)start, sizeof(start) - 1);
+}
+
+/**
+  * @brief  HostMux_Feed: parse bytes read from the port
+  * @param  pMux: pointer of demultiplexer
+  * @param  pData: pointer of bytes
+  * @param  length: number of bytes
+  * @retval None
+  */
+void HostMux_Feed(HostMux* pMux, const uint8_t* pData, size_t length)
+{
+  size_t i = 0;
+
+  while( i < length )
+  {
+    switch( pMux->parseState )
+    {
+    case PARSE_SYNC:
+      if( pData[i] == CLI_MUX_SYNC )
+      {
+        pMux->parseState = PARSE_HEADER;
+      }
+      ++i;
+      break;
+
+    case PARSE_HEADER:
+      pMux->parseHeader = pData[i++];
+      pMux->parseState = PARSE_LENGTH;
+      break;
+
+    case PARSE_LENGTH:
+      pMux->parseLength = pData[i++];
+      pMux->parseRemain = pMux->parseLength;
+      pMux->parseState = ( pMux->parseRemain != 0 ) ? PARSE_PAYLOAD : PARSE_SYNC;
+      if( FRAME_TYPE(pMux->parseHeader) == CLI_MUX_TYPE_CREDIT && pMux->parseLength != 2 )
+      {
+        // its payload is skipped
+        ++pMux->framingErrors;
+      }
+      break;
+
+    default:  // PARSE_PAYLOAD
+    {
+      size_t n = MIN((size_t)pMux->parseRemain, length - i);
+
+      ReceivePayload(pMux, &pData[i], n);
+      pMux->parseRemain -= (uint8_t)n;
+      i += n;
+      if( pMux->parseRemain == 0 )
+      {
+        pMux->parseState = PARSE_SYNC;
+      }
+      break;
+    }
+    }
+  }
+}
+
+/**
+  * @brief  HostMux_Send: send data on a channel as far as the device granted
+  * @param  pMux: pointer of demultiplexer
+  * @param  ch: channel
+  * @param  pData: pointer of data
+  * @param  length: length of data
+  * @retval Length sent, send the rest after more credits are received
+  */
+size_t HostMux_Send(HostMux* pMux, uint8_t ch, const uint8_t* pData, size_t length)
+{
+  size_t sent = 0;
+
+  if( !pMux->open || CLI_MUX_NUM_OF_CHANNELS <= ch )
+  {
+    return 0;
+  }
+
+  while( sent < length && 0 < pMux->txCredit[ch] )
+  {
+    uint8_t n = (uint8_t)MIN(MIN(length - sent, (size_t)CLI_MUX_MAX_PAYLOAD), (size_t)pMux->txCredit[ch]);
+
+    if( SendFrame(pMux, FRAME_HEADER(CLI_MUX_TYPE_DATA, ch), &pData[sent], n) != 0 )
+    {
+      break;
+    }
+    pMux->txCredit[ch] -= n;
+    sent += n;
+  }
+  return sent;
+}
+
+/**
+  * @brief  HostMux_Close: request text mode
+  * @param  pMux: pointer of demultiplexer
+  * @retval 0 on success, otherwise error of write function
+  */
+int HostMux_Close(HostMux* pMux)
+{
+  pMux->open = 0;
+  return SendFrame(pMux, FRAME_HEADER(CLI_MUX_TYPE_RESET, CLI_MUX_CONTROL), NULL, 0);
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  SendFrame: write a frame to the port
+  * @param  pMux: pointer of demultiplexer
+  * @param  header: type and channel
+  * @param  pPayload: pointer of payload
+  * @param  length: length of payload
+  * @retval 0 on success, otherwise error of write function
+  */
+static int SendFrame(HostMux* pMux, uint8_t header, const uint8_t* pPayload, uint8_t length)
+{
+  uint8_t frame[CLI_MUX_HEADER_LENGTH + CLI_MUX_MAX_PAYLOAD];
+
+  frame[0] = CLI_MUX_SYNC;
+  frame[1] = header;
+  frame[2] = length;
+  if( 0 < length )
+  {
+    memcpy(&frame[CLI_MUX_HEADER_LENGTH], pPayload, length);
+  }
+  return pMux->write(pMux->pWriteCtx, frame, CLI_MUX_HEADER_LENGTH + (size_t)length);
+}
+
+/**
+  * @brief  SendCredit: grant credits of a channel to the device
+  * @param  pMux: pointer of demultiplexer
+  * @param  ch: channel
+  * @param  credit: number of bytes
+  * @retval 0 on success, otherwise error of write function
+  */
+static int SendCredit(HostMux* pMux, uint8_t ch, uint16_t credit)
+{
+  uint8_t payload[2];
+
+  payload[0] = (uint8_t)credit;
+  payload[1] = (uint8_t)(credit >> 8);
+  return SendFrame(pMux, FRAME_HEADER(CLI_MUX_TYPE_CREDIT, ch), payload, sizeof(payload));
+}
+
+/**
+  * @brief  ReceivePayload: handle payload of the frame being received
+  * @param  pMux: pointer of demultiplexer
+  * @param  pData: pointer of payload (part of it)
+  * @param  length: length of payload
+  * @retval None
+  */
+static void ReceivePayload(HostMux* pMux, const uint8_t* pData, size_t length)
+{
+  uint8_t ch = FRAME_CHANNEL(pMux->parseHeader);
+
+  if( CLI_MUX_NUM_OF_CHANNELS <= ch )
+  {
+    return;
+  }
+
+  switch( FRAME_TYPE(pMux->parseHeader) )
+  {
+  case CLI_MUX_TYPE_DATA:
+    pMux->rxBytes[ch] += length;
+    if( pMux->handler[ch] != NULL )
+    {
+      pMux->handler[ch](pMux->pHandlerCtx[ch], ch, pData, length);
+    }
+    // data is taken, grant again when half of the window is used
+    pMux->rxConsumed[ch] += (uint32_t)length;
+    if( HOST_MUX_WINDOW / 2 <= pMux->rxConsumed[ch] && SendCredit(pMux, ch, (uint16_t)pMux->rxConsumed[ch]) == 0 )
+    {
+      pMux->rxConsumed[ch] = 0;
+    }
+    break;
+
+  case CLI_MUX_TYPE_CREDIT:
+    if( pMux->parseLength != 2 )
+    {
+      break;
+    }
+    for(size_t i=0; i<length; i++)
+    {
+      pMux->parseCredit[(pMux->parseRemain - i) & 1] = pData[i];
+      if( pMux->parseRemain - i == 1 )
+      {
+        pMux->txCredit[ch] += (uint32_t)pMux->parseCredit[0] | ((uint32_t)pMux->parseCredit[1] << 8);
+        if( !pMux->open )
+        {
+          // the first frame of the device, grant the windows of all channels
+          pMux->open = 1;
+          for(uint8_t c=0; c<CLI_MUX_NUM_OF_CHANNELS; c++)
+          {
+            SendCredit(pMux, c, HOST_MUX_WINDOW);
+          }
+        }
+      }
+    }
+    break;
+
+  default:
+    break;
+  }
+}
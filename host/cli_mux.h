@@ -0,0 +1,59 @@
+/**
+  ******************************************************************************
+  * @file    cli_mux.h
+  * @author  Katagiri
+  * @brief   Header file for host side demultiplexer of USB command line.
+  *          Build on the host with the firmware directory in include path,
+  *          protocol constants are taken from usbd_cli_mux.h.
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CLI_MUX_H
+#define __CLI_MUX_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stddef.h>
+#include "usbd_cli_mux.h"
+
+/* Exported constants --------------------------------------------------------*/
+// credits granted to the device for each channel
+#ifndef HOST_MUX_WINDOW
+#define HOST_MUX_WINDOW           4096
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+// function writing bytes to the virtual COM port, returns 0 on success
+typedef int (*HostMuxWriteFxn)(void* pCtx, const uint8_t* pData, size_t length);
+
+// function receiving data of a channel, the data has to be taken before it returns
+typedef void (*HostMuxRxFxn)(void* pCtx, uint8_t ch, const uint8_t* pData, size_t length);
+
+// state of demultiplexer
+typedef struct
+{
+  HostMuxWriteFxn write;                              // writer of the port
+  void* pWriteCtx;                                    // context of writer
+  HostMuxRxFxn handler[CLI_MUX_NUM_OF_CHANNELS];      // receivers of channels
+  void* pHandlerCtx[CLI_MUX_NUM_OF_CHANNELS];         // contexts of receivers
+  uint32_t txCredit[CLI_MUX_NUM_OF_CHANNELS];         // credits granted by the device
+  uint32_t rxConsumed[CLI_MUX_NUM_OF_CHANNELS];       // bytes taken since the last grant
+  uint64_t rxBytes[CLI_MUX_NUM_OF_CHANNELS];          // bytes received
+  uint32_t framingErrors;                             // frames ignored (CREDIT not 2 bytes)
+  uint8_t open;                                       // 1 : the device is in multiplexed mode
+  uint8_t parseState;                                 // state of frame parser
+  uint8_t parseHeader;                                // header of frame being received
+  uint8_t parseLength;                                // payload length of the frame
+  uint8_t parseRemain;                                // payload bytes left in the frame
+  uint8_t parseCredit[2];                             // payload of CREDIT frame
+} HostMux;
+
+/* Exported functions ------------------------------------------------------- */
+void HostMux_Init(HostMux* pMux, HostMuxWriteFxn write, void* pCtx);
+void HostMux_SetHandler(HostMux* pMux, uint8_t ch, HostMuxRxFxn handler, void* pCtx);
+int HostMux_Start(HostMux* pMux);
+void HostMux_Feed(HostMux* pMux, const uint8_t* pData, size_t length);
+size_t HostMux_Send(HostMux* pMux, uint8_t ch, const uint8_t* pData, size_t length);
+int HostMux_Close(HostMux* pMux);
+
+#endif /* __CLI_MUX_H */
@@ -0,0 +1,288 @@
+/**
+  ******************************************************************************
+  * @file    cli_sim.c
+  * @author  Katagiri
+  * @brief   Simulator of many USB command line devices in one process.
+  *          Each device is a session of the command line interpreter
+  *          (CLI_SelectContext) on its own pty, which fleet tools open as if
+  *          it were a virtual COM port. One thread serves all of them with
+  *          epoll : input is taken when the interpreter is ready, and output
+  *          waits for the reader of the pty like IN packets wait for the Host.
+  *          Interpreter state is per device, state of other modules (counters,
+  *          caches, mux) is shared by all devices of the process.
+  *
+  *          Build : host build of the firmware with CLI_MAX_CONTEXTS devices
+  *            cc -I.. -I<usbd_def.h> -DCLI_MAX_CONTEXTS=512 -o cli_sim cli_sim.c ../usbd_cli*.c
+  *          Usage : cli_sim [-n devices] [-l link directory]
+  *            Prints "<index> <pty>" of each device, and links
+  *            <link directory>/cli<index> to the pty if -l is given.
+  *            SIM_ID reports the index of the device.
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include "usbd_cli.h"
+#include "usbd_cli_commands.h"
+
+/* Private typedef -----------------------------------------------------------*/
+// simulated device
+typedef struct
+{
+  int master;               // master side of pty (simulator)
+  int slave;                // slave side kept open, no hangup while no tool has it open
+  uint8_t out[1024];        // output waiting for the reader
+  size_t outLen;            // length of out
+  size_t outIdx;            // index of out to write
+  uint8_t in[256];          // input waiting for the interpreter
+  size_t inLen;             // length of in
+  size_t inIdx;             // index of in to take
+  uint32_t events;          // events being waited for
+} SimDevice;
+
+/* Private define ------------------------------------------------------------*/
+#define MAX_EVENTS                64
+
+/* Private function prototypes -----------------------------------------------*/
+static int OpenDevice(SimDevice* pDev, uint16_t index, const char* pLinkDir);
+static void Serve(SimDevice* pDev, uint16_t index);
+static void CollectOutput(SimDevice* pDev);
+static void WaitFor(SimDevice* pDev, uint16_t index, uint32_t events);
+static int8_t SIM_ID(uint8_t* pArg, uint8_t* pRes);
+
+/* Private variables ---------------------------------------------------------*/
+static const CommandUnit SimCommands[] =
+{
+  {"SIM_ID", SIM_ID, &Args_None},
+};
+
+static SimDevice Devices[CLI_MAX_CONTEXTS];
+static int Epoll;
+
+/* Exported functions --------------------------------------------------------*/
+int main(int argc, char** argv)
+{
+  struct epoll_event events[MAX_EVENTS];
+  const char *pLinkDir = NULL;
+  unsigned long num = CLI_MAX_CONTEXTS;
+  int opt;
+
+  while( (opt = getopt(argc, argv, "n:l:")) != -1 )
+  {
+    switch( opt )
+    {
+    case 'n': num = strtoul(optarg, NULL, 0); break;
+    case 'l': pLinkDir = optarg; break;
+    default:
+      fprintf(stderr, "usage: %s [-n devices(1-%u)] [-l link directory]\n", argv[0], CLI_MAX_CONTEXTS);
+      return 1;
+    }
+  }
+  if( num == 0 || CLI_MAX_CONTEXTS < num )
+  {
+    fprintf(stderr, "usage: %s [-n devices(1-%u)] [-l link directory]\n", argv[0], CLI_MAX_CONTEXTS);
+    return 1;
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+  CLI_RegisterCommands(SimCommands, sizeof(SimCommands) / sizeof(CommandUnit), CLI_OPCODE_USER_BASE);
+  CLI_Init();
+
+  Epoll = epoll_create1(0);
+  for( uint16_t i = 0; i < num; i++ )
+  {
+    if( Epoll < 0 || OpenDevice(&Devices[i], i, pLinkDir) != 0 )
+    {
+      perror("cli_sim");
+      return 1;
+    }
+    // output after reset (first prompt) : the first CLI_Output() starts the
+    // session and returns NULL, the TX timer of the target polls past it
+    CLI_SelectContext(i);
+    CLI_Output();
+    Serve(&Devices[i], i);
+  }
+  fflush(stdout);
+
+  for( ;; )
+  {
+    int n = epoll_wait(Epoll, events, MAX_EVENTS, -1);
+
+    if( n < 0 && errno != EINTR )
+    {
+      perror("cli_sim");
+      return 1;
+    }
+    for( int k = 0; k < n; k++ )
+    {
+      uint16_t index = (uint16_t)events[k].data.u32;
+      SimDevice *pDev = &Devices[index];
+
+      if( (events[k].events & EPOLLIN) && pDev->inIdx == pDev->inLen )
+      {
+        ssize_t length = read(pDev->master, pDev->in, sizeof(pDev->in));
+
+        if( 0 < length )
+        {
+          pDev->inLen = (size_t)length;
+          pDev->inIdx = 0;
+        }
+      }
+      Serve(pDev, index);
+    }
+  }
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  OpenDevice: create pty of a device
+  * @param  pDev: pointer of device
+  * @param  index: index of device
+  * @param  pLinkDir: directory of links to ptys, NULL if not linked
+  * @retval 0 on success
+  */
+static int OpenDevice(SimDevice* pDev, uint16_t index, const char* pLinkDir)
+{
+  struct termios tio;
+  struct epoll_event ev;
+  const char *pName;
+
+  pDev->master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if( pDev->master < 0 || grantpt(pDev->master) != 0 || unlockpt(pDev->master) != 0 )
+  {
+    return -1;
+  }
+  pName = ptsname(pDev->master);
+  pDev->slave = open(pName, O_RDWR | O_NOCTTY);
+  if( pDev->slave < 0 || tcgetattr(pDev->slave, &tio) != 0 )
+  {
+    return -1;
+  }
+  // bytes pass as they are, like a virtual COM port
+  cfmakeraw(&tio);
+  tcsetattr(pDev->slave, TCSANOW, &tio);
+
+  if( pLinkDir != NULL )
+  {
+    char link[256];
+
+    snprintf(link, sizeof(link), "%s/cli%u", pLinkDir, index);
+    unlink(link);
+    if( symlink(pName, link) != 0 )
+    {
+      return -1;
+    }
+  }
+  printf("%u %s\n", index, pName);
+
+  ev.events = EPOLLIN;
+  ev.data.u32 = index;
+  pDev->events = EPOLLIN;
+  return epoll_ctl(Epoll, EPOLL_CTL_ADD, pDev->master, &ev);
+}
+
+/**
+  * @brief  Serve: pass input to the interpreter of a device and write its output
+  * @param  pDev: pointer of device
+  * @param  index: index of device
+  * @retval None
+  */
+static void Serve(SimDevice* pDev, uint16_t index)
+{
+  CLI_SelectContext(index);
+
+  for( ;; )
+  {
+    // send output first, the interpreter is busy until it is sent
+    if( pDev->outIdx == pDev->outLen )
+    {
+      CollectOutput(pDev);
+    }
+    while( pDev->outIdx < pDev->outLen )
+    {
+      ssize_t n = write(pDev->master, &pDev->out[pDev->outIdx], pDev->outLen - pDev->outIdx);
+
+      if( n <= 0 )
+      {
+        // reader is slow, NAK until the pty has room
+        WaitFor(pDev, index, EPOLLOUT);
+        return;
+      }
+      pDev->outIdx += (size_t)n;
+      if( pDev->outIdx == pDev->outLen )
+      {
+        CollectOutput(pDev);
+      }
+    }
+
+    if( pDev->inIdx == pDev->inLen || !CLI_InputReady() )
+    {
+      break;
+    }
+    // one character at a time while ready, the rest waits like packets NAKed
+    CLI_Input(&pDev->in[pDev->inIdx], 1);
+    ++pDev->inIdx;
+  }
+
+  WaitFor(pDev, index, (pDev->inIdx == pDev->inLen) ? EPOLLIN : 0);
+}
+
+/**
+  * @brief  CollectOutput: take output of the interpreter (selected device)
+  * @param  pDev: pointer of device
+  * @retval None
+  */
+static void CollectOutput(SimDevice* pDev)
+{
+  uint8_t *pOutput;
+
+  pDev->outLen = 0;
+  pDev->outIdx = 0;
+  while( pDev->outLen < sizeof(pDev->out) - CLI_RESPONSE_LENGTH && (pOutput = CLI_Output()) != NULL )
+  {
+    size_t length = strlen((const char*)pOutput);
+
+    memcpy(&pDev->out[pDev->outLen], pOutput, length);
+    pDev->outLen += length;
+  }
+}
+
+/**
+  * @brief  WaitFor: change events waited for on a device
+  * @param  pDev: pointer of device
+  * @param  index: index of device
+  * @param  events: EPOLLIN, EPOLLOUT or 0
+  * @retval None
+  */
+static void WaitFor(SimDevice* pDev, uint16_t index, uint32_t events)
+{
+  struct epoll_event ev;
+
+  if( pDev->events != events )
+  {
+    ev.events = events;
+    ev.data.u32 = index;
+    epoll_ctl(Epoll, EPOLL_CTL_MOD, pDev->master, &ev);
+    pDev->events = events;
+  }
+}
+
+/**
+  * @brief  SIM_ID: report index of the simulated device
+  * @param  pArg: pointer of arguments string
+  * @param  pRes: pointer of response buffer
+  * @retval Result
+  */
+static int8_t SIM_ID(uint8_t* pArg, uint8_t* pRes)
+{
+  snprintf((char*)pRes, CLI_RESPONSE_LENGTH, "%u", CLI_GetContext());
+  return CLI_RESULT_OK;
+}
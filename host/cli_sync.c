@@ -0,0 +1,185 @@
+/**
+  ******************************************************************************
+  * @file    cli_sync.c
+  * @author  Katagiri
+  * @brief   Source file for host side time synchronization of USB command line.
+  *          TSYNC of a device reports the local time of its latest SOF with
+  *          the frame number. The frame number is found in the frame clock of
+  *          USB Host controller, which gives the host time of the same SOF.
+  *          Pairs of them are fitted by least squares into offset and drift,
+  *          and device timestamps are mapped into host time.
+  *
+  *          HostSync_Parse      : frame and device time from TSYNC response
+  *          HostSync_FrameTime  : host time of the frame, from a reference of
+  *                                the host controller (frame number and its
+  *                                start time, e.g. WinUsb_GetCurrentFrameNumber)
+  *          HostSync_Add / Fit  : collect pairs and fit them
+  *          HostSync_ToHost     : map a device timestamp
+  *
+  *          Accuracy is that of the frame reference of the host controller and
+  *          the SOF interrupt latency of the device (a few us), both well
+  *          below a frame.
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "cli_sync.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+#define NS_PER_S                  1000000000ULL
+
+/* Private macro -------------------------------------------------------------*/
+/* Private function prototypes -----------------------------------------------*/
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  HostSync_Init: initialize synchronization
+  * @param  pSync: pointer of synchronization
+  * @retval None
+  */
+void HostSync_Init(HostSync* pSync)
+{
+  memset(pSync, 0, sizeof(HostSync));
+  pSync->rate = 1.0;
+}
+
+/**
+  * @brief  HostSync_Parse: parse response of TSYNC
+  * @param  pLine: pointer of response ("frame=<n> t=<s>.<ns> ...")
+  * @param  pFrame: pointer of frame number
+  * @param  pDevNs: pointer of device time of the frame [ns]
+  * @retval 0 on success, -1 if not a TSYNC response
+  */
+int HostSync_Parse(const char* pLine, uint32_t* pFrame, uint64_t* pDevNs)
+{
+  unsigned long frame;
+  unsigned long sec;
+  unsigned long ns;
+
+  if( sscanf(pLine, "frame=%lu t=%lu.%lu", &frame, &sec, &ns) != 3 || NS_PER_S <= ns )
+  {
+    return -1;
+  }
+  *pFrame = (uint32_t)frame;
+  *pDevNs = (uint64_t)sec * NS_PER_S + ns;
+  return 0;
+}
+
+/**
+  * @brief  HostSync_FrameTime: host time of a frame, from a frame reference
+  *         of the host controller taken within 1 s of the frame
+  * @param  devFrame: frame number reported by the device (11 bits at any speed)
+  * @param  hostFrame: frame number of the reference
+  * @param  hostFrameNs: host time the reference frame started [ns]
+  * @retval Host time the frame started [ns]
+  */
+uint64_t HostSync_FrameTime(uint32_t devFrame, uint32_t hostFrame, uint64_t hostFrameNs)
+{
+  int32_t diff = (int32_t)((devFrame - hostFrame) & CLI_SYNC_FRAME_MASK);
+
+  // the nearest frame with the number, frame numbers wrap in 2.048 s
+  if( (CLI_SYNC_FRAME_MASK + 1) / 2 <= diff )
+  {
+    diff -= CLI_SYNC_FRAME_MASK + 1;
+  }
+  return hostFrameNs + (int64_t)diff * (int64_t)CLI_SYNC_FRAME_NS;
+}
+
+/**
+  * @brief  HostSync_Add: add a pair of times of the same SOF
+  *         The oldest is dropped when HOST_SYNC_SAMPLES are kept.
+  * @param  pSync: pointer of synchronization
+  * @param  hostNs: host time of SOF [ns]
+  * @param  devNs: device time of SOF [ns]
+  * @retval None
+  */
+void HostSync_Add(HostSync* pSync, uint64_t hostNs, uint64_t devNs)
+{
+  if( pSync->num == 0 && pSync->next == 0 )
+  {
+    // times are kept relative to the first pair for precision of double
+    pSync->hostBase = hostNs;
+    pSync->devBase = devNs;
+  }
+  pSync->hostTime[pSync->next] = (double)(int64_t)(hostNs - pSync->hostBase);
+  pSync->devTime[pSync->next] = (double)(int64_t)(devNs - pSync->devBase);
+  pSync->next = (pSync->next + 1) % HOST_SYNC_SAMPLES;
+  if( pSync->num < HOST_SYNC_SAMPLES )
+  {
+    ++pSync->num;
+  }
+}
+
+/**
+  * @brief  HostSync_Fit: fit host time = offset + rate * device time.
+  *         With one pair, the rate is 1 (offset only).
+  * @param  pSync: pointer of synchronization
+  * @retval 0 on success, -1 if no pair or all pairs at the same device time
+  */
+int HostSync_Fit(HostSync* pSync)
+{
+  double meanDev = 0.0;
+  double meanHost = 0.0;
+  double sxx = 0.0;
+  double sxy = 0.0;
+
+  if( pSync->num == 0 )
+  {
+    return -1;
+  }
+  for( uint32_t i = 0; i < pSync->num; i++ )
+  {
+    meanDev += pSync->devTime[i];
+    meanHost += pSync->hostTime[i];
+  }
+  meanDev /= pSync->num;
+  meanHost /= pSync->num;
+
+  for( uint32_t i = 0; i < pSync->num; i++ )
+  {
+    double dx = pSync->devTime[i] - meanDev;
+
+    sxx += dx * dx;
+    sxy += dx * (pSync->hostTime[i] - meanHost);
+  }
+
+  if( pSync->num == 1 )
+  {
+    pSync->rate = 1.0;
+  }
+  else if( sxx == 0.0 )
+  {
+    return -1;
+  }
+  else
+  {
+    pSync->rate = sxy / sxx;
+  }
+  pSync->offset = meanHost - pSync->rate * meanDev;
+  pSync->valid = 1;
+  return 0;
+}
+
+/**
+  * @brief  HostSync_ToHost: map device time into host time (after HostSync_Fit)
+  * @param  pSync: pointer of synchronization
+  * @param  devNs: device time [ns]
+  * @retval Host time [ns]
+  */
+uint64_t HostSync_ToHost(const HostSync* pSync, uint64_t devNs)
+{
+  double dev = (double)(int64_t)(devNs - pSync->devBase);
+
+  return pSync->hostBase + (uint64_t)(int64_t)(pSync->offset + pSync->rate * dev);
+}
+
+/**
+  * @brief  HostSync_DriftPpm: drift of device clock
+  * @param  pSync: pointer of synchronization
+  * @retval Drift [ppm], positive if the device clock is slow
+  */
+double HostSync_DriftPpm(const HostSync* pSync)
+{
+  return (pSync->rate - 1.0) * 1e6;
+}
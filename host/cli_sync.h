@@ -0,0 +1,48 @@
+/**
+  ******************************************************************************
+  * @file    cli_sync.h
+  * @author  Katagiri
+  * @brief   Header file for host side time synchronization of USB command line.
+  *          Build on the host with the firmware directory in include path,
+  *          frame constants are taken from usbd_cli_sync.h.
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CLI_SYNC_H
+#define __CLI_SYNC_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "usbd_cli_sync.h"
+
+/* Exported constants --------------------------------------------------------*/
+// number of samples fitted (the latest ones)
+#ifndef HOST_SYNC_SAMPLES
+#define HOST_SYNC_SAMPLES         64
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+// state of synchronization with a device
+typedef struct
+{
+  uint64_t hostBase;                      // host time of the first sample [ns]
+  uint64_t devBase;                       // device time of the first sample [ns]
+  double hostTime[HOST_SYNC_SAMPLES];     // host time of SOF from hostBase [ns]
+  double devTime[HOST_SYNC_SAMPLES];      // device time of SOF from devBase [ns]
+  uint32_t num;                           // number of samples kept
+  uint32_t next;                          // index of the next sample
+  double offset;                          // host time at devBase, from hostBase [ns]
+  double rate;                            // host ns per device ns
+  uint8_t valid;                          // 1 : offset and rate are fitted
+} HostSync;
+
+/* Exported functions ------------------------------------------------------- */
+void HostSync_Init(HostSync* pSync);
+int HostSync_Parse(const char* pLine, uint32_t* pFrame, uint64_t* pDevNs);
+uint64_t HostSync_FrameTime(uint32_t devFrame, uint32_t hostFrame, uint64_t hostFrameNs);
+void HostSync_Add(HostSync* pSync, uint64_t hostNs, uint64_t devNs);
+int HostSync_Fit(HostSync* pSync);
+uint64_t HostSync_ToHost(const HostSync* pSync, uint64_t devNs);
+double HostSync_DriftPpm(const HostSync* pSync);
+
+#endif /* __CLI_SYNC_H */
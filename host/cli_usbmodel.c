@@ -0,0 +1,762 @@
+/**
+  ******************************************************************************
+  * @file    cli_usbmodel.c
+  * @author  Katagiri
+  * @brief   Discrete-event model of USB bulk timing for the command line.
+  *          The (micro)frame schedule of full-speed or high-speed bus, IN
+  *          polling with NAK retries, OUT packets and the URBs of the host
+  *          driver are simulated in ns, and drive the firmware itself : the
+  *          interpreter and the TX scheduler get packets as from the CDC
+  *          interface, and their packets go back on the modeled bus.
+  *          Command latency and throughput are predicted as host/cli_bench.c
+  *          measures them (latency.rtt_us : MODE, throughput.kBps : HELP -n),
+  *          and compared with a result store of cli_bench if given.
+  *
+  *          Build : host build of the firmware
+  *            cc -I.. -I<usbd_def.h> -o cli_usbmodel cli_usbmodel.c ../usbd_cli*.c
+  *          Usage : cli_usbmodel [options] [<store file> [<build>]]
+  *            -H          high speed (default full speed)
+  *            -n <us>     NAK retry interval of IN polling (0 : next chance on the bus)
+  *            -u <us>     host driver delay (write to OUT URB, completion to application)
+  *            -m <us>     interrupt moderation of host controller (0 : none)
+  *            -b <bytes>  length of IN URB (default max packet size)
+  *            -q <n>      IN URBs queued (buffer depth of host driver)
+  *            -s <n>      max bulk transactions per (micro)frame (0 : bus time only)
+  *            -t <us>     period of device TX timer (CDC_POLLING_INTERVAL)
+  *            -i <us>     device time of an interrupt
+  *            -x <us>     device time of a command
+  *            -N <n>      commands per measurement
+  *            -T <%>      tolerance against the store
+  *
+  *          Bus time is counted in byte times with protocol overhead (SYNC,
+  *          PID, CRC, EOP, inter-packet delay, handshake), 19 x 64 bytes per
+  *          full-speed frame and 13 x 512 bytes per high-speed microframe.
+  *          Scheduling of the host OS is not modeled, predictions are expected
+  *          within the default tolerance (25 %) of cli_bench on an idle host.
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "usbd_cli.h"
+#include "usbd_cli_tx.h"
+#include "usbd_cli_counter.h"
+
+/* Private typedef -----------------------------------------------------------*/
+// configuration of model
+typedef struct
+{
+  uint64_t frameNs;         // length of (micro)frame
+  double byteNs;            // time of a byte on the bus
+  uint16_t dataOverhead;    // bytes of protocol overhead of a data transaction
+  uint16_t nakOverhead;     // bytes of a NAKed transaction (token and handshake)
+  uint16_t sofBytes;        // bytes of SOF at the beginning of a frame
+  uint16_t maxPacket;       // max packet size of bulk endpoints
+  uint16_t maxPerFrame;     // max bulk transactions per frame, 0 : bus time only
+  uint64_t nakRetryNs;      // IN polling interval after NAK
+  uint64_t hostDelayNs;     // host driver delay
+  uint64_t moderationNs;    // interrupt moderation of host controller
+  uint32_t urbLength;       // length of IN URB (0 : max packet size)
+  uint16_t urbDepth;        // IN URBs queued
+  uint64_t timerNs;         // period of device TX timer
+  uint64_t isrNs;           // device time of an interrupt
+  uint64_t commandNs;       // device time of a command
+  uint32_t commands;        // commands per measurement
+} ModelConfig;
+
+// type of event
+typedef enum
+{
+  EV_BUS,                   // bus free for the next transaction
+  EV_DEV_RX,                // device handles OUT packet (CDC_Itf_Receive)
+  EV_DEV_TX_DONE,           // device handles IN transfer complete
+  EV_DEV_TIMER,             // device TX timer
+  EV_HOST_OUT,              // OUT URB of application reaches host controller
+  EV_HOST_DELIVER,          // IN URB completed to application
+  EV_HOST_RESUBMIT,         // IN URB submitted again
+} EventType;
+
+// event
+typedef struct
+{
+  uint64_t time;            // time [ns]
+  uint32_t seq;             // order of events at the same time
+  uint8_t type;             // EventType
+  uint16_t length;          // length of data
+  uint32_t gen;             // generation of EV_BUS (older ones are dropped)
+  uint8_t data[512];        // data of packet
+} Event;
+
+// state of bus and endpoints
+typedef struct
+{
+  uint32_t gen;             // generation of the EV_BUS queued
+  uint8_t pending;          // 1 : EV_BUS queued
+  uint64_t at;              // time of EV_BUS queued
+  uint64_t frame;           // frame of perFrame
+  uint16_t perFrame;        // bulk transactions in the frame
+  uint8_t lastOut;          // 1 : the last transaction was OUT (round robin)
+  uint64_t inRetryAt;       // IN is polled again from this time
+  uint8_t rxArmed;          // 1 : device OUT endpoint takes a packet
+  uint8_t txArmed;          // 1 : device IN endpoint has a packet
+  uint64_t txReadyAt;       // time the packet is armed
+  uint16_t txLength;        // length of the packet
+  uint8_t txData[512];      // packet
+} BusState;
+
+// state of host
+typedef struct
+{
+  uint8_t out[256];         // command waiting on the bus
+  uint16_t outLen;
+  uint16_t outIdx;
+  uint16_t urbsQueued;      // IN URBs submitted and not completed
+  uint8_t urb[4096];        // data of IN URB being filled
+  uint32_t urbFill;
+  char line[1024];          // line being received by application
+  uint16_t lineLen;
+  uint64_t bytes;           // bytes received by application
+  uint8_t done;             // 1 : status line of the command received
+} HostState;
+
+/* Private define ------------------------------------------------------------*/
+#define MAX_EVENTS                4096
+#define NS_PER_US                 1000ULL
+#define TIMEOUT_NS                1000000000ULL     // time limit of a command
+
+/* Private function prototypes -----------------------------------------------*/
+static void Push(uint64_t time, uint8_t type, const uint8_t* pData, uint16_t length);
+static uint8_t Pop(Event* pEvent);
+static void KickBus(uint64_t time);
+static void Bus(uint64_t now);
+static uint64_t FitFrame(uint64_t time, uint64_t duration);
+static void CompleteUrb(uint64_t now);
+static void Device(const Event* pEvent, uint64_t now);
+static uint8_t Transmit(uint8_t* pBuf, uint16_t length);
+static void Host(const Event* pEvent, uint64_t now);
+static uint64_t RunCommand(const char* pCmd, uint64_t start);
+static void Run(uint64_t until);
+static int Compare(const char* pPath, const char* pBuild, double latency, double throughput, double tolerance);
+
+/* Private variables ---------------------------------------------------------*/
+static ModelConfig Config =
+{
+  1000000ULL, 666.7, 13, 7, 6, 64, 0,
+  0, 20 * NS_PER_US, 0, 0, 16,
+  5000 * NS_PER_US, 3 * NS_PER_US, 20 * NS_PER_US, 200
+};
+
+static Event Heap[MAX_EVENTS];
+static uint32_t NumOfEvents;
+static uint32_t EventSeq;
+static uint64_t Now;
+static uint64_t DevBusyUntil;   // device CPU is busy until this time
+static BusState UsbBus;
+static HostState UsbHost;
+
+/* Exported functions --------------------------------------------------------*/
+int main(int argc, char** argv)
+{
+  double tolerance = 25.0;
+  double latencySum = 0.0;
+  uint64_t latencyMin = UINT64_MAX;
+  uint64_t latencyMax = 0;
+  uint64_t start;
+  uint64_t bytes;
+  double latency, throughput;
+  uint32_t seed = 1;
+  int opt;
+
+  while( (opt = getopt(argc, argv, "Hn:u:m:b:q:s:t:i:x:N:T:")) != -1 )
+  {
+    switch( opt )
+    {
+    case 'H':
+      Config.frameNs = 125000ULL;
+      Config.byteNs = 16.67;
+      Config.dataOverhead = 55;
+      Config.nakOverhead = 25;
+      Config.sofBytes = 12;
+      Config.maxPacket = 512;
+      break;
+    case 'n': Config.nakRetryNs = strtoull(optarg, NULL, 0) * NS_PER_US; break;
+    case 'u': Config.hostDelayNs = strtoull(optarg, NULL, 0) * NS_PER_US; break;
+    case 'm': Config.moderationNs = strtoull(optarg, NULL, 0) * NS_PER_US; break;
+    case 'b': Config.urbLength = (uint32_t)strtoul(optarg, NULL, 0); break;
+    case 'q': Config.urbDepth = (uint16_t)strtoul(optarg, NULL, 0); break;
+    case 's': Config.maxPerFrame = (uint16_t)strtoul(optarg, NULL, 0); break;
+    case 't': Config.timerNs = strtoull(optarg, NULL, 0) * NS_PER_US; break;
+    case 'i': Config.isrNs = strtoull(optarg, NULL, 0) * NS_PER_US; break;
+    case 'x': Config.commandNs = strtoull(optarg, NULL, 0) * NS_PER_US; break;
+    case 'N': Config.commands = (uint32_t)strtoul(optarg, NULL, 0); break;
+    case 'T': tolerance = atof(optarg); break;
+    default:
+      fprintf(stderr, "usage: %s [-H] [-n us] [-u us] [-m us] [-b bytes] [-q urbs] [-s n] [-t us] [-i us] [-x us] [-N n] [-T %%] [<store> [<build>]]\n", argv[0]);
+      return 2;
+    }
+  }
+  if( Config.urbLength == 0 )
+  {
+    Config.urbLength = Config.maxPacket;
+  }
+  if( Config.urbLength == 0 || sizeof(UsbHost.urb) < Config.urbLength || Config.urbDepth == 0
+      || Config.timerNs == 0 || Config.commands == 0 )
+  {
+    fprintf(stderr, "invalid configuration\n");
+    return 2;
+  }
+
+  CLI_Init();
+  CLI_TxInit(Transmit);
+  UsbBus.rxArmed = 1;
+  UsbHost.urbsQueued = Config.urbDepth;
+  Push(Config.timerNs, EV_DEV_TIMER, NULL, 0);
+  KickBus(0);
+
+  // output after reset, then machine mode as cli_bench
+  Run(10 * Config.timerNs);
+  start = RunCommand("MODE MACHINE", Now);
+
+  // latency : one command at a time, written at any phase of the frame
+  for( uint32_t n = 0; n < Config.commands; n++ )
+  {
+    uint64_t rtt;
+
+    seed = seed * 1103515245UL + 12345UL;
+    start = Now + (seed >> 8) % Config.frameNs;
+    rtt = RunCommand("MODE", start) - start;
+    latencySum += (double)rtt;
+    latencyMin = (rtt < latencyMin) ? rtt : latencyMin;
+    latencyMax = (latencyMax < rtt) ? rtt : latencyMax;
+  }
+  latency = latencySum / Config.commands / NS_PER_US;
+
+  // throughput : long responses back to back
+  start = Now;
+  bytes = UsbHost.bytes;
+  for( uint32_t n = 0; n < Config.commands; n++ )
+  {
+    RunCommand("HELP -n", Now);
+  }
+  throughput = (double)(UsbHost.bytes - bytes) * 1e6 / (double)(Now - start);
+
+  printf("%s speed, %llu ns frame, max packet %u, URB %lu x %u\n",
+         (Config.maxPacket == 64) ? "full" : "high", (unsigned long long)Config.frameNs,
+         Config.maxPacket, (unsigned long)Config.urbLength, Config.urbDepth);
+  printf("  %-24s %12.3f (min %.3f max %.3f)\n", "latency.rtt_us", latency,
+         (double)latencyMin / NS_PER_US, (double)latencyMax / NS_PER_US);
+  printf("  %-24s %12.3f\n", "throughput.kBps", throughput);
+
+  if( optind < argc )
+  {
+    return Compare(argv[optind], (optind + 1 < argc) ? argv[optind + 1] : NULL, latency, throughput, tolerance / 100.0);
+  }
+  return 0;
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  Push: queue an event
+  * @param  time: time of event [ns]
+  * @param  type: EventType
+  * @param  pData: pointer of data (NULL if none)
+  * @param  length: length of data
+  * @retval None
+  */
+static void Push(uint64_t time, uint8_t type, const uint8_t* pData, uint16_t length)
+{
+  uint32_t i = NumOfEvents++;
+  Event ev;
+
+  if( MAX_EVENTS < NumOfEvents )
+  {
+    fprintf(stderr, "event queue overflow\n");
+    exit(2);
+  }
+
+  ev.time = time;
+  ev.seq = EventSeq++;
+  ev.type = type;
+  ev.length = length;
+  ev.gen = UsbBus.gen;
+  if( pData != NULL )
+  {
+    memcpy(ev.data, pData, length);
+  }
+
+  // binary heap ordered by time, then by order queued
+  while( 0 < i )
+  {
+    uint32_t parent = (i - 1) / 2;
+
+    if( Heap[parent].time < ev.time || (Heap[parent].time == ev.time && Heap[parent].seq < ev.seq) )
+    {
+      break;
+    }
+    Heap[i] = Heap[parent];
+    i = parent;
+  }
+  Heap[i] = ev;
+}
+
+/**
+  * @brief  Pop: take the earliest event
+  * @param  pEvent: pointer of event
+  * @retval 1 if taken, 0 if no event
+  */
+static uint8_t Pop(Event* pEvent)
+{
+  uint32_t i = 0;
+  Event last;
+
+  if( NumOfEvents == 0 )
+  {
+    return 0;
+  }
+  *pEvent = Heap[0];
+  last = Heap[--NumOfEvents];
+
+  for( ;; )
+  {
+    uint32_t child = i * 2 + 1;
+
+    if( NumOfEvents <= child )
+    {
+      break;
+    }
+    if( child + 1 < NumOfEvents && (Heap[child + 1].time < Heap[child].time
+        || (Heap[child + 1].time == Heap[child].time && Heap[child + 1].seq < Heap[child].seq)) )
+    {
+      ++child;
+    }
+    if( last.time < Heap[child].time || (last.time == Heap[child].time && last.seq < Heap[child].seq) )
+    {
+      break;
+    }
+    Heap[i] = Heap[child];
+    i = child;
+  }
+  Heap[i] = last;
+  return 1;
+}
+
+/**
+  * @brief  KickBus: have the host controller look for a transaction at time
+  * @param  time: time [ns]
+  * @retval None
+  */
+static void KickBus(uint64_t time)
+{
+  if( UsbBus.pending && UsbBus.at <= time )
+  {
+    return;
+  }
+  // the EV_BUS queued before is dropped
+  ++UsbBus.gen;
+  UsbBus.pending = 1;
+  UsbBus.at = time;
+  Push(time, EV_BUS, NULL, 0);
+}
+
+/**
+  * @brief  FitFrame: start time of a transaction, not crossing the end of frame
+  * @param  time: earliest time [ns]
+  * @param  duration: time of transaction [ns]
+  * @retval Start time [ns]
+  */
+static uint64_t FitFrame(uint64_t time, uint64_t duration)
+{
+  uint64_t frame = time / Config.frameNs;
+  uint64_t sofEnd = frame * Config.frameNs + (uint64_t)(Config.sofBytes * Config.byteNs);
+
+  if( time < sofEnd )
+  {
+    time = sofEnd;
+  }
+  if( (frame + 1) * Config.frameNs < time + duration
+      || (Config.maxPerFrame != 0 && UsbBus.frame == frame && Config.maxPerFrame <= UsbBus.perFrame) )
+  {
+    // next frame, after SOF
+    time = (frame + 1) * Config.frameNs + (uint64_t)(Config.sofBytes * Config.byteNs);
+  }
+  return time;
+}
+
+/**
+  * @brief  Bus: host controller runs a transaction if any
+  * @param  now: time [ns]
+  * @retval None
+  */
+static void Bus(uint64_t now)
+{
+  uint8_t outReady = (UsbHost.outIdx < UsbHost.outLen);
+  uint8_t inReady = (0 < UsbHost.urbsQueued && UsbBus.inRetryAt <= now);
+  uint16_t length;
+  uint64_t duration;
+  uint64_t start;
+  uint64_t frame;
+
+  UsbBus.pending = 0;
+  if( !outReady && !inReady )
+  {
+    if( 0 < UsbHost.urbsQueued )
+    {
+      KickBus(UsbBus.inRetryAt);
+    }
+    // otherwise idle until the host queues something
+    return;
+  }
+
+  if( outReady && (!inReady || !UsbBus.lastOut) )
+  {
+    // OUT : NAKed if the device has not armed the endpoint again
+    length = (uint16_t)(UsbHost.outLen - UsbHost.outIdx);
+    length = (Config.maxPacket < length) ? Config.maxPacket : length;
+    duration = (uint64_t)(((UsbBus.rxArmed ? length + Config.dataOverhead : length + Config.nakOverhead)) * Config.byteNs);
+    start = FitFrame(now, duration);
+    if( start != now )
+    {
+      KickBus(start);
+      return;
+    }
+    if( UsbBus.rxArmed )
+    {
+      UsbBus.rxArmed = 0;
+      Push(now + duration, EV_DEV_RX, &UsbHost.out[UsbHost.outIdx], length);
+      UsbHost.outIdx += length;
+    }
+    UsbBus.lastOut = 1;
+  }
+  else
+  {
+    // IN : data if the device has armed the endpoint, NAK otherwise
+    uint8_t ack = UsbBus.txArmed && UsbBus.txReadyAt <= now;
+
+    length = ack ? UsbBus.txLength : 0;
+    duration = (uint64_t)((ack ? length + Config.dataOverhead : Config.nakOverhead) * Config.byteNs);
+    start = FitFrame(now, duration);
+    if( start != now )
+    {
+      KickBus(start);
+      return;
+    }
+    if( ack )
+    {
+      memcpy(&UsbHost.urb[UsbHost.urbFill], UsbBus.txData, length);
+      UsbHost.urbFill += length;
+      UsbBus.txArmed = 0;
+      Push(now + duration, EV_DEV_TX_DONE, NULL, 0);
+      if( length < Config.maxPacket || Config.urbLength <= UsbHost.urbFill + Config.maxPacket )
+      {
+        // short packet or URB full
+        CompleteUrb(now + duration);
+      }
+    }
+    else
+    {
+      UsbBus.inRetryAt = now + duration + Config.nakRetryNs;
+    }
+    UsbBus.lastOut = 0;
+  }
+
+  frame = now / Config.frameNs;
+  if( UsbBus.frame != frame )
+  {
+    UsbBus.frame = frame;
+    UsbBus.perFrame = 0;
+  }
+  ++UsbBus.perFrame;
+  KickBus(now + duration);
+}
+
+/**
+  * @brief  CompleteUrb: IN URB completed, its data goes to the application
+  * @param  now: time of completion [ns]
+  * @retval None
+  */
+static void CompleteUrb(uint64_t now)
+{
+  uint64_t irq = now;
+
+  if( Config.moderationNs != 0 )
+  {
+    irq = (now + Config.moderationNs - 1) / Config.moderationNs * Config.moderationNs;
+  }
+  Push(irq + Config.hostDelayNs, EV_HOST_DELIVER, UsbHost.urb, (uint16_t)UsbHost.urbFill);
+  Push(irq + Config.hostDelayNs, EV_HOST_RESUBMIT, NULL, 0);
+  UsbHost.urbFill = 0;
+  --UsbHost.urbsQueued;
+}
+
+/**
+  * @brief  Device: firmware handles an interrupt (one at a time on the CPU)
+  * @param  pEvent: pointer of event
+  * @param  now: time [ns]
+  * @retval None
+  */
+static void Device(const Event* pEvent, uint64_t now)
+{
+  uint32_t commands = CLI_CounterValue[CLI_CNT_COMMANDS];
+  uint8_t armed = UsbBus.txArmed;
+  uint64_t cost = Config.isrNs;
+
+  if( now < DevBusyUntil )
+  {
+    // CPU busy, the interrupt is pending
+    Push(DevBusyUntil, pEvent->type, pEvent->data, pEvent->length);
+    return;
+  }
+
+  switch( pEvent->type )
+  {
+  case EV_DEV_RX:
+    // CDC_Itf_Receive : arm the endpoint again, then input and reply
+    UsbBus.rxArmed = 1;
+    CLI_Input((uint8_t*)pEvent->data, pEvent->length);
+    CLI_TxRequest();
+    break;
+
+  case EV_DEV_TX_DONE:
+    CLI_TxComplete();
+    break;
+
+  default:
+    CLI_TxKick();
+    Push(now + Config.timerNs, EV_DEV_TIMER, NULL, 0);
+    break;
+  }
+
+  cost += (CLI_CounterValue[CLI_CNT_COMMANDS] - commands) * Config.commandNs;
+  DevBusyUntil = now + cost;
+  if( !armed && UsbBus.txArmed )
+  {
+    UsbBus.txReadyAt = DevBusyUntil;
+  }
+  KickBus(DevBusyUntil);
+}
+
+/**
+  * @brief  Transmit: TX scheduler starts a packet (CDC_Itf_Transmit)
+  * @param  pBuf: pointer of packet
+  * @param  length: length of packet
+  * @retval 0 if started
+  */
+static uint8_t Transmit(uint8_t* pBuf, uint16_t length)
+{
+  if( UsbBus.txArmed || Config.maxPacket < length )
+  {
+    return 1;
+  }
+  memcpy(UsbBus.txData, pBuf, length);
+  UsbBus.txLength = length;
+  UsbBus.txArmed = 1;
+  return 0;
+}
+
+/**
+  * @brief  Host: driver and application of the host
+  * @param  pEvent: pointer of event
+  * @param  now: time [ns]
+  * @retval None
+  */
+static void Host(const Event* pEvent, uint64_t now)
+{
+  switch( pEvent->type )
+  {
+  case EV_HOST_OUT:
+    memcpy(UsbHost.out, pEvent->data, pEvent->length);
+    UsbHost.outLen = pEvent->length;
+    UsbHost.outIdx = 0;
+    KickBus(now);
+    break;
+
+  case EV_HOST_RESUBMIT:
+    ++UsbHost.urbsQueued;
+    KickBus(now);
+    break;
+
+  case EV_HOST_DELIVER:
+    UsbHost.bytes += pEvent->length;
+    for( uint16_t i = 0; i < pEvent->length; i++ )
+    {
+      char c = (char)pEvent->data[i];
+
+      if( c != '\n' )
+      {
+        if( UsbHost.lineLen < sizeof(UsbHost.line) - 1 )
+        {
+          UsbHost.line[UsbHost.lineLen++] = c;
+        }
+        continue;
+      }
+      if( UsbHost.line[0] == '$' )
+      {
+        UsbHost.done = 1;
+      }
+      UsbHost.lineLen = 0;
+    }
+    break;
+
+  default:
+    break;
+  }
+}
+
+/**
+  * @brief  RunCommand: application writes a command and waits for its status line
+  * @param  pCmd: command
+  * @param  start: time of writing [ns]
+  * @retval Time the status line is received [ns]
+  */
+static uint64_t RunCommand(const char* pCmd, uint64_t start)
+{
+  char line[128];
+  int length = snprintf(line, sizeof(line), "%s\r\n", pCmd);
+
+  UsbHost.done = 0;
+  Push(start + Config.hostDelayNs, EV_HOST_OUT, (const uint8_t*)line, (uint16_t)length);
+  Run(start + TIMEOUT_NS);
+  if( !UsbHost.done )
+  {
+    fprintf(stderr, "%s: no status line in %llu ms\n", pCmd, TIMEOUT_NS / 1000000ULL);
+    exit(2);
+  }
+  return Now;
+}
+
+/**
+  * @brief  Run: process events until the status line of the command or time
+  * @param  until: time to stop [ns]
+  * @retval None
+  */
+static void Run(uint64_t until)
+{
+  Event ev;
+
+  while( !UsbHost.done && NumOfEvents != 0 && Heap[0].time <= until && Pop(&ev) )
+  {
+    Now = ev.time;
+    switch( ev.type )
+    {
+    case EV_BUS:
+      if( ev.gen == UsbBus.gen )
+      {
+        Bus(Now);
+      }
+      break;
+
+    case EV_DEV_RX:
+    case EV_DEV_TX_DONE:
+    case EV_DEV_TIMER:
+      Device(&ev, Now);
+      break;
+
+    default:
+      Host(&ev, Now);
+      break;
+    }
+  }
+  if( !UsbHost.done && Now < until )
+  {
+    Now = until;
+  }
+}
+
+/**
+  * @brief  Compare: compare predictions with results of cli_bench
+  * @param  pPath: path of result store
+  * @param  pBuild: build (NULL : the last one in the store), on the target of its last run
+  * @param  latency: predicted latency [us]
+  * @param  throughput: predicted throughput [kB/s]
+  * @param  tolerance: relative tolerance
+  * @retval 0 if both are within tolerance, 1 if not, 2 on error
+  */
+static int Compare(const char* pPath, const char* pBuild, double latency, double throughput, double tolerance)
+{
+  static const char* const names[2] = { "latency.rtt_us", "throughput.kBps" };
+  const double predicted[2] = { latency, throughput };
+  double sum[2] = { 0.0, 0.0 };
+  unsigned num[2] = { 0, 0 };
+  char build[64] = "";
+  char target[32] = "";
+  char line[4096];
+  int result = 0;
+  FILE *fp = fopen(pPath, "r");
+
+  if( fp == NULL )
+  {
+    fprintf(stderr, "%s: can not read\n", pPath);
+    return 2;
+  }
+  if( pBuild != NULL )
+  {
+    snprintf(build, sizeof(build), "%s", pBuild);
+  }
+  while( fgets(line, sizeof(line), fp) != NULL )
+  {
+    char lineBuild[64];
+    char lineTarget[32];
+
+    if( sscanf(line, "%*s %63s %31s", lineBuild, lineTarget) == 2
+        && (pBuild == NULL || strcmp(lineBuild, build) == 0) )
+    {
+      snprintf(build, sizeof(build), "%s", lineBuild);
+      snprintf(target, sizeof(target), "%s", lineTarget);
+    }
+  }
+  rewind(fp);
+
+  while( fgets(line, sizeof(line), fp) != NULL )
+  {
+    char lineBuild[64];
+    char lineTarget[32];
+    char name[48];
+    int used;
+    int n;
+    double value;
+
+    // <time> <build> <target> <unit> <pass|fail> <name> <+|-> <values...>
+    if( sscanf(line, "%*s %63s %31s %*s %*s %47s %*c%n", lineBuild, lineTarget, name, &used) != 3
+        || strcmp(lineBuild, build) != 0 || strcmp(lineTarget, target) != 0 )
+    {
+      continue;
+    }
+    for( int k = 0; k < 2; k++ )
+    {
+      if( strcmp(name, names[k]) != 0 )
+      {
+        continue;
+      }
+      for( const char* p = &line[used]; sscanf(p, "%lf%n", &value, &n) == 1; p += n )
+      {
+        sum[k] += value;
+        ++num[k];
+      }
+    }
+  }
+  fclose(fp);
+
+  printf("measured %s on %s\n", build, target);
+  for( int k = 0; k < 2; k++ )
+  {
+    double measured;
+    double error;
+
+    if( num[k] == 0 )
+    {
+      printf("  %-24s %12s\n", names[k], "-");
+      continue;
+    }
+    measured = sum[k] / num[k];
+    error = (predicted[k] - measured) / measured;
+    printf("  %-24s %12.3f %+7.1f%%%s\n", names[k], measured, error * 100.0,
+           (tolerance < error || error < -tolerance) ? " OUT OF TOLERANCE" : "");
+    if( tolerance < error || error < -tolerance )
+    {
+      result = 1;
+    }
+  }
+  return result;
+}
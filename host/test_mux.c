@@ -0,0 +1,154 @@
+/**
+  ******************************************************************************
+  * @file    test_mux.c
+  * @author  Katagiri
+  * @brief   Test of CREDIT frames of the multiplexer, on both sides : the
+  *          parser of the firmware (usbd_cli_mux.c) and of the host library
+  *          (cli_mux.c) are fed the same frames. A CREDIT frame adds its
+  *          uint16_t to the credits of the channel, even split byte by byte.
+  *          A CREDIT frame of another length is a framing error : it adds
+  *          nothing (no stale byte of an earlier frame, no truncation), is
+  *          counted, and the next frame is parsed as usual.
+  *
+  *          Build : host build of the firmware
+  *            cc -I.. -I<usbd_def.h> -o test_mux test_mux.c cli_mux.c ../usbd_cli*.c
+  *          Usage : test_mux
+  *            Exits with 1 if a check fails.
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "usbd_cli.h"
+#include "usbd_cli_mux.h"
+#include "usbd_cli_counter.h"
+#include "cli_mux.h"
+
+/* Private define ------------------------------------------------------------*/
+#define CREDIT_HEADER(__CH__)     ((CLI_MUX_TYPE_CREDIT << 4) | (__CH__))
+
+/* Private macro -------------------------------------------------------------*/
+#define CHECK(__COND__)                                                   \
+  do{                                                                     \
+    if( !(__COND__) )                                                     \
+    {                                                                     \
+      fprintf(stderr, "test_mux:%d: %s\n", __LINE__, #__COND__);          \
+      ++Failures;                                                         \
+    }                                                                     \
+  }while(0)
+
+/* Private function prototypes -----------------------------------------------*/
+static void Feed(const uint8_t* pFrame, uint16_t length, uint8_t split);
+static uint32_t DeviceCredit(void);
+static uint32_t DeviceFraming(void);
+static int HostWrite(void* pCtx, const uint8_t* pData, size_t length);
+
+/* Private variables ---------------------------------------------------------*/
+static unsigned Failures;
+static HostMux Mux;
+
+/* Exported functions --------------------------------------------------------*/
+int main(void)
+{
+  static const uint8_t valid[] = { CLI_MUX_SYNC, CREDIT_HEADER(CLI_MUX_BULK), 2, 0x34, 0x12 };
+  static const uint8_t shortFrame[] = { CLI_MUX_SYNC, CREDIT_HEADER(CLI_MUX_BULK), 1, 0x05 };
+  static const uint8_t longFrame[] = { CLI_MUX_SYNC, CREDIT_HEADER(CLI_MUX_BULK), 3, 0x01, 0x00, 0x00 };
+  static const uint8_t emptyFrame[] = { CLI_MUX_SYNC, CREDIT_HEADER(CLI_MUX_BULK), 0 };
+  static const uint8_t small[] = { CLI_MUX_SYNC, CREDIT_HEADER(CLI_MUX_BULK), 2, 0x10, 0x00 };
+  uint32_t device;
+  uint32_t host;
+  uint32_t framing;
+
+  CLI_Init();
+  CLI_MuxStart();
+  HostMux_Init(&Mux, HostWrite, NULL);
+  framing = DeviceFraming();
+
+  // credits of a frame, whole or byte by byte
+  Feed(valid, sizeof(valid), 0);
+  CHECK(DeviceCredit() == 0x1234 && Mux.txCredit[CLI_MUX_BULK] == 0x1234);
+  Feed(valid, sizeof(valid), 1);
+  CHECK(DeviceCredit() == 2 * 0x1234 && Mux.txCredit[CLI_MUX_BULK] == 2 * 0x1234);
+
+  // 1 byte : the high byte of the previous frame is not used
+  device = DeviceCredit();
+  host = Mux.txCredit[CLI_MUX_BULK];
+  Feed(shortFrame, sizeof(shortFrame), 0);
+  CHECK(DeviceCredit() == device && Mux.txCredit[CLI_MUX_BULK] == host);
+  CHECK(DeviceFraming() == framing + 1 && Mux.framingErrors == 1);
+
+  // 3 bytes : not truncated to the first 2, split or not
+  Feed(longFrame, sizeof(longFrame), 0);
+  Feed(longFrame, sizeof(longFrame), 1);
+  CHECK(DeviceCredit() == device && Mux.txCredit[CLI_MUX_BULK] == host);
+  CHECK(DeviceFraming() == framing + 3 && Mux.framingErrors == 3);
+
+  // no payload
+  Feed(emptyFrame, sizeof(emptyFrame), 0);
+  CHECK(DeviceCredit() == device && Mux.txCredit[CLI_MUX_BULK] == host);
+  CHECK(DeviceFraming() == framing + 4 && Mux.framingErrors == 4);
+
+  // the parser is in step after the bad frames
+  Feed(small, sizeof(small), 0);
+  CHECK(DeviceCredit() == device + 0x10 && Mux.txCredit[CLI_MUX_BULK] == host + 0x10);
+  CHECK(DeviceFraming() == framing + 4 && Mux.framingErrors == 4);
+
+  printf("test_mux : credit=%lu framing=%lu, %u failures\n", (unsigned long)DeviceCredit(),
+         (unsigned long)(DeviceFraming() - framing), Failures);
+  return ( Failures == 0 ) ? 0 : 1;
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  Feed: pass a frame to the parsers of the device and of the host
+  * @param  pFrame: pointer of frame
+  * @param  length: length of frame
+  * @param  split: 1 to pass it one byte at a time (frames split across packets)
+  * @retval None
+  */
+static void Feed(const uint8_t* pFrame, uint16_t length, uint8_t split)
+{
+  uint8_t buf[16];
+
+  memcpy(buf, pFrame, length);
+  for( uint16_t i = 0; i < length; i += (split ? 1 : length) )
+  {
+    uint16_t n = split ? 1 : length;
+
+    CLI_MuxInput(&buf[i], n);
+    HostMux_Feed(&Mux, &buf[i], n);
+  }
+}
+
+/**
+  * @brief  DeviceCredit: credits of CLI_MUX_BULK granted to the device
+  * @retval Credits
+  */
+static uint32_t DeviceCredit(void)
+{
+  MuxStats stats;
+
+  CLI_MuxGetStats(CLI_MUX_BULK, &stats);
+  return stats.txCredit;
+}
+
+/**
+  * @brief  DeviceFraming: framing errors counted by the device
+  * @retval Count
+  */
+static uint32_t DeviceFraming(void)
+{
+  return CLI_CounterRead(CLI_CNT_MUX_FRAMING, 0);
+}
+
+/**
+  * @brief  HostWrite: frames sent by the host library (credits of its own)
+  * @retval 0
+  */
+static int HostWrite(void* pCtx, const uint8_t* pData, size_t length)
+{
+  (void)pCtx;
+  (void)pData;
+  (void)length;
+  return 0;
+}
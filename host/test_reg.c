@@ -0,0 +1,128 @@
+/**
+  ******************************************************************************
+  * @file    test_reg.c
+  * @author  Katagiri
+  * @brief   Test of the memory map of REG_BATCH and CAPTURE (CLI_REG_MAP of
+  *          usbd_cli_reg.h) : CLI_RegValid accepts the first and last words
+  *          of each range, and rejects the words just outside a range, the
+  *          reserved gaps between peripheral blocks and unaligned addresses.
+  *          A batch with an address in a gap is rejected before it runs.
+  *
+  *          Build : host build of the firmware
+  *            cc -I.. -I<usbd_def.h> -o test_reg test_reg.c ../usbd_cli*.c
+  *          Usage : test_reg
+  *            Exits with 1 if a check fails.
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include "usbd_cli.h"
+#include "usbd_cli_reg.h"
+
+/* Private macro -------------------------------------------------------------*/
+#define NUM_OF(__A__)             (sizeof(__A__) / sizeof((__A__)[0]))
+
+#define CHECK(__COND__, __ADDR__)                                         \
+  do{                                                                     \
+    ++Cases;                                                              \
+    if( !(__COND__) )                                                     \
+    {                                                                     \
+      fprintf(stderr, "test_reg:%d: %s (0x%08lX)\n", __LINE__, #__COND__,  \
+              (unsigned long)(__ADDR__));                                 \
+      ++Failures;                                                         \
+    }                                                                     \
+  }while(0)
+
+/* Private variables ---------------------------------------------------------*/
+static unsigned Cases;
+static unsigned Failures;
+
+// ranges of the map
+static const uint32_t Map[][2] =
+{
+#define TEST_RANGE(__FIRST__, __LAST__)       { (__FIRST__), (__LAST__) },
+  CLI_REG_MAP(TEST_RANGE)
+#undef TEST_RANGE
+};
+
+// reserved on STM32F405/407 (RM0090 memory map)
+static const uint32_t Gaps[] =
+{
+  0x40002400UL,     // between TIM14 and RTC & BKP
+  0x40006000UL,     // between I2C3 and CAN1
+  0x40007800UL,     // past DAC
+  0x40010800UL,     // between TIM8 and USART1
+  0x40012400UL,     // between ADC and SDIO
+  0x40013400UL,     // between SPI1 and SYSCFG
+  0x40014C00UL,     // past TIM11
+  0x40016000UL,
+  0x40022400UL,     // past GPIOI
+  0x40023400UL,     // between CRC and RCC
+  0x40025000UL,     // between BKPSRAM and DMA1
+  0x40026800UL,     // between DMA2 and Ethernet MAC
+  0x40030000UL,     // between Ethernet MAC and USB OTG HS
+  0x50040000UL,     // between USB OTG FS and DCMI
+  0x50060000UL,     // CRYP (STM32F415/417 only)
+  0x50060400UL,     // HASH (STM32F415/417 only)
+  0xE0003000UL,     // between FPB and SCS
+  0xE0050000UL,     // past DBGMCU
+  0x08000000UL,     // Flash (not a register)
+  0x00000000UL,
+  0xFFFFFFFCUL,
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static uint8_t InMap(uint32_t addr);
+
+/* Exported functions --------------------------------------------------------*/
+int main(void)
+{
+  uint8_t res[CLI_RESPONSE_LENGTH];
+  uint8_t batch[32];
+
+  // edges of each range
+  for( unsigned i = 0; i < NUM_OF(Map); i++ )
+  {
+    CHECK(CLI_RegValid(Map[i][0]), Map[i][0]);
+    CHECK(CLI_RegValid(Map[i][1] - 3), Map[i][1] - 3);
+    CHECK(!CLI_RegValid(Map[i][0] + 2), Map[i][0] + 2);
+    if( !InMap(Map[i][0] - 4) )
+    {
+      CHECK(!CLI_RegValid(Map[i][0] - 4), Map[i][0] - 4);
+    }
+    if( !InMap(Map[i][1] + 1) )
+    {
+      CHECK(!CLI_RegValid(Map[i][1] + 1), Map[i][1] + 1);
+    }
+  }
+
+  // reserved gaps, in a batch as well
+  CLI_Init();
+  for( unsigned i = 0; i < NUM_OF(Gaps); i++ )
+  {
+    CHECK(!CLI_RegValid(Gaps[i]), Gaps[i]);
+    snprintf((char*)batch, sizeof(batch), "R 0x%08lX", (unsigned long)Gaps[i]);
+    CHECK(CLI_RegBatch(batch, res) == CLI_RESULT_INVALID, Gaps[i]);
+  }
+
+  printf("test_reg : %u ranges, %u cases, %u failures\n", (unsigned)NUM_OF(Map), Cases, Failures);
+  return ( Failures == 0 ) ? 0 : 1;
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  InMap: check an address against the ranges of the map (adjacent ranges)
+  * @param  addr: address
+  * @retval 1 if it is in a range
+  */
+static uint8_t InMap(uint32_t addr)
+{
+  for( unsigned i = 0; i < NUM_OF(Map); i++ )
+  {
+    if( Map[i][0] <= addr && addr <= Map[i][1] )
+    {
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,141 @@
+/**
+  ******************************************************************************
+  * @file    test_scan.c
+  * @author  Katagiri
+  * @brief   Test of the input scanner : CLI_ScanCopy against ScanCopyBytes,
+  *          its byte-at-a-time reference, for every byte value at every
+  *          position of a printable line, every alignment of source and
+  *          destination, and every length.
+  *          usbd_cli_scan.c is included to reach the reference. With
+  *          TEST_SIMD32 the Cortex-M4 path (__USUB8/__SEL) is built on the
+  *          host with emulated intrinsics, otherwise the SWAR path.
+  *
+  *          Build : host build of the firmware
+  *            cc -I.. -I<usbd_def.h> -o test_scan test_scan.c
+  *            cc -I.. -I<usbd_def.h> -DTEST_SIMD32 -o test_scan_simd test_scan.c
+  *          Usage : test_scan
+  *            Exits with 1 if a result differs.
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdint.h>
+
+#if defined(TEST_SIMD32)
+/* Emulation of Cortex-M4 SIMD intrinsics : GE flags of each byte */
+#define __ARM_FEATURE_SIMD32      1
+static uint32_t SimdGE;
+
+static uint32_t __USUB8(uint32_t a, uint32_t b)
+{
+  uint32_t result = 0;
+
+  SimdGE = 0;
+  for( int k = 0; k < 4; k++ )
+  {
+    uint32_t x = (a >> (8 * k)) & 0xFF;
+    uint32_t y = (b >> (8 * k)) & 0xFF;
+
+    if( y <= x )
+    {
+      SimdGE |= 1u << k;
+    }
+    result |= ((x - y) & 0xFF) << (8 * k);
+  }
+  return result;
+}
+
+static uint32_t __SEL(uint32_t a, uint32_t b)
+{
+  uint32_t result = 0;
+
+  for( int k = 0; k < 4; k++ )
+  {
+    result |= (((SimdGE >> k) & 1) ? a : b) & (0xFFu << (8 * k));
+  }
+  return result;
+}
+#endif
+
+#include "usbd_cli_scan.c"
+
+/* Private define ------------------------------------------------------------*/
+// longest line tested
+#define MAX_LENGTH                24
+
+/* Private function prototypes -----------------------------------------------*/
+static int Check(const uint8_t* pSrc, uint16_t length, uint8_t dstOffset);
+
+/* Exported functions --------------------------------------------------------*/
+int main(void)
+{
+  uint8_t line[MAX_LENGTH + 4];
+  unsigned long cases = 0;
+  unsigned long failures = 0;
+
+  for( uint8_t offset = 0; offset < 4; offset++ )
+  {
+    for( uint16_t length = 0; length <= MAX_LENGTH; length++ )
+    {
+      for( uint16_t pos = 0; pos < ((length == 0) ? 1 : length); pos++ )
+      {
+        for( uint16_t value = 0; value < 256; value++ )
+        {
+          for( uint16_t i = 0; i < sizeof(line); i++ )
+          {
+            line[i] = (uint8_t)(' ' + i % ('~' - ' ' + 1));
+          }
+          if( pos < length )
+          {
+            line[offset + pos] = (uint8_t)value;
+          }
+          for( uint8_t dst = 0; dst < 4; dst++ )
+          {
+            ++cases;
+            if( Check(&line[offset], length, dst) != 0 )
+            {
+              if( failures++ < 10 )
+              {
+                fprintf(stderr, "differs : offset %u length %u pos %u value 0x%02X dst %u\n",
+                        offset, length, pos, value, dst);
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  printf("%s : %lu cases, %lu failures\n",
+#if defined(TEST_SIMD32)
+         "simd32",
+#else
+         "swar",
+#endif
+         cases, failures);
+  return ( failures == 0 ) ? 0 : 1;
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  Check: compare CLI_ScanCopy with ScanCopyBytes on a line
+  * @param  pSrc: pointer of line
+  * @param  length: max length to copy
+  * @param  dstOffset: alignment of destination
+  * @retval 0 if they agree
+  */
+static int Check(const uint8_t* pSrc, uint16_t length, uint8_t dstOffset)
+{
+  uint8_t expected[MAX_LENGTH + 8];
+  uint8_t actual[MAX_LENGTH + 8];
+  uint16_t lengthExpected;
+  uint16_t lengthActual;
+
+  memset(expected, 0xA5, sizeof(expected));
+  memset(actual, 0xA5, sizeof(actual));
+  lengthExpected = ScanCopyBytes(pSrc, &expected[dstOffset], length);
+  lengthActual = CLI_ScanCopy(pSrc, &actual[dstOffset], length);
+
+  // bytes past the length copied are not written either
+  return ( lengthExpected != lengthActual || memcmp(expected, actual, sizeof(expected)) != 0 ) ? 1 : 0;
+}
@@ -0,0 +1,170 @@
+/**
+  ******************************************************************************
+  * @file    test_sync.c
+  * @author  Katagiri
+  * @brief   Test of host side time synchronization (cli_sync.c).
+  *          HostSync_Parse and HostSync_FrameTime are checked on fixed cases
+  *          (frame numbers wrapping in both directions), then a device with
+  *          a clock 50 ppm fast and +-2 us SOF interrupt jitter is simulated :
+  *          its TSYNC responses go through Parse, FrameTime, Add and Fit as
+  *          a tool would use them, and the fit has to recover the drift and
+  *          map a device timestamp 15 s into the run within 0.3 us.
+  *
+  *          Build : cc -I.. -o test_sync test_sync.c cli_sync.c -lm
+  *          Usage : test_sync
+  *            Exits with 1 if a check fails.
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <math.h>
+#include "cli_sync.h"
+
+/* Private define ------------------------------------------------------------*/
+#define NS_PER_S                  1000000000ULL
+
+// simulated device
+#define DEVICE_PPM                50.0            // device clock fast [ppm]
+#define DEVICE_BASE_NS            1234567890123ULL  // device time at host time 0
+#define JITTER_NS                 2000            // SOF interrupt latency +- [ns]
+#define SAMPLE_FRAMES             500             // frames between TSYNC
+#define REFERENCE_LAG_FRAMES      300             // age of the frame reference of host controller
+
+// limits
+#define MAX_DRIFT_ERROR_PPM       0.1
+#define MAX_MAP_ERROR_NS          300.0
+#define MAP_TIME_NS               (15 * NS_PER_S)
+
+/* Private macro -------------------------------------------------------------*/
+#define CHECK(__COND__)                                                   \
+  do{                                                                     \
+    if( !(__COND__) )                                                     \
+    {                                                                     \
+      fprintf(stderr, "test_sync:%d: %s\n", __LINE__, #__COND__);         \
+      ++Failures;                                                         \
+    }                                                                     \
+  }while(0)
+
+/* Private function prototypes -----------------------------------------------*/
+static void TestParse(void);
+static void TestFrameTime(void);
+static void TestFit(void);
+static uint64_t DeviceTime(uint64_t hostNs);
+static int32_t Jitter(void);
+
+/* Private variables ---------------------------------------------------------*/
+static unsigned Failures;
+static uint32_t Random = 12345;
+
+/* Exported functions --------------------------------------------------------*/
+int main(void)
+{
+  TestParse();
+  TestFrameTime();
+  TestFit();
+
+  printf("test_sync : %u failures\n", Failures);
+  return ( Failures == 0 ) ? 0 : 1;
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  TestParse: TSYNC responses
+  * @retval None
+  */
+static void TestParse(void)
+{
+  uint32_t frame = 0;
+  uint64_t ns = 0;
+
+  CHECK(HostSync_Parse("frame=2047 t=12.000000345 now=12.000100000", &frame, &ns) == 0);
+  CHECK(frame == 2047 && ns == 12 * NS_PER_S + 345);
+  CHECK(HostSync_Parse("frame=0 t=0.999999999", &frame, &ns) == 0);
+  CHECK(frame == 0 && ns == NS_PER_S - 1);
+  CHECK(HostSync_Parse("frame=1 t=1.1000000000", &frame, &ns) != 0);
+  CHECK(HostSync_Parse("frame=1", &frame, &ns) != 0);
+  CHECK(HostSync_Parse("Error : Command not found.", &frame, &ns) != 0);
+}
+
+/**
+  * @brief  TestFrameTime: nearest frame with the number, around the wrap
+  * @retval None
+  */
+static void TestFrameTime(void)
+{
+  uint64_t ref = 100 * NS_PER_S;
+
+  CHECK(HostSync_FrameTime(100, 100, ref) == ref);
+  CHECK(HostSync_FrameTime(110, 100, ref) == ref + 10 * CLI_SYNC_FRAME_NS);
+  CHECK(HostSync_FrameTime(90, 100, ref) == ref - 10 * CLI_SYNC_FRAME_NS);
+  // device frame after the wrap, reference before it
+  CHECK(HostSync_FrameTime(5, 2040, ref) == ref + 13 * CLI_SYNC_FRAME_NS);
+  // device frame before the wrap, reference after it
+  CHECK(HostSync_FrameTime(2040, 5, ref) == ref - 13 * CLI_SYNC_FRAME_NS);
+  // farthest frames each way
+  CHECK(HostSync_FrameTime(1023, 0, ref) == ref + 1023 * CLI_SYNC_FRAME_NS);
+  CHECK(HostSync_FrameTime(1024, 0, ref) == ref - 1024 * CLI_SYNC_FRAME_NS);
+}
+
+/**
+  * @brief  TestFit: drift and mapping of a simulated device
+  * @retval None
+  */
+static void TestFit(void)
+{
+  HostSync sync;
+  double expectedPpm = (1.0 / (1.0 + DEVICE_PPM * 1e-6) - 1.0) * 1e6;
+  double error;
+
+  HostSync_Init(&sync);
+  for( uint32_t n = 0; n < HOST_SYNC_SAMPLES; n++ )
+  {
+    // host controller frames start each 1 ms of host time from frame 0
+    uint64_t sofFrame = (uint64_t)REFERENCE_LAG_FRAMES + (uint64_t)n * SAMPLE_FRAMES;
+    uint64_t refFrame = sofFrame - REFERENCE_LAG_FRAMES;
+    uint64_t devNs = DeviceTime(sofFrame * CLI_SYNC_FRAME_NS) + Jitter();
+    char line[96];
+    uint32_t frame;
+    uint64_t parsedNs;
+    uint64_t hostNs;
+
+    snprintf(line, sizeof(line), "frame=%lu t=%lu.%09lu now=0.0",
+             (unsigned long)(sofFrame & CLI_SYNC_FRAME_MASK),
+             (unsigned long)(devNs / NS_PER_S), (unsigned long)(devNs % NS_PER_S));
+    CHECK(HostSync_Parse(line, &frame, &parsedNs) == 0 && parsedNs == devNs);
+
+    hostNs = HostSync_FrameTime(frame, (uint32_t)(refFrame & CLI_SYNC_FRAME_MASK), refFrame * CLI_SYNC_FRAME_NS);
+    CHECK(hostNs == sofFrame * CLI_SYNC_FRAME_NS);
+
+    HostSync_Add(&sync, hostNs, parsedNs);
+  }
+
+  CHECK(HostSync_Fit(&sync) == 0);
+  CHECK(fabs(HostSync_DriftPpm(&sync) - expectedPpm) < MAX_DRIFT_ERROR_PPM);
+
+  error = (double)(int64_t)(HostSync_ToHost(&sync, DeviceTime(MAP_TIME_NS)) - MAP_TIME_NS);
+  CHECK(fabs(error) < MAX_MAP_ERROR_NS);
+
+  printf("drift %.4f ppm (expected %.4f), error at %llu s %.1f ns\n", HostSync_DriftPpm(&sync),
+         expectedPpm, (unsigned long long)(MAP_TIME_NS / NS_PER_S), error);
+}
+
+/**
+  * @brief  DeviceTime: device clock at a host time
+  * @param  hostNs: host time [ns]
+  * @retval Device time [ns]
+  */
+static uint64_t DeviceTime(uint64_t hostNs)
+{
+  return DEVICE_BASE_NS + (uint64_t)llround((double)hostNs * (1.0 + DEVICE_PPM * 1e-6));
+}
+
+/**
+  * @brief  Jitter: SOF interrupt latency, uniform in +-JITTER_NS (fixed sequence)
+  * @retval Jitter [ns]
+  */
+static int32_t Jitter(void)
+{
+  Random = Random * 1103515245UL + 12345UL;
+  return (int32_t)((Random >> 8) % (2 * JITTER_NS + 1)) - JITTER_NS;
+}
@@ -0,0 +1,226 @@
+/**
+  ******************************************************************************
+  * @file    test_txsat.c
+  * @author  Katagiri
+  * @brief   Reply latency of the TX scheduler with the bulk channel saturated.
+  *          The host build of the firmware is driven packet by packet : one
+  *          IN packet completes per step, and the bulk channel is refilled
+  *          to its limit before every step, so streams always have data.
+  *          Each command is written while the stream is running, and the
+  *          packets sent until the first byte of its reply are counted.
+  *          The scheduler puts the reply in the first packet built after the
+  *          request, so it has to leave within two packets : the packet
+  *          already on the endpoint, then the reply.
+  *
+  *          Build : host build of the firmware
+  *            cc -I.. -I<usbd_def.h> -o test_txsat test_txsat.c cli_mux.c ../usbd_cli*.c
+  *          Usage : test_txsat [commands]
+  *            Exits with 1 if a reply waited more than two packets.
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "usbd_cli.h"
+#include "usbd_cli_mux.h"
+#include "usbd_cli_tx.h"
+#include "cli_mux.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+// packets allowed from a request to its reply
+#define MAX_REPLY_PACKETS         2
+
+// packets of stream between commands
+#define STREAM_PACKETS            37
+
+/* Private function prototypes -----------------------------------------------*/
+static uint8_t Transmit(uint8_t* pBuf, uint16_t length);
+static int HostWrite(void* pCtx, const uint8_t* pData, size_t length);
+static void HostReceive(void* pCtx, uint8_t ch, const uint8_t* pData, size_t length);
+static void Step(uint8_t fill);
+static void DeliverOut(void);
+
+/* Private variables ---------------------------------------------------------*/
+static HostMux Mux;
+static uint8_t OutData[4096];         // written by the host, not yet received by the device
+static size_t OutLength;
+static uint8_t* pInPacket;            // packet on the IN endpoint
+static uint16_t InLength;
+static uint8_t InBusy;
+static uint8_t TextMode = 1;          // IN packets are text until the mux starts
+static uint64_t Packets;              // IN packets completed
+static int64_t RequestPacket = -1;    // Packets when the pending command was written
+static uint64_t WorstPackets;         // worst packets from a command to its reply
+static uint64_t StreamBytes;          // bytes received on the bulk channel
+
+/* Exported functions --------------------------------------------------------*/
+int main(int argc, char** argv)
+{
+  unsigned long commands = (1 < argc) ? strtoul(argv[1], NULL, 0) : 50;
+  TxStats stats;
+
+  CLI_Init();
+  CLI_TxInit(Transmit);
+  HostMux_Init(&Mux, HostWrite, NULL);
+  for( uint8_t ch = 0; ch < CLI_MUX_NUM_OF_CHANNELS; ch++ )
+  {
+    HostMux_SetHandler(&Mux, ch, HostReceive, NULL);
+  }
+
+  // first output of text mode, then into multiplexed mode
+  for( int i = 0; i < 10; i++ )
+  {
+    Step(0);
+  }
+  HostMux_Start(&Mux);
+  DeliverOut();
+  TextMode = 0;
+  for( int i = 0; i < 10; i++ )
+  {
+    Step(0);
+  }
+  if( !Mux.open )
+  {
+    fprintf(stderr, "test_txsat: multiplexed mode not started\n");
+    return 2;
+  }
+
+  CLI_TxGetStats(&stats, 1);
+  for( unsigned long n = 0; n < commands; n++ )
+  {
+    for( int i = 0; i < STREAM_PACKETS; i++ )
+    {
+      Step(1);
+    }
+    RequestPacket = (int64_t)Packets;
+    HostMux_Send(&Mux, CLI_MUX_CONTROL, (const uint8_t*)"ARENA\r\n", 7);
+    DeliverOut();
+  }
+  for( int i = 0; i < 200; i++ )
+  {
+    Step(0);
+  }
+
+  CLI_TxGetStats(&stats, 0);
+  printf("commands=%lu replies=%lu worst=%llu packets (max %u) pkt=%lu ctl=%lu stream=%lu err=%lu bulk=%llu\n",
+         commands, (unsigned long)stats.replies, (unsigned long long)WorstPackets, MAX_REPLY_PACKETS,
+         (unsigned long)stats.packets, (unsigned long)stats.controlBytes, (unsigned long)stats.streamBytes,
+         (unsigned long)stats.errors, (unsigned long long)StreamBytes);
+
+  return ( stats.replies == commands && WorstPackets <= MAX_REPLY_PACKETS && StreamBytes != 0 ) ? 0 : 1;
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  Transmit: start transmission on the IN endpoint (TX scheduler)
+  * @param  pBuf: pointer of packet
+  * @param  length: length of packet
+  * @retval 0 on success, 1 if busy
+  */
+static uint8_t Transmit(uint8_t* pBuf, uint16_t length)
+{
+  if( InBusy )
+  {
+    return 1;
+  }
+  pInPacket = pBuf;
+  InLength = length;
+  InBusy = 1;
+  return 0;
+}
+
+/**
+  * @brief  HostWrite: bytes written to the port by the host
+  * @retval 0 on success
+  */
+static int HostWrite(void* pCtx, const uint8_t* pData, size_t length)
+{
+  (void)pCtx;
+  if( sizeof(OutData) - OutLength < length )
+  {
+    return -1;
+  }
+  memcpy(&OutData[OutLength], pData, length);
+  OutLength += length;
+  return 0;
+}
+
+/**
+  * @brief  HostReceive: data of a channel received by the host
+  * @retval None
+  */
+static void HostReceive(void* pCtx, uint8_t ch, const uint8_t* pData, size_t length)
+{
+  (void)pCtx;
+  (void)pData;
+  if( ch != CLI_MUX_CONTROL )
+  {
+    StreamBytes += length;
+    return;
+  }
+  if( 0 <= RequestPacket )
+  {
+    uint64_t wait = Packets - (uint64_t)RequestPacket;
+
+    WorstPackets = (WorstPackets < wait) ? wait : WorstPackets;
+    RequestPacket = -1;
+  }
+}
+
+/**
+  * @brief  Step: complete the packet on the IN endpoint (next packet boundary)
+  * @param  fill: 1 to fill the bulk channel first
+  * @retval None
+  */
+static void Step(uint8_t fill)
+{
+  static uint8_t block[200];
+
+  if( fill )
+  {
+    while( CLI_MuxWrite(CLI_MUX_BULK, block, sizeof(block)) != 0 )
+    {
+    }
+  }
+
+  if( InBusy )
+  {
+    ++Packets;
+    if( !TextMode )
+    {
+      HostMux_Feed(&Mux, pInPacket, InLength);
+    }
+    InBusy = 0;
+    CLI_TxComplete();
+  }
+  else
+  {
+    CLI_TxKick();
+  }
+  DeliverOut();
+}
+
+/**
+  * @brief  DeliverOut: pass bytes written by the host to the device in OUT packets
+  * @retval None
+  */
+static void DeliverOut(void)
+{
+  for( size_t i = 0; i < OutLength; i += CLI_TX_PACKET_SIZE )
+  {
+    uint16_t n = (uint16_t)((OutLength - i < CLI_TX_PACKET_SIZE) ? OutLength - i : CLI_TX_PACKET_SIZE);
+
+    if( CLI_MuxIsActive() )
+    {
+      CLI_MuxInput(&OutData[i], n);
+    }
+    else
+    {
+      CLI_Input(&OutData[i], n);
+    }
+    CLI_TxRequest();
+  }
+  OutLength = 0;
+}
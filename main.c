@@ -44,6 +44,8 @@
   */
 /* Includes ------------------------------------------------------------------*/
 #include "main.h"
+#include "usbd_cli.h"
+#include "usbd_cli_time.h"
   
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
@@ -74,6 +76,9 @@ int main(void)
   /* Configure the system clock to 168 MHz */
   SystemClock_Config();
   
+  /* Start timestamp counter (DWT cycle counter extended to 64 bits) */
+  CLI_TimeInit();
+  
   /* Enable TIMx clock */
   TIMx_CLK_ENABLE();
   
@@ -83,6 +88,12 @@ int main(void)
   /* Enable the TIMx global Interrupt */
   HAL_NVIC_EnableIRQ(TIMx_IRQn);
   
+  /* Init Command Line Interpreter (build command index) */
+  CLI_Init();
+  
+  /* Build serial number string descriptor (not at enumeration) */
+  USBD_VCP_SerialInit();
+  
   /* Init Device Library */
   USBD_Init(&USBD_Device, &VCP_Desc, 0);
   
@@ -28,6 +28,8 @@
 /* Includes ------------------------------------------------------------------*/
 #include "main.h"
 #include "stm32f4xx_it.h"
+#include "usbd_cli_time.h"
+#include "usbd_cli_capture.h"
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
@@ -141,6 +143,14 @@ void PendSV_Handler(void)
 void SysTick_Handler(void)
 {
   HAL_IncTick(); 
+  
+  /* Keep track of the cycle counter wrapping */
+  CLI_TimeUpdate();
+
+#if CLI_CAPTURE_SYSTICK
+  /* Sample of trigger capture (or by a timer of the application) */
+  CLI_CaptureTick();
+#endif
 }
 
 /******************************************************************************/
@@ -45,6 +45,10 @@
 /* Includes ------------------------------------------------------------------*/
 #include "main.h"
 #include "usbd_cli.h"
+#include "usbd_cli_mux.h"
+#include "usbd_cli_tx.h"
+#include "usbd_cli_telem.h"
+#include "usbd_cli_capture.h"
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
@@ -53,7 +57,6 @@
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 uint8_t UsbdRxBuffer[USBD_BUFFER_SIZE]; /* Received Data over USB are stored in this buffer */
-uint8_t UsbdTxBuffer; /* dummy */
 
 /* TIM handler declaration */
 TIM_HandleTypeDef  TimHandle;
@@ -66,6 +69,7 @@ static int8_t CDC_Itf_Init(void);
 static int8_t CDC_Itf_DeInit(void);
 static int8_t CDC_Itf_Control(uint8_t cmd, uint8_t* pbuf, uint16_t length);
 static int8_t CDC_Itf_Receive(uint8_t* pbuf, uint32_t *Len);
+static uint8_t CDC_Itf_Transmit(uint8_t* pbuf, uint16_t length);
 
 static void Error_Handler(void);
 static void TIM_Config(void);
@@ -100,9 +104,11 @@ static int8_t CDC_Itf_Init(void)
   }
   
   /*## Set Application Buffers ############################################*/
-  USBD_CDC_SetTxBuffer(&USBD_Device, &UsbdTxBuffer, 0);
   USBD_CDC_SetRxBuffer(&USBD_Device, UsbdRxBuffer);
   
+  /*## Start TX scheduler, packets are given by CLI_TxKick ################*/
+  CLI_TxInit(CDC_Itf_Transmit);
+  
   return (USBD_OK);
 }
 
@@ -114,6 +120,11 @@ static int8_t CDC_Itf_Init(void)
   */
 static int8_t CDC_Itf_DeInit(void)
 {
+  // back to text mode for the next connection
+  CLI_TxStop();
+  CLI_MuxStop();
+  CLI_SetMode(CLI_MODE_INTERACTIVE);
+  
   return (USBD_OK);
 }
 
@@ -143,11 +154,40 @@ static int8_t CDC_Itf_Receive(uint8_t* Buf, uint32_t *Len)
   // enable receiving again
   USBD_CDC_ReceivePacket(&USBD_Device);
   
-  CLI_Input(Buf, (uint16_t)*Len);
+  if(CLI_MuxIsActive())
+  {
+    CLI_MuxInput(Buf, (uint16_t)*Len);
+  }
+  else
+  {
+    CLI_Input(Buf, (uint16_t)*Len);
+  }
+  
+  // reply at the next packet boundary
+  CLI_TxRequest();
   
   return (USBD_OK);
 }
 
+/**
+  * @brief  CDC_Itf_Transmit
+  *         Start sending a packet built by TX scheduler over USB IN endpoint.
+  *         CLI_TxComplete is called when it has been sent.
+  * @param  pbuf: Buffer of data to be sent
+  * @param  length: Number of data to be sent (in bytes)
+  * @retval 0 if transmission started
+  */
+static uint8_t CDC_Itf_Transmit(uint8_t* pbuf, uint16_t length)
+{
+  USBD_CDC_SetTxBuffer(&USBD_Device, pbuf, length);
+  if(USBD_CDC_TransmitPacket(&USBD_Device) != USBD_OK)
+  {
+    Error_Handler();
+    return 1;
+  }
+  return 0;
+}
+
 /**
   * @brief  TIM period elapsed callback
   * @param  htim: TIM handle
@@ -155,21 +195,19 @@ static int8_t CDC_Itf_Receive(uint8_t* Buf, uint32_t *Len)
   */
 void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
 {
-  uint8_t* pbuf;
-  uint16_t length;
-  
   if(htim->Instance != TIMx)
   {
     return;
   }
   
-  pbuf = CLI_Output();
-  length = (uint16_t)strlen((const char*)pbuf);
-  USBD_CDC_SetTxBuffer(&USBD_Device, pbuf, length);
-  if(USBD_CDC_TransmitPacket(&USBD_Device) != USBD_OK)
-  {
-    Error_Handler();
-  }
+  // telemetry records to the channel, this is the only writer of it
+  CLI_TelemFlush();
+  
+  // captured window to the bulk channel, this is the only writer of it
+  CLI_CapturePump();
+  
+  // send output if the endpoint is idle (otherwise it is sent on transfer complete)
+  CLI_TxKick();
 }
 
 /**
@@ -9,8 +9,65 @@
 #include "usbd_def.h"
 #include "usbd_cli.h"
 #include "usbd_cli_commands.h"
+#include "usbd_cli_cache.h"
+#include "usbd_cli_arena.h"
+#include "usbd_cli_pool.h"
+#include "usbd_cli_scan.h"
+#include "usbd_cli_counter.h"
+#include "usbd_cli_time.h"
+#include "usbd_cli_telem.h"
 
 /* Private typedef -----------------------------------------------------------*/
+// set of commands registered by CLI_RegisterCommands
+typedef struct
+{
+  const CommandUnit* pSet;
+  uint16_t num;
+  uint16_t base;            // opcode of pSet[0]
+} CommandGroup;
+
+// node of command name trie
+//  - commands under a node are CommandIndex[first] ... CommandIndex[first + count - 1]
+//  - if term is set, the name ends at the node and it is CommandIndex[first]
+typedef struct
+{
+  uint8_t c;                // character of the node
+  uint8_t term;             // 1 : a command name ends at this node
+  uint16_t child;           // first child node
+  uint16_t sibling;         // next sibling node
+  uint16_t first;           // index of first command under this node
+  uint16_t count;           // number of commands under this node
+} TrieNode;
+
+// command line and its response
+//  - slots are used in turn, the next line is buffered and run in the next slot
+//    while the response in the current slot is sent
+typedef struct
+{
+  uint8_t Command[CLI_COMMAND_LENGTH];      // store command string
+  uint8_t Response[CLI_RESPONSE_LENGTH];    // store response of command
+  uint16_t IdxIn;                           // index of Command to insert
+  uint16_t IdxOut;                          // index of Command to echo
+  uint8_t* pResponse;                       // pointer of buffer to send to USB Host
+  uint8_t Executed;                         // 1 : command has run, pResponse is valid
+  int8_t Result;                            // result of command (CLI_RESULT_xxx)
+  uint8_t CacheHeld;                        // 1 : pResponse points in response cache
+} CommandSlot;
+
+// session of command line
+//  - the target has one, host build simulates a device per session
+typedef struct
+{
+  CommandSlot Slots[CLI_RESPONSE_BUFFERS];  // command lines and responses
+  uint8_t SlotIn;                           // index of Slots to input
+  uint8_t SlotOut;                          // index of Slots to output
+  CommandSlot* pIn;                         // slot to input
+  CommandSlot* pOut;                        // slot to output
+  uint16_t Status;                          // status of command line interpreter
+  volatile uint8_t Mode;                    // mode of session (CLI_MODE_xxx)
+  uint8_t String_Status[sizeof(CLI_STRING_STATUS) + 4 + sizeof(CLI_STRING_NEWLINE)];  // status line of machine mode
+} CliContext;
+
 /* Private define ------------------------------------------------------------*/
 // message strings
 #define STRING_CMD_OVERFLOW       "Error : Command buffer overflow."
@@ -22,26 +79,38 @@
 #define ERRNO_CMD_NOTFOUND        0
 #define ERRNO_ARG_INVALID         1
 
-// flags of CLI_Status
+// flags of Status of a session
 #define CLI_STATUS_ECHO            0x1
 #define CLI_STATUS_NEWLINE         0x2
 #define CLI_STATUS_PROMPT          0x4
 #define CLI_STATUS_RESPONSE        0x8
 #define CLI_STATUS_BREAK           0x10
 #define CLI_STATUS_BUSY            0x20
-#define CLI_STATUS_CMDOVF          0x100
-#define CLI_STATUS_ERROR_MASK      0xF00
+#define CLI_STATUS_REECHO          0x40
+
+// result of BufferInput
+#define INPUT_CONTINUE             0
+#define INPUT_LINE                 1
+#define INPUT_OVERFLOW             2
+
+// length of newline code
+#define NEWLINE_LENGTH             (sizeof(CLI_STRING_NEWLINE) - 1)
+
+// command name trie
+#define TRIE_NONE                  0xFFFF
+#define TRIE_ROOT                  0
 
 /* Private macro -------------------------------------------------------------*/
-#define IS_STATUS(__FLAG__)                     ((CLI_Status & (__FLAG__)) == (__FLAG__))
-#define IS_ANY_STATUS(__FLAG__)                 ((CLI_Status & (__FLAG__)) != 0)
-#define SET_STATUS(__FLAG__)                    (CLI_Status |= (__FLAG__))
-#define CLEAR_STATUS(__FLAG__)                  (CLI_Status &= ~(__FLAG__)) 
+#define IS_STATUS(__FLAG__)                     ((pCtx->Status & (__FLAG__)) == (__FLAG__))
+#define IS_ANY_STATUS(__FLAG__)                 ((pCtx->Status & (__FLAG__)) != 0)
+#define SET_STATUS(__FLAG__)                    (pCtx->Status |= (__FLAG__))
+#define CLEAR_STATUS(__FLAG__)                  (pCtx->Status &= ~(__FLAG__)) 
 #define UPDATE_STATUS(__SFLAG__, __CFLAG__)     \
   do{                                           \
-    uint16_t tmp = CLI_Status & ~(__CFLAG__);   \
-    CLI_Status = tmp | (__SFLAG__);             \
+    uint16_t tmp = pCtx->Status & ~(__CFLAG__); \
+    pCtx->Status = tmp | (__SFLAG__);           \
   }while(0)
+#define IS_MACHINE()                            (pCtx->Mode == CLI_MODE_MACHINE)
 #define IS_CHAR_VALID(__CHAR__)                 (((__CHAR__ == '\r') || (__CHAR__ == '\n') || (' ' <= __CHAR__ && __CHAR__ <= '~')) ? 1 : 0)
 
 /* Private function prototypes -----------------------------------------------*/
@@ -49,13 +118,35 @@ static void StrTrim(uint8_t **ppStr);
 static void StrTrimR(uint8_t *pStr);
 static void ResponseError(uint8_t* pRes, uint8_t ErrNo);
 static int8_t ResponseError_CmdNotFound(uint8_t* pArg, uint8_t* pRes);
-static int8_t BufferInput(uint8_t *pInput, uint16_t length);
+static int8_t ResponseError_ArgInvalid(uint8_t* pArg, uint8_t* pRes);
+static uint8_t BufferInput(uint8_t *pInput, uint16_t length, uint16_t *pUsed);
+static void ExecuteLine(uint8_t* pResponse);
 static uint8_t* InvokeCommand(void);
-static void ResetBuffer(void);
+static void ResetBuffer(CommandSlot* pSlot);
+static uint8_t* StatusLine(int8_t result);
+static const CommandUnit* FindOpcode(const uint8_t* pOpcode);
+static uint8_t SearchIndex(const char* pName, uint16_t* pPos);
+static void AddToIndex(const CommandUnit* pSet, uint16_t num);
+static void BuildIndex(void);
+static void BuildTrie(void);
+static uint16_t TrieWalk(const char* pStr, uint16_t length);
+static void CompleteCommand(void);
+static void ListCandidates(uint16_t node);
 
 /* Exported function prototypes ----------------------------------------------*/
+void CLI_Init(void);
+int8_t CLI_RegisterCommands(const CommandUnit* pSet, uint16_t num, uint16_t base);
+const CommandUnit* CLI_FindCommand(const char* pName);
+const CommandUnit* CLI_ResolveCommand(const char* pName);
+const CommandUnit* CLI_GetCommand(uint16_t opcode);
+const CommandUnit* CLI_NextCommand(uint16_t* pOpcode);
 int8_t CLI_Input(uint8_t* pBuf, uint16_t dataLength);
+uint8_t CLI_InputReady(void);
 uint8_t* CLI_Output(void);
+void CLI_SetMode(uint8_t mode);
+uint8_t CLI_GetMode(void);
+int8_t CLI_SelectContext(uint16_t index);
+uint16_t CLI_GetContext(void);
 
 /* Private variables ---------------------------------------------------------*/
 static uint8_t String_Newline[] = CLI_STRING_NEWLINE;
@@ -65,55 +156,291 @@ static uint8_t ErrorMessage_Other[]  = STRING_OTHER;
 static uint8_t ErrorMessage_CmdNotFound[] = STRING_CMD_NOTFOUND;
 static uint8_t ErrorMessage_ArgInvalid[] = STRING_ARG_INVALID;
 
-static uint8_t CommandBuffer[CLI_COMMAND_LENGTH];   // store command string
-static uint8_t ResponseBuffer[CLI_RESPONSE_LENGTH];   // store response of command
-static uint16_t CmdBufIdxIn;                          // index of CommandBuffer to insert
-static uint16_t CmdBufIdxOut;                         // index of CommandBuffer to echo
-static uint16_t CLI_Status;                            // status of command line interpreter
-static uint8_t* pResponse;                            // pointer of buffer to send to USB Host
+static CliContext Contexts[CLI_MAX_CONTEXTS];         // sessions
+static CliContext* pCtx = &Contexts[0];               // session selected
+
+static CommandGroup CommandGroups[CLI_MAX_COMMAND_GROUPS];  // command sets registered by modules
+static uint16_t NumOfGroups;                                // number of registered command sets
+static const CommandUnit* CommandIndex[CLI_MAX_COMMANDS];   // all commands sorted by name
+static uint16_t NumOfIndex;                                 // number of commands in CommandIndex
+static uint8_t OverrideSeen;                                // 1 : a name is registered twice, opcodes resolve by name
+static volatile uint8_t IndexValid;                         // 0 : CommandIndex has to be rebuilt
+static TrieNode CommandTrie[CLI_TRIE_NODES];                // trie of command names
+static uint16_t NumOfTrieNodes;                             // number of used nodes in CommandTrie
+static uint8_t TrieValid;                                   // 0 : trie overflowed, exact search only
 
 extern CommandUnit CommandSet[];
 extern const uint16_t NumOfCommands;
 
 /* Exported functions --------------------------------------------------------*/
 /**
-  * @brief  CLI_Input: buffer input characters in command buffer and run command.
-  * @param  pInput: pointer of input string
-  * @param  length: length of input string
-  * @retval Result
+  * @brief  CLI_Init: build the command index and block pools.
+  *         Call this after modules registered their commands, before USBD_Start.
+  * @retval None
   */
-int8_t CLI_Input(uint8_t* pInput, uint16_t length)
+void CLI_Init(void)
+{
+  for(uint16_t i=0; i<CLI_MAX_CONTEXTS; i++)
+  {
+    Contexts[i].pIn = &Contexts[i].Slots[0];
+    Contexts[i].pOut = &Contexts[i].Slots[0];
+  }
+  CLI_PoolInit();
+  BuildIndex();
+}
+
+/**
+  * @brief  CLI_RegisterCommands: add a set of commands to the interpreter.
+  *         The set is not copied, so it has to stay valid (static or const).
+  *         A command with the same name as an already registered one overrides it.
+  *         Registering after CLI_Init is allowed, the index is rebuilt before the next command.
+  *         Opcodes of the set are base to base + num - 1 whatever else is registered,
+  *         each module keeps its own range (CLI_OPCODE_USER_BASE or above).
+  * @param  pSet: pointer of command set
+  * @param  num: number of commands in the set
+  * @param  base: opcode of the first command of the set
+  * @retval Result, CLI_RESULT_FAIL if the opcodes are taken by another set,
+  *         or the set does not fit in the index (CLI_MAX_COMMANDS)
+  */
+int8_t CLI_RegisterCommands(const CommandUnit* pSet, uint16_t num, uint16_t base)
+{
+  uint16_t added = 0;
+  uint16_t pos;
+
+  if( pSet == NULL || num == 0 || CLI_MAX_COMMAND_GROUPS <= NumOfGroups
+      || base < CLI_OPCODE_USER_BASE || 0x10000UL < (uint32_t)base + num )
+  {
+    return CLI_RESULT_FAIL;
+  }
+
+  // opcodes are unique, ranges of sets do not overlap
+  for(uint16_t i=0; i<NumOfGroups; i++)
+  {
+    if( base < (uint32_t)CommandGroups[i].base + CommandGroups[i].num
+        && CommandGroups[i].base < (uint32_t)base + num )
+    {
+      return CLI_RESULT_FAIL;
+    }
+  }
+
+  // new names take entries of the index, no command of the set may be left out
+  if( !IndexValid )
+  {
+    BuildIndex();
+  }
+  for(uint16_t i=0; i<num; i++)
+  {
+    if( !SearchIndex(pSet[i].name, &pos) )
+    {
+      ++added;
+    }
+  }
+  if( CLI_MAX_COMMANDS < NumOfIndex + added )
+  {
+    return CLI_RESULT_FAIL;
+  }
+
+  CommandGroups[NumOfGroups].pSet = pSet;
+  CommandGroups[NumOfGroups].num = num;
+  CommandGroups[NumOfGroups].base = base;
+  ++NumOfGroups;
+  IndexValid = 0;
+
+  return CLI_RESULT_OK;
+}
+
+/**
+  * @brief  CLI_FindCommand: search a command by exact name.
+  * @param  pName: command name
+  * @retval Pointer of the command, NULL if not found
+  */
+const CommandUnit* CLI_FindCommand(const char* pName)
 {
-  // ignore input if busy
-  if( IS_STATUS(CLI_STATUS_BUSY) || length == 0)
+  uint16_t pos;
+
+  if( !IndexValid )
+  {
+    BuildIndex();
+  }
+
+  if( TrieValid )
+  {
+    pos = TrieWalk(pName, (uint16_t)strlen(pName));
+    if( pos != TRIE_NONE && CommandTrie[pos].term )
+    {
+      return CommandIndex[CommandTrie[pos].first];
+    }
+  }
+  else if( SearchIndex(pName, &pos) )
+  {
+    return CommandIndex[pos];
+  }
+  return NULL;
+}
+
+/**
+  * @brief  CLI_ResolveCommand: search a command by exact name or unique abbreviation.
+  *         (e.g. "GET_L" -> "GET_LOG" unless another command starts with "GET_L")
+  * @param  pName: command name or its prefix
+  * @retval Pointer of the command, NULL if not found or ambiguous
+  */
+const CommandUnit* CLI_ResolveCommand(const char* pName)
+{
+  uint16_t node;
+
+  if( !IndexValid )
+  {
+    BuildIndex();
+  }
+
+  if( !TrieValid )
   {
-    return (USBD_OK);
+    return CLI_FindCommand(pName);
   }
 
-  // copy input characters in command buffer.
-  if( BufferInput(pInput, length) != CLI_RESULT_OK )
+  node = TrieWalk(pName, (uint16_t)strlen(pName));
+  if( node == TRIE_NONE || node == TRIE_ROOT )
   {
-    // buffer overflowed occured
-    SET_STATUS(CLI_STATUS_BUSY | CLI_STATUS_CMDOVF);
-    return USBD_OK;
+    return NULL;
   }
+  if( CommandTrie[node].term || CommandTrie[node].count == 1 )
+  {
+    return CommandIndex[CommandTrie[node].first];
+  }
+  return NULL;
+}
+
+/**
+  * @brief  CLI_GetCommand: get a command by its opcode.
+  *         Opcodes are positions in a set : CommandSet from 0, the sets of
+  *         CLI_RegisterCommands from their base. Add new commands at the end
+  *         of a set, then opcodes of existing commands stay.
+  *         The opcode of a command overridden by name runs the command of that name.
+  * @param  opcode: opcode of the command ("#<opcode>" in command line)
+  * @retval Pointer of the command, NULL if no command has the opcode
+  */
+const CommandUnit* CLI_GetCommand(uint16_t opcode)
+{
+  const CommandUnit *pUnit = NULL;
 
-  // search newline code
-  char *pNL = strstr((const char*)CommandBuffer, (const char*)String_Newline);
-  if(pNL == NULL)
+  if( !IndexValid )
   {
-    return (USBD_OK);
+    BuildIndex();
   }
 
-  // terminate command string
-  *pNL = '\0';
+  if( opcode < CLI_OPCODE_USER_BASE )
+  {
+    pUnit = ( opcode < NumOfCommands ) ? &CommandSet[opcode] : NULL;
+  }
+  else
+  {
+    for(uint16_t i=0; i<NumOfGroups; i++)
+    {
+      if( CommandGroups[i].base <= opcode && opcode - CommandGroups[i].base < CommandGroups[i].num )
+      {
+        pUnit = &CommandGroups[i].pSet[opcode - CommandGroups[i].base];
+        break;
+      }
+    }
+  }
+
+  if( pUnit != NULL && OverrideSeen )
+  {
+    pUnit = CLI_FindCommand(pUnit->name);
+  }
+  return pUnit;
+}
+
+/**
+  * @brief  CLI_NextCommand: get the command of the lowest opcode from an opcode
+  *         (opcodes of sets are not contiguous)
+  * @param  pOpcode: opcode to start from, and opcode of the command found
+  * @retval Pointer of the command, NULL if no command has the opcode or a higher one
+  */
+const CommandUnit* CLI_NextCommand(uint16_t* pOpcode)
+{
+  uint32_t next = 0x10000UL;
+
+  if( !IndexValid )
+  {
+    BuildIndex();
+  }
+
+  if( *pOpcode < NumOfCommands && *pOpcode < CLI_OPCODE_USER_BASE )
+  {
+    next = *pOpcode;
+  }
+  else
+  {
+    for(uint16_t i=0; i<NumOfGroups; i++)
+    {
+      uint32_t first = ( *pOpcode < CommandGroups[i].base ) ? CommandGroups[i].base : *pOpcode;
+
+      if( first < (uint32_t)CommandGroups[i].base + CommandGroups[i].num && first < next )
+      {
+        next = first;
+      }
+    }
+  }
+
+  if( 0xFFFFUL < next )
+  {
+    return NULL;
+  }
+  *pOpcode = (uint16_t)next;
+  return CLI_GetCommand(*pOpcode);
+}
+
+/**
+  * @brief  CLI_Input: buffer input characters in command buffer and run command.
+  * @param  pInput: pointer of input string
+  * @param  length: length of input string
+  * @retval Result
+  */
+int8_t CLI_Input(uint8_t* pInput, uint16_t length)
+{
+  uint16_t used;
+
+  CLI_COUNTER_ADD(CLI_CNT_RX_BYTES, length);
+
+  // ignore input if busy (all slots are in use, or candidates of completion are listed)
+  while( !IS_STATUS(CLI_STATUS_BUSY) && 0 < length )
+  {
+    // copy input characters in command buffer until end of line
+    switch( BufferInput(pInput, length, &used) )
+    {
+    case INPUT_LINE:
+      // run command
+      ExecuteLine(InvokeCommand());
+      break;
+
+    case INPUT_OVERFLOW:
+      // buffer overflowed occured, ignore the rest
+      pCtx->pIn->Result = CLI_RESULT_OVERFLOW;
+      ExecuteLine(ErrorMessage_CmdOvf);
+      return (USBD_OK);
+
+    default:
+      break;
+    }
+
+    pInput += used;
+    length -= used;
+  }
+  CLI_COUNTER_ADD(CLI_CNT_RX_DROPS, length);
 
-  // run command
-  pResponse = InvokeCommand();
-  SET_STATUS(CLI_STATUS_BUSY | CLI_STATUS_BREAK);  
   return (USBD_OK);
 }
 
+/**
+  * @brief  CLI_InputReady: check whether input is taken now
+  * @retval 1 if input is buffered, 0 if it is ignored (busy)
+  */
+uint8_t CLI_InputReady(void)
+{
+  return IS_STATUS(CLI_STATUS_BUSY) ? 0 : 1;
+}
+
 /**
   * @brief  CLI_Output: return some string
   * @retval Pointer of the buffer
@@ -122,28 +449,24 @@ uint8_t* CLI_Output(void)
 {
   uint8_t *pOutput = NULL;
   
-  if( IS_ANY_STATUS(CLI_STATUS_ERROR_MASK))
+  if( IS_MACHINE() && IS_STATUS(CLI_STATUS_ECHO | CLI_STATUS_BREAK) )
   {
-    uint16_t error_status;
-
-    if( IS_STATUS(CLI_STATUS_CMDOVF) )
-    {
-      pResponse = ErrorMessage_CmdOvf;
-      error_status = CLI_STATUS_CMDOVF;
-    }
-
-    UPDATE_STATUS(CLI_STATUS_RESPONSE | CLI_STATUS_NEWLINE, error_status | CLI_STATUS_ECHO); 
+    // no echo, go to response at once
+    pCtx->pOut->IdxOut = pCtx->pOut->IdxIn;
+    UPDATE_STATUS(( pCtx->pOut->pResponse[0] != '\0' ) ? CLI_STATUS_RESPONSE : CLI_STATUS_PROMPT,
+                  CLI_STATUS_ECHO | CLI_STATUS_BREAK);
   }
-  else if( IS_STATUS(CLI_STATUS_ECHO) )
+
+  if( IS_STATUS(CLI_STATUS_ECHO) )
   {
-    if( CmdBufIdxOut < CmdBufIdxIn )
+    if( pCtx->pOut->IdxOut < pCtx->pOut->IdxIn && !IS_MACHINE() )
     {
-      pOutput = &CommandBuffer[CmdBufIdxOut];
-      CmdBufIdxOut += (uint16_t)strlen((const char*)&CommandBuffer[CmdBufIdxOut]);
+      pOutput = &pCtx->pOut->Command[pCtx->pOut->IdxOut];
+      pCtx->pOut->IdxOut += (uint16_t)strlen((const char*)&pCtx->pOut->Command[pCtx->pOut->IdxOut]);
 
       if( IS_STATUS(CLI_STATUS_BREAK) )
       {
-        uint16_t next_status = ( 0 < (uint16_t)strlen((const char*)pOutput)) ? CLI_STATUS_RESPONSE : CLI_STATUS_PROMPT;
+        uint16_t next_status = ( pCtx->pOut->pResponse[0] != '\0' ) ? CLI_STATUS_RESPONSE : CLI_STATUS_PROMPT;
         UPDATE_STATUS(next_status | CLI_STATUS_NEWLINE, CLI_STATUS_ECHO | CLI_STATUS_BREAK);
       }
     }
@@ -155,24 +478,94 @@ uint8_t* CLI_Output(void)
   }
   else if( IS_STATUS(CLI_STATUS_RESPONSE) )
   {
-    pOutput = pResponse;
+    pOutput = pCtx->pOut->pResponse;
     UPDATE_STATUS(CLI_STATUS_NEWLINE | CLI_STATUS_PROMPT, CLI_STATUS_RESPONSE);
   }
   else if( IS_STATUS(CLI_STATUS_PROMPT) )
   {
-    pOutput = String_Prompt;
-    ResetBuffer();
-    UPDATE_STATUS(CLI_STATUS_ECHO, CLI_STATUS_PROMPT | CLI_STATUS_BUSY);
+    pOutput = IS_MACHINE() ? StatusLine(pCtx->pOut->Result) : String_Prompt;
+    if( IS_STATUS(CLI_STATUS_REECHO) )
+    {
+      // echo the line being edited again after completion candidates
+      pCtx->pOut->IdxOut = 0;
+    }
+    else
+    {
+      ResetBuffer(pCtx->pOut);
+      if( pCtx->SlotOut != pCtx->SlotIn )
+      {
+        // next line was input while sending response, output it
+        pCtx->SlotOut = (pCtx->SlotOut + 1) % CLI_RESPONSE_BUFFERS;
+        pCtx->pOut = &pCtx->Slots[pCtx->SlotOut];
+        if( pCtx->pOut->Executed )
+        {
+          SET_STATUS(CLI_STATUS_BREAK);
+        }
+        if( IS_STATUS(CLI_STATUS_BUSY) )
+        {
+          // input was waiting for the slot just sent
+          pCtx->SlotIn = (pCtx->SlotIn + 1) % CLI_RESPONSE_BUFFERS;
+          pCtx->pIn = &pCtx->Slots[pCtx->SlotIn];
+        }
+      }
+    }
+    UPDATE_STATUS(CLI_STATUS_ECHO, CLI_STATUS_PROMPT | CLI_STATUS_BUSY | CLI_STATUS_REECHO);
   }
   else  // unexpected error
   {
-    pResponse = ErrorMessage_Other;
+    pCtx->pOut->pResponse = ErrorMessage_Other;
     SET_STATUS(CLI_STATUS_RESPONSE | CLI_STATUS_NEWLINE | CLI_STATUS_BUSY);
   }
   
   return pOutput;
 }
 
+/**
+  * @brief  CLI_SetMode: change mode of the session.
+  *         The response of the running command is already sent in the new mode.
+  * @param  mode: CLI_MODE_INTERACTIVE or CLI_MODE_MACHINE
+  * @retval None
+  */
+void CLI_SetMode(uint8_t mode)
+{
+  pCtx->Mode = mode;
+}
+
+/**
+  * @brief  CLI_GetMode: get mode of the session
+  * @retval CLI_MODE_INTERACTIVE or CLI_MODE_MACHINE
+  */
+uint8_t CLI_GetMode(void)
+{
+  return pCtx->Mode;
+}
+
+/**
+  * @brief  CLI_SelectContext: select the session that the following calls work on.
+  *         CLI_Input, CLI_Output and commands run in it use the selected session.
+  * @param  index: index of session (0 to CLI_MAX_CONTEXTS - 1)
+  * @retval Result
+  */
+int8_t CLI_SelectContext(uint16_t index)
+{
+  if( CLI_MAX_CONTEXTS <= index )
+  {
+    return CLI_RESULT_INVALID;
+  }
+
+  pCtx = &Contexts[index];
+  return CLI_RESULT_OK;
+}
+
+/**
+  * @brief  CLI_GetContext: get the session selected
+  * @retval Index of session
+  */
+uint16_t CLI_GetContext(void)
+{
+  return (uint16_t)(pCtx - Contexts);
+}
+
 /* Private functions ---------------------------------------------------------*/
 /**
   * @brief  StrTrim: Strip leading spaces
@@ -201,7 +594,7 @@ static void StrTrim(uint8_t **ppStr)
   */
 static void StrTrimR(uint8_t* pStr)
 {
-  uint8_t* pEnd = (uint8_t*)((uint32_t)pStr + (uint32_t)strlen((const char*)pStr));
+  uint8_t* pEnd = pStr + strlen((const char*)pStr);
   while(pStr < pEnd)
   {
     --pEnd;
@@ -252,59 +645,147 @@ static void ResponseError(uint8_t* pRes, uint8_t ErrNo)
   * @brief  ResponseError_CmdNotFound: Write error message when command is not found.
   * @param  pArg: pointer of arguments string (just for command function interface)
   * @param  pRes: pointer of buffer
-  * @param  ErrNo: error number
-  * @retval None
+  * @retval CLI_RESULT_NOTFOUND
   */
 static int8_t ResponseError_CmdNotFound(uint8_t* pArg, uint8_t* pRes)
 {
   ResponseError(pRes, ERRNO_CMD_NOTFOUND);
-  return CLI_RESULT_OK;
+  return CLI_RESULT_NOTFOUND;
 }
 
 /**
-  * @brief  BufferInput: buffer input characters in command buffer and run command.
+  * @brief  ResponseError_ArgInvalid: Report invalid arguments without running the command.
+  * @param  pArg: pointer of arguments string (just for command function interface)
+  * @param  pRes: pointer of buffer (just for command function interface)
+  * @retval CLI_RESULT_INVALID
+  */
+static int8_t ResponseError_ArgInvalid(uint8_t* pArg, uint8_t* pRes)
+{
+  return CLI_RESULT_INVALID;
+}
+
+/**
+  * @brief  BufferInput: buffer input characters in command buffer until end of line.
   * @param  pInput: pointer of input string
   * @param  length: length of input string
-  * @retval Result
+  * @param  pUsed: number of input characters consumed
+  * @retval INPUT_LINE if a line is terminated, INPUT_OVERFLOW if buffer is full
   */
-static int8_t BufferInput(uint8_t *pInput, uint16_t length)
+static uint8_t BufferInput(uint8_t *pInput, uint16_t length, uint16_t *pUsed)
 {
-  int8_t result = CLI_RESULT_OK;
-  for(uint32_t i=0; i<length; i++)
+  uint8_t result = INPUT_CONTINUE;
+  uint16_t i;
+  uint16_t n;
+
+  for(i=0; i<length && result == INPUT_CONTINUE; i++)
   {
-    if( IS_CHAR_VALID(pInput[i]) )
+    // printable characters are checked and copied a word at a time, up to a control character
+    n = length - i;
+    if( CLI_COMMAND_LENGTH - 1 - pCtx->pIn->IdxIn < n )
+    {
+      n = CLI_COMMAND_LENGTH - 1 - pCtx->pIn->IdxIn;
+    }
+    n = CLI_ScanCopy(&pInput[i], &pCtx->pIn->Command[pCtx->pIn->IdxIn], n);
+    pCtx->pIn->IdxIn += n;
+    i += n;
+    if( CLI_COMMAND_LENGTH - 1 <= pCtx->pIn->IdxIn )
+    {
+      // keep the last byte for termination
+      result = INPUT_OVERFLOW;
+      break;
+    }
+    if( i == length )
+    {
+      break;
+    }
+
+    if( pInput[i] == '\t' && !IS_MACHINE() )
     {
-      CommandBuffer[CmdBufIdxIn++] = pInput[i];
-      if( CLI_COMMAND_LENGTH <= CmdBufIdxIn)
+      CompleteCommand();
+      if( IS_STATUS(CLI_STATUS_BUSY) )
       {
-        result = CLI_RESULT_FAIL;
+        // candidates are listed, ignore the rest
         break;
       }
     }
+    else if( IS_CHAR_VALID(pInput[i]) )
+    {
+      pCtx->pIn->Command[pCtx->pIn->IdxIn++] = pInput[i];
+      if( pInput[i] == String_Newline[NEWLINE_LENGTH - 1]
+          && NEWLINE_LENGTH <= pCtx->pIn->IdxIn
+          && memcmp(&pCtx->pIn->Command[pCtx->pIn->IdxIn - NEWLINE_LENGTH], String_Newline, NEWLINE_LENGTH) == 0 )
+      {
+        // terminate command string
+        pCtx->pIn->Command[pCtx->pIn->IdxIn - NEWLINE_LENGTH] = '\0';
+        result = INPUT_LINE;
+      }
+      else if( CLI_COMMAND_LENGTH - 1 <= pCtx->pIn->IdxIn )
+      {
+        // keep the last byte for termination
+        result = INPUT_OVERFLOW;
+      }
+    }
   }
+
+  *pUsed = i;
   return result;
 }
 
+/**
+  * @brief  ExecuteLine: finish the input slot and move input to the next slot
+  *         The next slot is used as soon as the response in it has been sent.
+  * @param  pResponse: response of the line
+  * @retval None
+  */
+static void ExecuteLine(uint8_t* pResponse)
+{
+  uint8_t next = (pCtx->SlotIn + 1) % CLI_RESPONSE_BUFFERS;
+
+  pCtx->pIn->pResponse = pResponse;
+  pCtx->pIn->Executed = 1;
+  if( pCtx->SlotIn == pCtx->SlotOut )
+  {
+    SET_STATUS(CLI_STATUS_BREAK);
+  }
+
+  if( next == pCtx->SlotOut )
+  {
+    // no free slot, wait until the output slot is sent
+    SET_STATUS(CLI_STATUS_BUSY);
+  }
+  else
+  {
+    pCtx->SlotIn = next;
+    pCtx->pIn = &pCtx->Slots[pCtx->SlotIn];
+  }
+}
+
 /**
   * @brief  InvokeCommand: search and run a command
   * @retval Pointer of output buffer
   */
 static uint8_t* InvokeCommand(void)
 {
-  uint8_t *pCmd = CommandBuffer;
+  uint8_t *pCmd = pCtx->pIn->Command;
   uint8_t *pArg;
+  const CommandUnit *pUnit;
+  uint8_t *pCached;
   CommandFxn Command = ResponseError_CmdNotFound;
   int8_t result;
+  uint32_t start;
+  uint32_t time;
   
   // strip extra spaces and get entry pointer of command
   StrTrim(&pCmd);
   StrTrimR(pCmd);
 
+  pCtx->pIn->Result = CLI_RESULT_OK;
+
   // response empty if command is empty (all characters are ' '(SP))
   if((uint16_t)strlen((const char*)pCmd) == 0)
   {
-    ResponseBuffer[0] = '\0';
-    return ResponseBuffer;  
+    pCtx->pIn->Response[0] = '\0';
+    return pCtx->pIn->Response;
   }
 
   // get entry pointer of arguments
@@ -316,34 +797,381 @@ static uint8_t* InvokeCommand(void)
     StrTrim(&pArg);        // strip extra leading spaces
   }
 
-  // seek command
-  for(uint16_t i=0; i<NumOfCommands; i++)
+  // seek command, "#<opcode>" is taken from the table directly
+  pUnit = ( *pCmd == CLI_OPCODE_PREFIX ) ? FindOpcode(pCmd + 1) : CLI_ResolveCommand((const char*)pCmd);
+  if(pUnit != NULL)
   {
-    if(strcmp((const char*)pCmd, (const char*)CommandSet[i].name) == 0)
+    // cached response is sent without running the command
+    if(pUnit->flags & CLI_CMD_FLAG_CACHE)
     {
-      Command = CommandSet[i].command;
+      pCached = CLI_CacheLookup(pUnit, pArg);
+      if(pCached != NULL)
+      {
+        // keep the cached response until it is sent
+        CLI_CacheHold();
+        pCtx->pIn->CacheHeld = 1;
+        CLI_COUNTER_INC(CLI_CNT_COMMANDS);
+        CLI_COUNTER_INC(CLI_CNT_CMD_CACHED);
+        return pCached;
+      }
+    }
+
+    Command = pUnit->command;
+
+    // validate arguments, the command gets them by CLI_GetArgs()
+    if(pUnit->args != NULL && CLI_ParseArgs(pArg, pUnit->args, NULL) != CLI_RESULT_OK)
+    {
+      Command = ResponseError_ArgInvalid;
     }
   }
   
-  // run command
-  result = Command(pArg, ResponseBuffer);
+  // run command, and release scratch memory it used
+  start = CLI_TimeNow32();
+  result = Command(pArg, pCtx->pIn->Response);
+  time = CLI_TimeNow32() - start;
+  CLI_GAUGE_SET(CLI_GAUGE_CMD_TIME, time);
+  CLI_TelemSample(CLI_TELEM_CMD_TIME, (int32_t)time);
+  CLI_ArenaReset();
+  pCtx->pIn->Result = result;
+  CLI_COUNTER_INC(CLI_CNT_COMMANDS);
+  if(result != CLI_RESULT_OK)
+  {
+    CLI_COUNTER_INC(CLI_CNT_CMD_ERRORS);
+  }
   if(result == CLI_RESULT_INVALID)
   {
-    ResponseError(ResponseBuffer, ERRNO_ARG_INVALID);
+    ResponseError(pCtx->pIn->Response, ERRNO_ARG_INVALID);
   }
 
-  ResponseBuffer[CLI_RESPONSE_LENGTH - 1] = '\0';
-  return ResponseBuffer;
+  pCtx->pIn->Response[CLI_RESPONSE_LENGTH - 1] = '\0';
+
+  if(result == CLI_RESULT_OK && pUnit != NULL && Command == pUnit->command && (pUnit->flags & CLI_CMD_FLAG_CACHE))
+  {
+    CLI_CacheStore(pUnit, pArg, pCtx->pIn->Response);
+  }
+  return pCtx->pIn->Response;
 }
 
 /**
   * @brief  ResetBuffer: reset command buffer pointer and clear command & response buffer 
+  * @param  pSlot: pointer of slot
+  * @retval None
+  */
+static void ResetBuffer(CommandSlot* pSlot)
+{
+  if( pSlot->CacheHeld )
+  {
+    CLI_CacheRelease();
+  }
+  pSlot->IdxIn = 0;
+  pSlot->IdxOut = 0;
+  pSlot->pResponse = pSlot->Response;
+  pSlot->Executed = 0;
+  pSlot->Result = CLI_RESULT_OK;
+  pSlot->CacheHeld = 0;
+  memset(pSlot->Command, 0, CLI_COMMAND_LENGTH);
+  memset(pSlot->Response, 0, CLI_RESPONSE_LENGTH);
+}
+
+/**
+  * @brief  StatusLine: make status line of machine mode
+  * @param  result: result of command
+  * @retval Pointer of status line
+  */
+static uint8_t* StatusLine(int8_t result)
+{
+  uint8_t idx = sizeof(CLI_STRING_STATUS) - 1;
+  uint8_t value = (result < 0) ? (uint8_t)-result : (uint8_t)result;
+
+  memcpy(pCtx->String_Status, CLI_STRING_STATUS, idx);
+  if( result < 0 )
+  {
+    pCtx->String_Status[idx++] = '-';
+  }
+  if( 100 <= value )
+  {
+    pCtx->String_Status[idx++] = (uint8_t)('0' + value / 100);
+  }
+  if( 10 <= value )
+  {
+    pCtx->String_Status[idx++] = (uint8_t)('0' + value / 10 % 10);
+  }
+  pCtx->String_Status[idx++] = (uint8_t)('0' + value % 10);
+  memcpy(&pCtx->String_Status[idx], CLI_STRING_NEWLINE, sizeof(CLI_STRING_NEWLINE));
+  return pCtx->String_Status;
+}
+
+/**
+  * @brief  FindOpcode: get a command by decimal opcode string
+  * @param  pOpcode: pointer of opcode string
+  * @retval Pointer of the command, NULL if the string is not a valid opcode
+  */
+static const CommandUnit* FindOpcode(const uint8_t* pOpcode)
+{
+  uint32_t opcode = 0;
+
+  if( *pOpcode == '\0' )
+  {
+    return NULL;
+  }
+  for( ; *pOpcode != '\0'; pOpcode++)
+  {
+    if( *pOpcode < '0' || '9' < *pOpcode )
+    {
+      return NULL;
+    }
+    opcode = opcode * 10 + (*pOpcode - '0');
+    if( 0xFFFFUL < opcode )
+    {
+      return NULL;
+    }
+  }
+  return CLI_GetCommand((uint16_t)opcode);
+}
+
+/**
+  * @brief  SearchIndex: binary search of command index
+  * @param  pName: command name
+  * @param  pPos: position of the command, or position to insert it if not found
+  * @retval 1 if found, 0 if not found
+  */
+static uint8_t SearchIndex(const char* pName, uint16_t* pPos)
+{
+  uint16_t lo = 0;
+  uint16_t hi = NumOfIndex;
+
+  while(lo < hi)
+  {
+    uint16_t mid = (lo + hi) / 2;
+    int cmp = strcmp(pName, CommandIndex[mid]->name);
+    if(cmp == 0)
+    {
+      *pPos = mid;
+      return 1;
+    }
+    else if(cmp < 0)
+    {
+      hi = mid;
+    }
+    else
+    {
+      lo = mid + 1;
+    }
+  }
+
+  *pPos = lo;
+  return 0;
+}
+
+/**
+  * @brief  AddToIndex: insert commands in the sorted command index
+  * @param  pSet: pointer of command set
+  * @param  num: number of commands in the set
   * @retval None
   */
-static void ResetBuffer(void)
+static void AddToIndex(const CommandUnit* pSet, uint16_t num)
 {
-  CmdBufIdxIn = 0;
-  CmdBufIdxOut = 0;
-  memset(CommandBuffer, 0, CLI_COMMAND_LENGTH);
-  memset(ResponseBuffer, 0, CLI_RESPONSE_LENGTH);
+  uint16_t pos;
+
+  for(uint16_t i=0; i<num; i++)
+  {
+    if( SearchIndex(pSet[i].name, &pos) )
+    {
+      // later registration overrides the same name (and the opcode of the former)
+      CommandIndex[pos] = &pSet[i];
+      OverrideSeen = 1;
+    }
+    else if( NumOfIndex < CLI_MAX_COMMANDS )
+    {
+      memmove(&CommandIndex[pos + 1], &CommandIndex[pos], (NumOfIndex - pos) * sizeof(CommandIndex[0]));
+      CommandIndex[pos] = &pSet[i];
+      ++NumOfIndex;
+    }
+  }
+}
+
+/**
+  * @brief  BuildIndex: build the sorted command index from CommandSet and registered sets
+  * @retval None
+  */
+static void BuildIndex(void)
+{
+  NumOfIndex = 0;
+  OverrideSeen = 0;
+  AddToIndex(CommandSet, NumOfCommands);
+  for(uint16_t i=0; i<NumOfGroups; i++)
+  {
+    AddToIndex(CommandGroups[i].pSet, CommandGroups[i].num);
+  }
+  BuildTrie();
+  IndexValid = 1;
+}
+
+/**
+  * @brief  BuildTrie: build the trie of command names from the sorted command index
+  * @retval None
+  */
+static void BuildTrie(void)
+{
+  NumOfTrieNodes = 1;
+  CommandTrie[TRIE_ROOT].c = '\0';
+  CommandTrie[TRIE_ROOT].term = 0;
+  CommandTrie[TRIE_ROOT].child = TRIE_NONE;
+  CommandTrie[TRIE_ROOT].sibling = TRIE_NONE;
+  CommandTrie[TRIE_ROOT].first = 0;
+  CommandTrie[TRIE_ROOT].count = NumOfIndex;
+  TrieValid = 1;
+
+  for(uint16_t i=0; i<NumOfIndex; i++)
+  {
+    const char *pName = CommandIndex[i]->name;
+    uint16_t node = TRIE_ROOT;
+
+    for( ; *pName != '\0'; pName++)
+    {
+      // names are inserted in sorted order, so the same character is always the latest child
+      uint16_t child = CommandTrie[node].child;
+      if( child == TRIE_NONE || CommandTrie[child].c != (uint8_t)*pName )
+      {
+        if( CLI_TRIE_NODES <= NumOfTrieNodes )
+        {
+          TrieValid = 0;
+          return;
+        }
+        child = NumOfTrieNodes++;
+        CommandTrie[child].c = (uint8_t)*pName;
+        CommandTrie[child].term = 0;
+        CommandTrie[child].child = TRIE_NONE;
+        CommandTrie[child].sibling = CommandTrie[node].child;
+        CommandTrie[child].first = i;
+        CommandTrie[child].count = 0;
+        CommandTrie[node].child = child;
+      }
+      ++CommandTrie[child].count;
+      node = child;
+    }
+    CommandTrie[node].term = 1;
+  }
+}
+
+/**
+  * @brief  TrieWalk: follow the trie along a string
+  * @param  pStr: pointer of string (need not be terminated)
+  * @param  length: length of string
+  * @retval Node reached, TRIE_NONE if no command starts with the string
+  */
+static uint16_t TrieWalk(const char* pStr, uint16_t length)
+{
+  uint16_t node = TRIE_ROOT;
+
+  for(uint16_t i=0; i<length; i++)
+  {
+    node = CommandTrie[node].child;
+    while( node != TRIE_NONE && CommandTrie[node].c != (uint8_t)pStr[i] )
+    {
+      node = CommandTrie[node].sibling;
+    }
+    if( node == TRIE_NONE )
+    {
+      break;
+    }
+  }
+  return node;
+}
+
+/**
+  * @brief  CompleteCommand: complete command name in command buffer (Tab key)
+  *         - unique : complete the name and add a space
+  *         - several : complete the common part, or list candidates if there is none
+  * @retval None
+  */
+static void CompleteCommand(void)
+{
+  uint8_t *pCmd = pCtx->pIn->Command;
+  uint16_t length;
+  uint16_t node;
+  const char *pRest;
+
+  if( !IndexValid )
+  {
+    BuildIndex();
+  }
+
+  StrTrim(&pCmd);
+  length = (uint16_t)(&pCtx->pIn->Command[pCtx->pIn->IdxIn] - pCmd);
+
+  // only command name is completed
+  if( !TrieValid || memchr(pCmd, ' ', length) != NULL )
+  {
+    return;
+  }
+
+  node = TrieWalk((const char*)pCmd, length);
+  if( node == TRIE_NONE || CommandTrie[node].count == 0 )
+  {
+    return;
+  }
+
+  if( CommandTrie[node].count == 1 )
+  {
+    pRest = &CommandIndex[CommandTrie[node].first]->name[length];
+    while( *pRest != '\0' && pCtx->pIn->IdxIn < CLI_COMMAND_LENGTH - 2 )
+    {
+      pCtx->pIn->Command[pCtx->pIn->IdxIn++] = (uint8_t)*pRest++;
+    }
+    if( *pRest == '\0' )
+    {
+      pCtx->pIn->Command[pCtx->pIn->IdxIn++] = ' ';
+    }
+    return;
+  }
+
+  // complete common part of the candidates
+  length = pCtx->pIn->IdxIn;
+  while( !CommandTrie[node].term
+         && CommandTrie[node].child != TRIE_NONE
+         && CommandTrie[CommandTrie[node].child].sibling == TRIE_NONE
+         && pCtx->pIn->IdxIn < CLI_COMMAND_LENGTH - 1 )
+  {
+    node = CommandTrie[node].child;
+    pCtx->pIn->Command[pCtx->pIn->IdxIn++] = CommandTrie[node].c;
+  }
+
+  // candidates can be listed only when no previous response is being sent
+  if( length == pCtx->pIn->IdxIn && pCtx->SlotIn == pCtx->SlotOut )
+  {
+    ListCandidates(node);
+  }
+}
+
+/**
+  * @brief  ListCandidates: respond names of commands under a trie node
+  * @param  node: trie node
+  * @retval None
+  */
+static void ListCandidates(uint16_t node)
+{
+  uint16_t idx = 0;
+
+  for(uint16_t i=0; i<CommandTrie[node].count; i++)
+  {
+    const char *pName = CommandIndex[CommandTrie[node].first + i]->name;
+    uint16_t length = (uint16_t)strlen(pName);
+
+    if( CLI_RESPONSE_LENGTH - 1 <= idx + length + 2 )
+    {
+      break;
+    }
+    if( 0 < i )
+    {
+      pCtx->pIn->Response[idx++] = ' ';
+      pCtx->pIn->Response[idx++] = ' ';
+    }
+    memcpy(&pCtx->pIn->Response[idx], pName, length);
+    idx += length;
+  }
+  pCtx->pIn->Response[idx] = '\0';
+
+  pCtx->pIn->pResponse = pCtx->pIn->Response;
+  UPDATE_STATUS(CLI_STATUS_NEWLINE | CLI_STATUS_RESPONSE | CLI_STATUS_BUSY | CLI_STATUS_REECHO, CLI_STATUS_ECHO);
 }
@@ -0,0 +1,64 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli.h
+  * @author  Katagiri
+  * @brief   Header file for USB command line interpreter
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CLI_H
+#define __USBD_CLI_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stddef.h>
+
+/* Exported types ------------------------------------------------------------*/
+/* Exported constants --------------------------------------------------------*/
+// result of CLI functions and command functions
+#define CLI_RESULT_OK             0
+#define CLI_RESULT_FAIL           (-1)
+#define CLI_RESULT_INVALID        (-2)
+#define CLI_RESULT_NOTFOUND       (-3)
+#define CLI_RESULT_OVERFLOW       (-4)
+
+// mode of session
+#define CLI_MODE_INTERACTIVE      0     // echo and prompt (default)
+#define CLI_MODE_MACHINE          1     // no echo nor prompt, status line after each response
+
+// size of buffers
+#ifndef CLI_COMMAND_LENGTH
+#define CLI_COMMAND_LENGTH        128
+#endif
+#ifndef CLI_RESPONSE_LENGTH
+#define CLI_RESPONSE_LENGTH       256
+#endif
+
+// number of command/response buffers
+// (2 or more : next command runs while the previous response is sent)
+#ifndef CLI_RESPONSE_BUFFERS
+#define CLI_RESPONSE_BUFFERS      2
+#endif
+
+// number of sessions (1 on target, host build simulates a device per session)
+#ifndef CLI_MAX_CONTEXTS
+#define CLI_MAX_CONTEXTS          1
+#endif
+
+// strings sent to USB Host
+#define CLI_STRING_NEWLINE        "\r\n"
+#define CLI_STRING_PROMPT         "> "
+#define CLI_STRING_STATUS         "$"   // status line of machine mode : "$<result>" CLI_STRING_NEWLINE
+
+/* Exported macro ------------------------------------------------------------*/
+/* Exported functions ------------------------------------------------------- */
+void CLI_Init(void);
+int8_t CLI_Input(uint8_t* pInput, uint16_t length);
+uint8_t CLI_InputReady(void);
+uint8_t* CLI_Output(void);
+void CLI_SetMode(uint8_t mode);
+uint8_t CLI_GetMode(void);
+int8_t CLI_SelectContext(uint16_t index);
+uint16_t CLI_GetContext(void);
+
+#endif /* __USBD_CLI_H */
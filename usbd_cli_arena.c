@@ -0,0 +1,80 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_arena.c
+  * @author  Katagiri
+  * @brief   Source file for USB command line's scratch arena.
+  *          Commands allocate temporary memory with CLI_ArenaAlloc() and the
+  *          interpreter releases all of it at once when the command returns.
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "usbd_cli.h"
+#include "usbd_cli_arena.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+#define ALIGN_UP(__SIZE__)        (((__SIZE__) + (CLI_ARENA_ALIGN - 1)) & ~(uint32_t)(CLI_ARENA_ALIGN - 1))
+
+/* Private function prototypes -----------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static uint64_t Arena[ALIGN_UP(CLI_ARENA_SIZE) / sizeof(uint64_t)];   // scratch memory
+static uint32_t ArenaUsed;                                           // used size
+static uint32_t ArenaHighWater;                                      // max used size
+static uint32_t ArenaFailures;                                       // number of allocations failed
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  CLI_ArenaAlloc: allocate scratch memory for the running command.
+  *         The memory is valid until the command function returns.
+  * @param  size: size of memory
+  * @retval Pointer of memory, NULL if the arena is exhausted
+  */
+void* CLI_ArenaAlloc(uint32_t size)
+{
+  uint8_t *pMem;
+
+  // checked before rounding up, which wraps near UINT32_MAX
+  // (the rest is a multiple of CLI_ARENA_ALIGN, the rounded size still fits)
+  if(sizeof(Arena) - ArenaUsed < size)
+  {
+    ++ArenaFailures;
+    return NULL;
+  }
+  size = ALIGN_UP(size);
+
+  pMem = (uint8_t*)Arena + ArenaUsed;
+  ArenaUsed += size;
+  if(ArenaHighWater < ArenaUsed)
+  {
+    ArenaHighWater = ArenaUsed;
+  }
+  return pMem;
+}
+
+/**
+  * @brief  CLI_ArenaReset: release all scratch memory (called when a command returns)
+  * @retval None
+  */
+void CLI_ArenaReset(void)
+{
+#ifdef CLI_ARENA_DEBUG
+  // catch use of released memory
+  memset(Arena, CLI_ARENA_POISON, ArenaUsed);
+#endif
+  ArenaUsed = 0;
+}
+
+/**
+  * @brief  CLI_ArenaGetStats: get statistics of arena
+  * @param  pStats: pointer of statistics
+  * @retval None
+  */
+void CLI_ArenaGetStats(ArenaStats* pStats)
+{
+  pStats->size = sizeof(Arena);
+  pStats->used = ArenaUsed;
+  pStats->highWater = ArenaHighWater;
+  pStats->failures = ArenaFailures;
+}
@@ -0,0 +1,42 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_arena.h
+  * @author  Katagiri
+  * @brief   Header file for USB command line's scratch arena.
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CLI_ARENA_H
+#define __USBD_CLI_ARENA_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+// size of scratch memory shared by all commands
+#ifndef CLI_ARENA_SIZE
+#define CLI_ARENA_SIZE            1024
+#endif
+
+// alignment of allocated memory
+#define CLI_ARENA_ALIGN           8
+
+// value written to released memory when CLI_ARENA_DEBUG is defined
+#define CLI_ARENA_POISON          0xA5
+
+/* Exported types ------------------------------------------------------------*/
+// statistics of arena
+typedef struct
+{
+  uint32_t size;            // size of arena
+  uint32_t used;            // used size by running command
+  uint32_t highWater;       // max used size since boot
+  uint32_t failures;        // number of allocations failed
+} ArenaStats;
+
+/* Exported functions ------------------------------------------------------- */
+void* CLI_ArenaAlloc(uint32_t size);
+void CLI_ArenaReset(void);
+void CLI_ArenaGetStats(ArenaStats* pStats);
+
+#endif /* __USBD_CLI_ARENA_H */
@@ -0,0 +1,230 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_args.c
+  * @author  Katagiri
+  * @brief   Source file for USB command line's argument parsers.
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "usbd_cli.h"
+#include "usbd_cli_args.h"
+
+/* Private typedef -----------------------------------------------------------*/
+// parsed argument string
+typedef struct
+{
+  const ArgParser* pParser;                   // parser used, NULL if entry is empty
+  uint8_t string[CLI_ARG_CACHE_LENGTH];       // argument string
+  ArgValues values;                           // result
+} ArgCacheEntry;
+
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+/* Private function prototypes -----------------------------------------------*/
+static int8_t ParseNumber(const uint8_t** ppStr, const ArgSpec* pSpec, uint32_t* pValue);
+static int8_t ParseAll(const uint8_t* pArg, const ArgParser* pParser, ArgValues* pValues);
+
+/* Exported variables --------------------------------------------------------*/
+const ArgParser Args_None = { NULL, 0, 0 };
+CLI_ARG_PARSER(Args_AddrLen, 1, CLI_ARG_SPEC_UINT(0, 0xFFFFFFFF), CLI_ARG_SPEC_UINT(1, 0xFFFF));
+CLI_ARG_PARSER(Args_ChValue, 2, CLI_ARG_SPEC_UINT(0, 0xFF), CLI_ARG_SPEC_UINT(0, 0xFFFFFFFF));
+CLI_ARG_PARSER(Args_Flag, 0, CLI_ARG_SPEC_UINT(0, 1));
+
+/* Private variables ---------------------------------------------------------*/
+static ArgCacheEntry ArgCache[CLI_ARG_CACHE_ENTRIES];   // recently parsed argument strings
+static uint8_t ArgCacheNext;                            // entry to be replaced next
+static ArgValues ParsedArgs;                            // result of string which is not cached
+static const ArgValues* pCurrentArgs = &ParsedArgs;     // result of the last parse
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  CLI_ParseArgs: parse and validate arguments string.
+  *         Result of the same string parsed with the same parser is taken from cache.
+  * @param  pArg: pointer of arguments string (NULL if no argument)
+  * @param  pParser: pointer of argument parser
+  * @param  ppValues: pointer to receive parsed values (can be NULL)
+  * @retval CLI_RESULT_OK, CLI_RESULT_INVALID if arguments don't match the parser
+  */
+int8_t CLI_ParseArgs(const uint8_t* pArg, const ArgParser* pParser, const ArgValues** ppValues)
+{
+  ArgCacheEntry *pEntry;
+  uint16_t length;
+
+  if(pArg == NULL || *pArg == '\0')
+  {
+    if(0 < pParser->required)
+    {
+      return CLI_RESULT_INVALID;
+    }
+    ParsedArgs.num = 0;
+    pCurrentArgs = &ParsedArgs;
+  }
+  else
+  {
+    length = (uint16_t)strlen((const char*)pArg);
+
+    // search cache
+    pEntry = NULL;
+    if(length < CLI_ARG_CACHE_LENGTH)
+    {
+      for(uint8_t i=0; i<CLI_ARG_CACHE_ENTRIES; i++)
+      {
+        if(ArgCache[i].pParser == pParser && strcmp((const char*)ArgCache[i].string, (const char*)pArg) == 0)
+        {
+          pEntry = &ArgCache[i];
+          break;
+        }
+      }
+    }
+
+    if(pEntry != NULL)
+    {
+      pCurrentArgs = &pEntry->values;
+    }
+    else
+    {
+      if(ParseAll(pArg, pParser, &ParsedArgs) != CLI_RESULT_OK)
+      {
+        return CLI_RESULT_INVALID;
+      }
+      pCurrentArgs = &ParsedArgs;
+
+      if(length < CLI_ARG_CACHE_LENGTH)
+      {
+        pEntry = &ArgCache[ArgCacheNext];
+        pEntry->pParser = pParser;
+        memcpy(pEntry->string, pArg, length + 1);
+        pEntry->values = ParsedArgs;
+        ArgCacheNext = (ArgCacheNext + 1) % CLI_ARG_CACHE_ENTRIES;
+      }
+    }
+  }
+
+  if(ppValues != NULL)
+  {
+    *ppValues = pCurrentArgs;
+  }
+  return CLI_RESULT_OK;
+}
+
+/**
+  * @brief  CLI_GetArgs: get arguments parsed for the running command.
+  * @retval Pointer of parsed values
+  */
+const ArgValues* CLI_GetArgs(void)
+{
+  return pCurrentArgs;
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  ParseAll: parse all arguments
+  * @param  pArg: pointer of arguments string
+  * @param  pParser: pointer of argument parser
+  * @param  pValues: pointer of parsed values
+  * @retval Result
+  */
+static int8_t ParseAll(const uint8_t* pArg, const ArgParser* pParser, ArgValues* pValues)
+{
+  pValues->num = 0;
+
+  while(*pArg != '\0')
+  {
+    if(pParser->num <= pValues->num || CLI_MAX_ARGS <= pValues->num)
+    {
+      // too many arguments
+      return CLI_RESULT_INVALID;
+    }
+    if(ParseNumber(&pArg, &pParser->pSpec[pValues->num], &pValues->value[pValues->num]) != CLI_RESULT_OK)
+    {
+      return CLI_RESULT_INVALID;
+    }
+    ++pValues->num;
+
+    while(*pArg == ' ')
+    {
+      ++pArg;
+    }
+  }
+
+  return (pParser->required <= pValues->num) ? CLI_RESULT_OK : CLI_RESULT_INVALID;
+}
+
+/**
+  * @brief  ParseNumber: parse a number and check its range
+  * @param  ppStr: pointer to pointer of string, moved to the end of the number
+  * @param  pSpec: pointer of argument specification
+  * @param  pValue: pointer of value
+  * @retval Result
+  */
+static int8_t ParseNumber(const uint8_t** ppStr, const ArgSpec* pSpec, uint32_t* pValue)
+{
+  const uint8_t *pStr = *ppStr;
+  uint32_t base = 10;
+  uint32_t value = 0;
+  uint32_t limit;
+  uint8_t negative = 0;
+  uint8_t digits = 0;
+
+  if(pSpec->type == CLI_ARG_INT && *pStr == '-')
+  {
+    negative = 1;
+    ++pStr;
+  }
+  else if(pSpec->type == CLI_ARG_UINT && pStr[0] == '0' && (pStr[1] == 'x' || pStr[1] == 'X'))
+  {
+    base = 16;
+    pStr += 2;
+  }
+
+  limit = (pSpec->type == CLI_ARG_INT) ? (uint32_t)INT32_MAX + negative : UINT32_MAX;
+
+  for( ; *pStr != ' ' && *pStr != '\0'; pStr++, digits++)
+  {
+    uint32_t digit;
+
+    if('0' <= *pStr && *pStr <= '9')
+    {
+      digit = *pStr - '0';
+    }
+    else if(base == 16 && 'a' <= (*pStr | 0x20) && (*pStr | 0x20) <= 'f')
+    {
+      digit = (*pStr | 0x20) - 'a' + 10;
+    }
+    else
+    {
+      return CLI_RESULT_INVALID;
+    }
+
+    if((limit - digit) / base < value)
+    {
+      // overflow
+      return CLI_RESULT_INVALID;
+    }
+    value = value * base + digit;
+  }
+
+  if(digits == 0)
+  {
+    return CLI_RESULT_INVALID;
+  }
+
+  if(pSpec->type == CLI_ARG_INT)
+  {
+    int32_t svalue = negative ? (int32_t)(0 - value) : (int32_t)value;
+    if(svalue < (int32_t)pSpec->min || (int32_t)pSpec->max < svalue)
+    {
+      return CLI_RESULT_INVALID;
+    }
+    value = (uint32_t)svalue;
+  }
+  else if(value < pSpec->min || pSpec->max < value)
+  {
+    return CLI_RESULT_INVALID;
+  }
+
+  *pValue = value;
+  *ppStr = pStr;
+  return CLI_RESULT_OK;
+}
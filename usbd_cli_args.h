@@ -0,0 +1,85 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_args.h
+  * @author  Katagiri
+  * @brief   Header file for USB command line's argument parsers.
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CLI_ARGS_H
+#define __USBD_CLI_ARGS_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+// max number of arguments of a parser
+#ifndef CLI_MAX_ARGS
+#define CLI_MAX_ARGS              4
+#endif
+
+// number of parsed argument strings kept in cache
+#ifndef CLI_ARG_CACHE_ENTRIES
+#define CLI_ARG_CACHE_ENTRIES     4
+#endif
+
+// max length of argument string kept in cache (longer strings are always parsed)
+#ifndef CLI_ARG_CACHE_LENGTH
+#define CLI_ARG_CACHE_LENGTH      32
+#endif
+
+// type of argument
+#define CLI_ARG_UINT              0   // unsigned, decimal or hexadecimal with "0x"
+#define CLI_ARG_INT               1   // signed decimal
+
+/* Exported types ------------------------------------------------------------*/
+// specification of an argument
+typedef struct
+{
+  uint8_t type;             // CLI_ARG_xxx
+  uint32_t min;             // minimum value (int32_t for CLI_ARG_INT)
+  uint32_t max;             // maximum value (int32_t for CLI_ARG_INT)
+} ArgSpec;
+
+// argument parser : list of argument specifications
+typedef struct
+{
+  const ArgSpec* pSpec;     // specifications in order of arguments
+  uint8_t num;              // number of arguments
+  uint8_t required;         // number of arguments which can not be omitted
+} ArgParser;
+
+// parsed arguments
+typedef struct
+{
+  uint8_t num;                      // number of given arguments
+  uint32_t value[CLI_MAX_ARGS];     // values (cast to int32_t for CLI_ARG_INT)
+} ArgValues;
+
+/* Exported macro ------------------------------------------------------------*/
+// define an argument parser in flash
+//   e.g. CLI_ARG_PARSER(Args_Pin, 1, CLI_ARG_SPEC_UINT(0, 15), CLI_ARG_SPEC_UINT(0, 1));
+#define CLI_ARG_PARSER(__NAME__, __REQUIRED__, ...)                             \
+  static const ArgSpec __NAME__##_Spec[] = { __VA_ARGS__ };                     \
+  const ArgParser __NAME__ =                                                    \
+  {                                                                             \
+    __NAME__##_Spec,                                                            \
+    (uint8_t)(sizeof(__NAME__##_Spec) / sizeof(ArgSpec)),                       \
+    (__REQUIRED__)                                                              \
+  }
+
+#define CLI_ARG_SPEC_UINT(__MIN__, __MAX__)     { CLI_ARG_UINT, (uint32_t)(__MIN__), (uint32_t)(__MAX__) }
+#define CLI_ARG_SPEC_INT(__MIN__, __MAX__)      { CLI_ARG_INT, (uint32_t)(int32_t)(__MIN__), (uint32_t)(int32_t)(__MAX__) }
+
+/* Exported variables --------------------------------------------------------*/
+// common argument shapes
+extern const ArgParser Args_None;           // no argument
+extern const ArgParser Args_AddrLen;        // <address> [<length>]
+extern const ArgParser Args_ChValue;        // <channel> <value>
+extern const ArgParser Args_Flag;           // [<0|1>]
+
+/* Exported functions ------------------------------------------------------- */
+int8_t CLI_ParseArgs(const uint8_t* pArg, const ArgParser* pParser, const ArgValues** ppValues);
+const ArgValues* CLI_GetArgs(void);
+
+#endif /* __USBD_CLI_ARGS_H */
@@ -0,0 +1,317 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_bench.c
+  * @author  Katagiri
+  * @brief   Source file for USB command line's benchmark registry.
+  *          Kernels are registered by name in sets like commands, and BENCH
+  *          runs one of them: warmup iterations first, then the measured
+  *          iterations and the same number of calls of an empty kernel as
+  *          baseline (cost of the call itself).
+  *          BENCH runs in the USB OUT interrupt, so the CDC timer and USB
+  *          itself, at the same priority, wait for the whole run : a run stops
+  *          at the first chunk past CLI_BENCH_TIME_MAX, and the result has the
+  *          iterations actually run. Interrupts of higher priority are masked
+  *          in chunks of CLI_BENCH_CHUNK iterations, so they are held off one
+  *          chunk at most and not counted in the times.
+  *          Time is counted by usbd_cli_time.h : DWT cycles on target, ns on
+  *          host build, so the same kernels run on both.
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "usbd_cli.h"
+#include "usbd_cli_commands.h"
+#include "usbd_cli_bench.h"
+#include "usbd_cli_scan.h"
+#include "usbd_cli_time.h"
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+#include "stm32f4xx.h"
+#endif
+
+/* Private typedef -----------------------------------------------------------*/
+// registered set of benchmarks
+typedef struct
+{
+  const BenchUnit* pSet;
+  uint16_t num;
+} BenchGroup;
+
+/* Private define ------------------------------------------------------------*/
+// size of data of memcpy kernels (a USB packet)
+#define COPY_LENGTH               64
+
+/* Private macro -------------------------------------------------------------*/
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t BenchEmpty(uint32_t iteration);
+static uint32_t BenchMemcpy(uint32_t iteration);
+static uint32_t BenchMemcpyByte(uint32_t iteration);
+static uint32_t BenchFormat(uint32_t iteration);
+static uint32_t BenchLookup(uint32_t iteration);
+static uint32_t RunKernel(BenchFxn kernel, uint32_t first, uint32_t iterations);
+static uint32_t MaskIrq(void);
+static void UnmaskIrq(uint32_t state);
+
+/* Private variables ---------------------------------------------------------*/
+static const BenchUnit BuiltinSet[] =
+{
+  {"memcpy", BenchMemcpy},
+  {"memcpy_byte", BenchMemcpyByte},
+  {"format", BenchFormat},
+  {"lookup", BenchLookup},
+  {"scan", CLI_ScanBenchWord},
+  {"scan_byte", CLI_ScanBenchByte},
+};
+
+static BenchGroup BenchGroups[CLI_MAX_BENCH_GROUPS] =
+{
+  { BuiltinSet, sizeof(BuiltinSet) / sizeof(BenchUnit) },
+};
+static uint16_t NumOfBenchGroups = 1;
+
+static volatile uint32_t BenchSink;     // keeps results of kernels alive
+static uint8_t CopySrc[COPY_LENGTH + 1];
+static uint8_t CopyDst[COPY_LENGTH + 1];
+static char FormatBuf[48];
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  CLI_RegisterBenchmarks: add a set of benchmarks.
+  *         The set is not copied, so it has to stay valid (static or const).
+  *         Names starting with a digit are rejected, BENCH lists from a number.
+  * @param  pSet: pointer of benchmark set
+  * @param  num: number of benchmarks in the set
+  * @retval Result
+  */
+int8_t CLI_RegisterBenchmarks(const BenchUnit* pSet, uint16_t num)
+{
+  if( pSet == NULL || num == 0 || CLI_MAX_BENCH_GROUPS <= NumOfBenchGroups )
+  {
+    return CLI_RESULT_FAIL;
+  }
+  for(uint16_t i=0; i<num; i++)
+  {
+    if( '0' <= pSet[i].name[0] && pSet[i].name[0] <= '9' )
+    {
+      return CLI_RESULT_FAIL;
+    }
+  }
+
+  BenchGroups[NumOfBenchGroups].pSet = pSet;
+  BenchGroups[NumOfBenchGroups].num = num;
+  ++NumOfBenchGroups;
+
+  return CLI_RESULT_OK;
+}
+
+/**
+  * @brief  CLI_FindBenchmark: search a benchmark by name
+  * @param  pName: name
+  * @retval Pointer of benchmark, NULL if not found
+  */
+const BenchUnit* CLI_FindBenchmark(const char* pName)
+{
+  const BenchUnit *pUnit;
+
+  for(uint16_t i=0; (pUnit = CLI_GetBenchmark(i)) != NULL; i++)
+  {
+    if( strcmp(pUnit->name, pName) == 0 )
+    {
+      return pUnit;
+    }
+  }
+  return NULL;
+}
+
+/**
+  * @brief  CLI_GetBenchmark: get a benchmark in order of registration
+  * @param  index: index of benchmark
+  * @retval Pointer of benchmark, NULL if out of range
+  */
+const BenchUnit* CLI_GetBenchmark(uint16_t index)
+{
+  for(uint16_t g=0; g<NumOfBenchGroups; g++)
+  {
+    if( index < BenchGroups[g].num )
+    {
+      return &BenchGroups[g].pSet[index];
+    }
+    index -= BenchGroups[g].num;
+  }
+  return NULL;
+}
+
+/**
+  * @brief  CLI_RunBenchmark: run a benchmark, interrupts masked in each chunk of iterations
+  * @param  pUnit: pointer of benchmark
+  * @param  iterations: number of iterations (1 to CLI_BENCH_MAX_ITERATIONS)
+  * @param  pResult: pointer of result (iterations : fewer past CLI_BENCH_TIME_MAX, one chunk at least)
+  * @retval Result
+  */
+int8_t CLI_RunBenchmark(const BenchUnit* pUnit, uint32_t iterations, BenchResult* pResult)
+{
+  uint32_t irqState;
+  uint32_t chunk;
+  uint32_t n = 0;
+  uint32_t limit = (uint32_t)CLI_TimeFromUs(CLI_BENCH_TIME_MAX);
+  uint32_t start;
+
+  if( pUnit == NULL || iterations == 0 || CLI_BENCH_MAX_ITERATIONS < iterations )
+  {
+    return CLI_RESULT_INVALID;
+  }
+
+  // the limit includes warmup and baseline, it is the time the interrupt is held
+  start = CLI_TimeNow32();
+
+  // iterations are numbered from 0 through warmup, kernels set up their data at 0
+  RunKernel(pUnit->kernel, 0, CLI_BENCH_WARMUP);
+  RunKernel(BenchEmpty, 0, CLI_BENCH_WARMUP);
+
+  // times are taken inside each chunk, interrupts served between chunks are not counted
+  pResult->baseline = 0;
+  pResult->time = 0;
+  do
+  {
+    chunk = (iterations - n < CLI_BENCH_CHUNK) ? iterations - n : CLI_BENCH_CHUNK;
+
+    irqState = MaskIrq();
+    pResult->baseline += RunKernel(BenchEmpty, CLI_BENCH_WARMUP + n, chunk);
+    UnmaskIrq(irqState);
+
+    irqState = MaskIrq();
+    pResult->time += RunKernel(pUnit->kernel, CLI_BENCH_WARMUP + n, chunk);
+    UnmaskIrq(irqState);
+    n += chunk;
+  } while( n < iterations && CLI_TimeNow32() - start < limit );
+
+  pResult->iterations = n;
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+  pResult->unit = "cyc";
+#else
+  pResult->unit = "ns";
+#endif
+  pResult->target = CLI_BENCH_TARGET;
+  return CLI_RESULT_OK;
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  RunKernel: run iterations of a kernel
+  * @param  kernel: kernel
+  * @param  first: number of the first iteration
+  * @param  iterations: number of iterations
+  * @retval Time [count]
+  */
+static uint32_t RunKernel(BenchFxn kernel, uint32_t first, uint32_t iterations)
+{
+  BenchFxn volatile call = kernel;      // called through a pointer as registered kernels
+  uint32_t sink = 0;
+  uint32_t start = CLI_TimeNow32();
+
+  for(uint32_t n=first; n<first + iterations; n++)
+  {
+    sink ^= call(n);
+  }
+  start = CLI_TimeNow32() - start;
+  BenchSink = sink;
+  return start;
+}
+
+/**
+  * @brief  BenchEmpty: baseline kernel
+  * @param  iteration: number of iteration
+  * @retval Iteration
+  */
+static uint32_t BenchEmpty(uint32_t iteration)
+{
+  return iteration;
+}
+
+/**
+  * @brief  BenchMemcpy: BENCH kernel "memcpy", a packet by memcpy
+  * @param  iteration: number of iteration (odd : source not aligned)
+  * @retval First byte copied
+  */
+static uint32_t BenchMemcpy(uint32_t iteration)
+{
+  memcpy(CopyDst, &CopySrc[iteration & 1], COPY_LENGTH);
+  return CopyDst[0];
+}
+
+/**
+  * @brief  BenchMemcpyByte: BENCH kernel "memcpy_byte", a packet one byte at a time
+  * @param  iteration: number of iteration (odd : source not aligned)
+  * @retval First byte copied
+  */
+static uint32_t BenchMemcpyByte(uint32_t iteration)
+{
+  volatile uint8_t *pDst = CopyDst;     // not turned into memcpy by the compiler
+  const uint8_t *pSrc = &CopySrc[iteration & 1];
+
+  for(uint16_t i=0; i<COPY_LENGTH; i++)
+  {
+    pDst[i] = pSrc[i];
+  }
+  return CopyDst[0];
+}
+
+/**
+  * @brief  BenchFormat: BENCH kernel "format", a response of statistics by snprintf
+  * @param  iteration: number of iteration
+  * @retval Length formatted
+  */
+static uint32_t BenchFormat(uint32_t iteration)
+{
+  return (uint32_t)snprintf(FormatBuf, sizeof(FormatBuf), "pkt=%lu zlp=%lu err=%lu",
+                            (unsigned long)iteration * 7919UL, (unsigned long)iteration >> 3,
+                            (unsigned long)iteration & 0xF);
+}
+
+/**
+  * @brief  BenchLookup: BENCH kernel "lookup", exact search of command names
+  *         (a short name, a long name, a name not found and a prefix in turn)
+  * @param  iteration: number of iteration
+  * @retval 1 if found
+  */
+static uint32_t BenchLookup(uint32_t iteration)
+{
+  static const char* const names[4] = { "MODE", "USB_ENUM_TRACE", "NOTHING", "TX" };
+
+  return (CLI_FindCommand(names[iteration & 3]) != NULL) ? 1 : 0;
+}
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+/**
+  * @brief  MaskIrq: mask interrupts
+  * @retval State to restore
+  */
+static uint32_t MaskIrq(void)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  return primask;
+}
+
+/**
+  * @brief  UnmaskIrq: restore interrupt mask
+  * @param  state: state returned by MaskIrq
+  * @retval None
+  */
+static void UnmaskIrq(uint32_t state)
+{
+  __set_PRIMASK(state);
+}
+
+#else
+/* Host build (simulation) : no interrupts */
+static uint32_t MaskIrq(void)
+{
+  return 0;
+}
+
+static void UnmaskIrq(uint32_t state)
+{
+}
+#endif
@@ -0,0 +1,77 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_bench.h
+  * @author  Katagiri
+  * @brief   Header file for USB command line's benchmark registry.
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CLI_BENCH_H
+#define __USBD_CLI_BENCH_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+// max number of benchmark sets registered by CLI_RegisterBenchmarks
+#ifndef CLI_MAX_BENCH_GROUPS
+#define CLI_MAX_BENCH_GROUPS      8
+#endif
+
+// max iterations of a run
+#ifndef CLI_BENCH_MAX_ITERATIONS
+#define CLI_BENCH_MAX_ITERATIONS  100000
+#endif
+
+// max time of a run [us] (the run is in the USB interrupt, fewer iterations are run past it)
+#ifndef CLI_BENCH_TIME_MAX
+#define CLI_BENCH_TIME_MAX        5000
+#endif
+
+// iterations run with interrupts masked at a time (keep it short for the slowest kernel)
+#ifndef CLI_BENCH_CHUNK
+#define CLI_BENCH_CHUNK           32
+#endif
+
+// target reported by BENCH, results of different targets are kept apart (no spaces)
+#ifndef CLI_BENCH_TARGET
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+#define CLI_BENCH_TARGET          "stm32f4"
+#else
+#define CLI_BENCH_TARGET          "host"
+#endif
+#endif
+
+// iterations run before measurement (caches, branch predictors, lazy initialization)
+#ifndef CLI_BENCH_WARMUP
+#define CLI_BENCH_WARMUP          16
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+// kernel : one iteration, returns any value depending on the work (kept from optimization)
+typedef uint32_t (*BenchFxn)(uint32_t iteration);
+
+// benchmark
+typedef struct
+{
+  const char* name;         // name given to BENCH (not starting with a digit)
+  BenchFxn kernel;          // kernel
+} BenchUnit;
+
+// result of benchmark
+typedef struct
+{
+  uint32_t iterations;      // number of iterations measured (fewer than asked past CLI_BENCH_TIME_MAX)
+  uint32_t time;            // time of all iterations [count] (usbd_cli_time.h)
+  uint32_t baseline;        // time of the same number of empty kernel calls [count]
+  const char* unit;         // unit of count ("cyc" : DWT cycles, "ns" : host clock)
+  const char* target;       // target it ran on (CLI_BENCH_TARGET)
+} BenchResult;
+
+/* Exported functions ------------------------------------------------------- */
+int8_t CLI_RegisterBenchmarks(const BenchUnit* pSet, uint16_t num);
+const BenchUnit* CLI_FindBenchmark(const char* pName);
+const BenchUnit* CLI_GetBenchmark(uint16_t index);
+int8_t CLI_RunBenchmark(const BenchUnit* pUnit, uint32_t iterations, BenchResult* pResult);
+
+#endif /* __USBD_CLI_BENCH_H */
@@ -0,0 +1,161 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_cache.c
+  * @author  Katagiri
+  * @brief   Source file for USB command line's response cache.
+  *          Responses of commands flagged with CLI_CMD_FLAG_CACHE are kept
+  *          with their arguments and sent again without running the command.
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "usbd_cli.h"
+#include "usbd_cli_cache.h"
+
+/* Private typedef -----------------------------------------------------------*/
+// cached response
+typedef struct
+{
+  const CommandUnit* pUnit;     // command, NULL if invalidated
+  uint16_t arg;                 // offset of arguments string in CacheSegment
+  uint16_t res;                 // offset of response string in CacheSegment
+} CacheEntry;
+
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+/* Private function prototypes -----------------------------------------------*/
+static void FlushCache(void);
+
+/* Private variables ---------------------------------------------------------*/
+static CacheEntry CacheEntries[CLI_RESPONSE_CACHE_ENTRIES];   // cached responses
+static uint8_t NumOfEntries;                                 // number of used entries
+static uint8_t CacheSegment[CLI_RESPONSE_CACHE_SIZE];         // arguments and responses
+static uint16_t SegmentUsed;                                 // used size of CacheSegment
+static uint8_t HoldCount;                                    // number of cached responses being sent
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  CLI_CacheLookup: search a cached response
+  * @param  pUnit: pointer of command
+  * @param  pArg: pointer of arguments string (NULL if no argument)
+  * @retval Pointer of response in cache, NULL if not cached
+  */
+uint8_t* CLI_CacheLookup(const CommandUnit* pUnit, const uint8_t* pArg)
+{
+  const char *pKey = (pArg != NULL) ? (const char*)pArg : "";
+
+  for(uint8_t i=0; i<NumOfEntries; i++)
+  {
+    if(CacheEntries[i].pUnit == pUnit && strcmp((const char*)&CacheSegment[CacheEntries[i].arg], pKey) == 0)
+    {
+      return &CacheSegment[CacheEntries[i].res];
+    }
+  }
+  return NULL;
+}
+
+/**
+  * @brief  CLI_CacheStore: keep a response in cache
+  *         The whole cache is flushed when it is full.
+  * @param  pUnit: pointer of command
+  * @param  pArg: pointer of arguments string (NULL if no argument)
+  * @param  pRes: pointer of response string
+  * @retval None
+  */
+void CLI_CacheStore(const CommandUnit* pUnit, const uint8_t* pArg, const uint8_t* pRes)
+{
+  const char *pKey = (pArg != NULL) ? (const char*)pArg : "";
+  uint16_t argLength = (uint16_t)strlen(pKey) + 1;
+  uint16_t resLength = (uint16_t)strlen((const char*)pRes) + 1;
+  CacheEntry *pEntry;
+
+  if(CLI_RESPONSE_CACHE_SIZE < argLength + resLength)
+  {
+    // never fits
+    return;
+  }
+
+  if(CLI_RESPONSE_CACHE_ENTRIES <= NumOfEntries || CLI_RESPONSE_CACHE_SIZE < SegmentUsed + argLength + resLength)
+  {
+    if(0 < HoldCount)
+    {
+      // a cached response is being sent, it must not be overwritten
+      return;
+    }
+    FlushCache();
+  }
+
+  pEntry = &CacheEntries[NumOfEntries++];
+  pEntry->pUnit = pUnit;
+  pEntry->arg = SegmentUsed;
+  memcpy(&CacheSegment[SegmentUsed], pKey, argLength);
+  SegmentUsed += argLength;
+  pEntry->res = SegmentUsed;
+  memcpy(&CacheSegment[SegmentUsed], pRes, resLength);
+  SegmentUsed += resLength;
+}
+
+/**
+  * @brief  CLI_InvalidateResponse: discard cached responses of a command.
+  *         Call this when the state reported by the command is changed.
+  *         Must be called from the same interrupt priority as CLI_Input.
+  * @param  pName: command name, NULL to discard all responses
+  * @retval None
+  */
+void CLI_InvalidateResponse(const char* pName)
+{
+  uint8_t valid = 0;
+
+  for(uint8_t i=0; i<NumOfEntries; i++)
+  {
+    if(CacheEntries[i].pUnit == NULL)
+    {
+      continue;
+    }
+    if(pName == NULL || strcmp(CacheEntries[i].pUnit->name, pName) == 0)
+    {
+      CacheEntries[i].pUnit = NULL;
+    }
+    else
+    {
+      valid = 1;
+    }
+  }
+
+  if(!valid && HoldCount == 0)
+  {
+    FlushCache();
+  }
+}
+
+/**
+  * @brief  CLI_CacheHold: keep responses in the segment while one of them is sent
+  * @retval None
+  */
+void CLI_CacheHold(void)
+{
+  ++HoldCount;
+}
+
+/**
+  * @brief  CLI_CacheRelease: a held response has been sent
+  * @retval None
+  */
+void CLI_CacheRelease(void)
+{
+  if(0 < HoldCount)
+  {
+    --HoldCount;
+  }
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  FlushCache: discard all cached responses
+  * @retval None
+  */
+static void FlushCache(void)
+{
+  NumOfEntries = 0;
+  SegmentUsed = 0;
+}
@@ -0,0 +1,34 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_cache.h
+  * @author  Katagiri
+  * @brief   Header file for USB command line's response cache.
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CLI_CACHE_H
+#define __USBD_CLI_CACHE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "usbd_cli_commands.h"
+
+/* Exported constants --------------------------------------------------------*/
+// max number of cached responses
+#ifndef CLI_RESPONSE_CACHE_ENTRIES
+#define CLI_RESPONSE_CACHE_ENTRIES    4
+#endif
+
+// size of segment storing arguments and responses of cached commands
+#ifndef CLI_RESPONSE_CACHE_SIZE
+#define CLI_RESPONSE_CACHE_SIZE       512
+#endif
+
+/* Exported functions ------------------------------------------------------- */
+uint8_t* CLI_CacheLookup(const CommandUnit* pUnit, const uint8_t* pArg);
+void CLI_CacheStore(const CommandUnit* pUnit, const uint8_t* pArg, const uint8_t* pRes);
+void CLI_InvalidateResponse(const char* pName);
+void CLI_CacheHold(void);
+void CLI_CacheRelease(void);
+
+#endif /* __USBD_CLI_CACHE_H */
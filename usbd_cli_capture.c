@@ -0,0 +1,417 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_capture.c
+  * @author  Katagiri
+  * @brief   Source file for USB command line's trigger capture.
+  *          Like a logic analyzer, the channels (32-bit values read at given
+  *          addresses, variables or GPIO input registers) are sampled into a
+  *          ring while armed, and the ring is frozen when the trigger fires,
+  *          keeping the configured number of samples before it. The window is
+  *          then streamed in binary on CLI_MUX_BULK (usbd_cli_capture.h), so a
+  *          transient much faster than the link is kept at the sample rate.
+  *          Samples are taken in one context by CLI_CaptureTick(), SysTick if
+  *          CLI_CAPTURE_SYSTICK is 1, or a faster timer of the application if
+  *          it is 0. The window is queued by CLI_CapturePump() from the CDC
+  *          timer, the only writer of it.
+  *          Channels read addresses of the memory map (CLI_REG_MAP) only.
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "usbd_cli.h"
+#include "usbd_cli_capture.h"
+#include "usbd_cli_mux.h"
+#include "usbd_cli_reg.h"
+#include "usbd_cli_time.h"
+
+/* Private typedef -----------------------------------------------------------*/
+// sample
+typedef struct
+{
+  uint32_t time;                            // CLI_TimeNow32()
+  uint32_t value[CLI_CAPTURE_CHANNELS];     // values of channels
+} CaptureSample;
+
+/* Private define ------------------------------------------------------------*/
+// bytes queued at once (the channel takes all or nothing)
+#define CAPTURE_CHUNK_LENGTH      64
+
+/* Private macro -------------------------------------------------------------*/
+/* Private function prototypes -----------------------------------------------*/
+static uint8_t TestTrigger(uint32_t value);
+static uint16_t WindowBytes(uint32_t offset, uint8_t* pBuf, uint16_t size);
+static void PutU32(uint8_t* pBuf, uint32_t value);
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t Channels[CLI_CAPTURE_CHANNELS];   // addresses, 0 if not sampled
+static CaptureTrigger Trigger;
+
+static CaptureSample Ring[CLI_CAPTURE_DEPTH];
+static volatile uint8_t State = CLI_CAPTURE_IDLE;
+static volatile uint8_t Request = CLI_CAPTURE_CAUSE_NONE;  // cause of trigger without condition
+static volatile uint32_t Samples;         // samples taken since armed
+static uint16_t Pre;                      // samples kept before the trigger (configured)
+static uint16_t PostLeft;                 // samples still to take after the trigger
+static uint8_t WasTrue;                   // condition was true on the previous sample
+static uint32_t Start;                    // sample number of the first sample of window
+static uint16_t WindowPre;                // samples before the trigger in the window
+static uint16_t WindowNum;                // samples in the window
+static uint8_t Cause;                     // cause of the window
+
+static volatile uint8_t Reading;          // window is being queued
+static volatile uint32_t Sent;            // bytes queued
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  CLI_CaptureTick: take a sample (sampling context)
+  * @retval None
+  */
+void CLI_CaptureTick(void)
+{
+  uint8_t state = State;
+  CaptureSample *pSample;
+  uint32_t number;
+
+  if( state != CLI_CAPTURE_ARMED && state != CLI_CAPTURE_TRIGGERED )
+  {
+    return;
+  }
+
+  number = Samples;
+  pSample = &Ring[number % CLI_CAPTURE_DEPTH];
+  pSample->time = CLI_TimeNow32();
+  for(uint8_t ch=0; ch<CLI_CAPTURE_CHANNELS; ch++)
+  {
+    pSample->value[ch] = ( Channels[ch] != 0 ) ? CLI_RegRead(Channels[ch]) : 0;
+  }
+  Samples = number + 1;
+
+  if( state == CLI_CAPTURE_TRIGGERED )
+  {
+    if( --PostLeft == 0 )
+    {
+      State = CLI_CAPTURE_FROZEN;
+    }
+    return;
+  }
+
+  // armed : an edge of the condition, or a request
+  if( Trigger.op != CLI_CAPTURE_TRIG_NONE )
+  {
+    uint8_t isTrue = TestTrigger(pSample->value[Trigger.channel]);
+
+    if( isTrue && !WasTrue )
+    {
+      Cause = CLI_CAPTURE_CAUSE_VALUE;
+    }
+    WasTrue = isTrue;
+  }
+  if( Cause == CLI_CAPTURE_CAUSE_NONE && Request != CLI_CAPTURE_CAUSE_NONE )
+  {
+    Cause = Request;
+  }
+  if( Cause == CLI_CAPTURE_CAUSE_NONE )
+  {
+    return;
+  }
+
+  // fewer samples before the trigger if it fires early
+  WindowPre = ( number < Pre ) ? (uint16_t)number : Pre;
+  Start = number - WindowPre;
+  PostLeft = CLI_CAPTURE_DEPTH - 1 - Pre;
+  WindowNum = (uint16_t)(WindowPre + 1 + PostLeft);
+  State = ( PostLeft == 0 ) ? CLI_CAPTURE_FROZEN : CLI_CAPTURE_TRIGGERED;
+}
+
+/**
+  * @brief  CLI_CapturePump: queue the window on CLI_MUX_BULK (CDC timer)
+  *         The rest waits while the channel is full, reading stops if the
+  *         port leaves multiplexed mode.
+  * @retval None
+  */
+void CLI_CapturePump(void)
+{
+  uint8_t chunk[CAPTURE_CHUNK_LENGTH];
+  uint32_t total;
+
+  if( !Reading || State != CLI_CAPTURE_FROZEN )
+  {
+    return;
+  }
+  if( !CLI_MuxIsActive() )
+  {
+    Reading = 0;
+    return;
+  }
+
+  total = CLI_CAPTURE_HEADER_LENGTH + (uint32_t)WindowNum * CLI_CAPTURE_SAMPLE_LENGTH;
+  while( Sent < total )
+  {
+    uint16_t length = WindowBytes(Sent, chunk, ( total - Sent < sizeof(chunk) ) ? (uint16_t)(total - Sent) : sizeof(chunk));
+
+    if( CLI_MuxWrite(CLI_MUX_BULK, chunk, length) == 0 )
+    {
+      // channel full, next time
+      return;
+    }
+    Sent += length;
+  }
+  Reading = 0;
+}
+
+/**
+  * @brief  CLI_CaptureSetChannel: select the value of a channel
+  *         Not while sampling.
+  * @param  channel: channel
+  * @param  addr: address of 32-bit value in the memory map (CLI_RegValid), 0 not to sample
+  * @retval Result
+  */
+int8_t CLI_CaptureSetChannel(uint8_t channel, uint32_t addr)
+{
+  if( CLI_CAPTURE_CHANNELS <= channel || (addr != 0 && !CLI_RegValid(addr)) )
+  {
+    return CLI_RESULT_INVALID;
+  }
+  if( State == CLI_CAPTURE_ARMED || State == CLI_CAPTURE_TRIGGERED )
+  {
+    return CLI_RESULT_FAIL;
+  }
+  Channels[channel] = addr;
+
+  return CLI_RESULT_OK;
+}
+
+/**
+  * @brief  CLI_CaptureGetChannel: address of a channel
+  * @param  channel: channel (valid)
+  * @retval Address, 0 if not sampled
+  */
+uint32_t CLI_CaptureGetChannel(uint8_t channel)
+{
+  return Channels[channel];
+}
+
+/**
+  * @brief  CLI_CaptureSetTrigger: set the trigger condition
+  *         Not while sampling.
+  * @param  pTrigger: pointer of trigger (op CLI_CAPTURE_TRIG_NONE : event and command only)
+  * @retval Result
+  */
+int8_t CLI_CaptureSetTrigger(const CaptureTrigger* pTrigger)
+{
+  if( CLI_CAPTURE_TRIG_NE < pTrigger->op || CLI_CAPTURE_CHANNELS <= pTrigger->channel )
+  {
+    return CLI_RESULT_INVALID;
+  }
+  if( State == CLI_CAPTURE_ARMED || State == CLI_CAPTURE_TRIGGERED )
+  {
+    return CLI_RESULT_FAIL;
+  }
+  Trigger = *pTrigger;
+
+  return CLI_RESULT_OK;
+}
+
+/**
+  * @brief  CLI_CaptureGetTrigger: get the trigger condition
+  * @param  pTrigger: pointer of trigger
+  * @retval None
+  */
+void CLI_CaptureGetTrigger(CaptureTrigger* pTrigger)
+{
+  *pTrigger = Trigger;
+}
+
+/**
+  * @brief  CLI_CaptureArm: start sampling and wait for the trigger
+  *         The previous window is discarded. A condition already true when
+  *         armed fires only after it becomes false.
+  * @param  pre: samples kept before the trigger (less than CLI_CAPTURE_DEPTH)
+  * @retval Result
+  */
+int8_t CLI_CaptureArm(uint16_t pre)
+{
+  if( CLI_CAPTURE_DEPTH <= pre )
+  {
+    return CLI_RESULT_INVALID;
+  }
+
+  State = CLI_CAPTURE_IDLE;
+  Reading = 0;
+  Pre = pre;
+  Samples = 0;
+  Cause = CLI_CAPTURE_CAUSE_NONE;
+  Request = CLI_CAPTURE_CAUSE_NONE;
+  WasTrue = 1;
+  State = CLI_CAPTURE_ARMED;
+
+  return CLI_RESULT_OK;
+}
+
+/**
+  * @brief  CLI_CaptureStop: stop sampling, the window is discarded
+  * @retval None
+  */
+void CLI_CaptureStop(void)
+{
+  State = CLI_CAPTURE_IDLE;
+  Reading = 0;
+}
+
+/**
+  * @brief  CLI_CaptureTrigger: fire the trigger on the next sample
+  *         Any context, e.g. where an application logs an error.
+  * @param  cause: CLI_CAPTURE_CAUSE_EVENT or CLI_CAPTURE_CAUSE_COMMAND
+  * @retval Result, CLI_RESULT_FAIL if not armed
+  */
+int8_t CLI_CaptureTrigger(uint8_t cause)
+{
+  if( cause == CLI_CAPTURE_CAUSE_NONE )
+  {
+    return CLI_RESULT_INVALID;
+  }
+  if( State != CLI_CAPTURE_ARMED )
+  {
+    return CLI_RESULT_FAIL;
+  }
+  Request = cause;
+
+  return CLI_RESULT_OK;
+}
+
+/**
+  * @brief  CLI_CaptureRead: stream the frozen window on CLI_MUX_BULK
+  *         (from the beginning, again if it was read)
+  * @retval Result, CLI_RESULT_FAIL if not frozen or not multiplexed
+  */
+int8_t CLI_CaptureRead(void)
+{
+  if( State != CLI_CAPTURE_FROZEN || !CLI_MuxIsActive() )
+  {
+    return CLI_RESULT_FAIL;
+  }
+  Reading = 0;
+  Sent = 0;
+  Reading = 1;
+
+  return CLI_RESULT_OK;
+}
+
+/**
+  * @brief  CLI_CaptureGetStatus: get status of capture
+  * @param  pStatus: pointer of status
+  * @retval None
+  */
+void CLI_CaptureGetStatus(CaptureStatus* pStatus)
+{
+  uint8_t state = State;
+
+  memset(pStatus, 0, sizeof(*pStatus));
+  pStatus->state = state;
+  pStatus->samples = Samples;
+  pStatus->pre = Pre;
+  if( state == CLI_CAPTURE_TRIGGERED || state == CLI_CAPTURE_FROZEN )
+  {
+    pStatus->cause = Cause;
+    pStatus->time = Ring[(Start + WindowPre) % CLI_CAPTURE_DEPTH].time;
+  }
+  if( state == CLI_CAPTURE_FROZEN )
+  {
+    pStatus->pre = WindowPre;
+    pStatus->num = WindowNum;
+    pStatus->sent = Sent;
+    pStatus->length = CLI_CAPTURE_HEADER_LENGTH + (uint32_t)WindowNum * CLI_CAPTURE_SAMPLE_LENGTH;
+  }
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  TestTrigger: test the trigger condition
+  * @param  value: value of the trigger channel
+  * @retval 1 if true
+  */
+static uint8_t TestTrigger(uint32_t value)
+{
+  value &= Trigger.mask;
+
+  switch( Trigger.op )
+  {
+  case CLI_CAPTURE_TRIG_ABOVE: return ( Trigger.threshold < value );
+  case CLI_CAPTURE_TRIG_BELOW: return ( value < Trigger.threshold );
+  case CLI_CAPTURE_TRIG_EQ:    return ( value == Trigger.threshold );
+  case CLI_CAPTURE_TRIG_NE:    return ( value != Trigger.threshold );
+  default:                     return 0;
+  }
+}
+
+/**
+  * @brief  WindowBytes: serialize a part of the frozen window
+  * @param  offset: offset of bytes in the window
+  * @param  pBuf: pointer of buffer
+  * @param  size: bytes to serialize (not past the end of window)
+  * @retval Bytes serialized
+  */
+static uint16_t WindowBytes(uint32_t offset, uint8_t* pBuf, uint16_t size)
+{
+  uint8_t unit[(CLI_CAPTURE_HEADER_LENGTH < CLI_CAPTURE_SAMPLE_LENGTH) ? CLI_CAPTURE_SAMPLE_LENGTH : CLI_CAPTURE_HEADER_LENGTH];
+  uint16_t length = 0;
+
+  while( length < size )
+  {
+    uint32_t pos;
+    uint16_t unitLength;
+    uint16_t n;
+
+    if( offset < CLI_CAPTURE_HEADER_LENGTH )
+    {
+      const CaptureSample *pTrig = &Ring[(Start + WindowPre) % CLI_CAPTURE_DEPTH];
+
+      unit[0] = CLI_CAPTURE_MAGIC0;
+      unit[1] = CLI_CAPTURE_MAGIC1;
+      unit[2] = CLI_CAPTURE_CHANNELS;
+      unit[3] = Cause;
+      unit[4] = (uint8_t)WindowPre;
+      unit[5] = (uint8_t)(WindowPre >> 8);
+      unit[6] = (uint8_t)WindowNum;
+      unit[7] = (uint8_t)(WindowNum >> 8);
+      PutU32(&unit[8], pTrig->time);
+      PutU32(&unit[12], CLI_TimeFreq());
+      pos = offset;
+      unitLength = CLI_CAPTURE_HEADER_LENGTH;
+    }
+    else
+    {
+      uint32_t index = (offset - CLI_CAPTURE_HEADER_LENGTH) / CLI_CAPTURE_SAMPLE_LENGTH;
+      const CaptureSample *pSample = &Ring[(Start + index) % CLI_CAPTURE_DEPTH];
+
+      PutU32(&unit[0], pSample->time);
+      for(uint8_t ch=0; ch<CLI_CAPTURE_CHANNELS; ch++)
+      {
+        PutU32(&unit[4 + 4 * ch], pSample->value[ch]);
+      }
+      pos = (offset - CLI_CAPTURE_HEADER_LENGTH) % CLI_CAPTURE_SAMPLE_LENGTH;
+      unitLength = CLI_CAPTURE_SAMPLE_LENGTH;
+    }
+
+    n = (uint16_t)(unitLength - pos);
+    n = ( size - length < n ) ? (uint16_t)(size - length) : n;
+    memcpy(&pBuf[length], &unit[pos], n);
+    length += n;
+    offset += n;
+  }
+  return length;
+}
+
+/**
+  * @brief  PutU32: store a value in little endian
+  * @param  pBuf: pointer of buffer
+  * @param  value: value
+  * @retval None
+  */
+static void PutU32(uint8_t* pBuf, uint32_t value)
+{
+  pBuf[0] = (uint8_t)value;
+  pBuf[1] = (uint8_t)(value >> 8);
+  pBuf[2] = (uint8_t)(value >> 16);
+  pBuf[3] = (uint8_t)(value >> 24);
+}
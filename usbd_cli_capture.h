@@ -0,0 +1,102 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_capture.h
+  * @author  Katagiri
+  * @brief   Header file for USB command line's trigger capture.
+  *          This header is shared with the host (window format).
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CLI_CAPTURE_H
+#define __USBD_CLI_CAPTURE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+/*
+  Window format on CLI_MUX_BULK (little endian)
+    header  : ['C'] ['A'] [channels] [cause] [pre (uint16_t)] [num (uint16_t)]
+              [trigger time (uint32_t)] [time frequency (uint32_t)]
+    samples : num x ([time (uint32_t)] [value (uint32_t)] x channels), oldest first
+
+  samples[pre] is the sample the trigger fired on, time is CLI_TimeNow32().
+  Values of channels not sampled are 0.
+*/
+#define CLI_CAPTURE_MAGIC0        'C'
+#define CLI_CAPTURE_MAGIC1        'A'
+#define CLI_CAPTURE_HEADER_LENGTH 16
+#define CLI_CAPTURE_SAMPLE_LENGTH (4 + 4 * CLI_CAPTURE_CHANNELS)
+
+// number of channels (32-bit values, e.g. a variable or GPIOx->IDR)
+#ifndef CLI_CAPTURE_CHANNELS
+#define CLI_CAPTURE_CHANNELS      4
+#endif
+
+// 1 : CLI_CaptureTick() is called from SysTick_Handler (stm32f4xx_it.c)
+// 0 : the application calls it from its own timer instead, never from both
+#ifndef CLI_CAPTURE_SYSTICK
+#define CLI_CAPTURE_SYSTICK       1
+#endif
+
+// samples in the ring (window length)
+#ifndef CLI_CAPTURE_DEPTH
+#define CLI_CAPTURE_DEPTH         256
+#endif
+
+// state
+#define CLI_CAPTURE_IDLE          0     // not sampling
+#define CLI_CAPTURE_ARMED         1     // sampling, waiting for the trigger
+#define CLI_CAPTURE_TRIGGERED     2     // sampling the post-trigger part
+#define CLI_CAPTURE_FROZEN        3     // window complete
+
+// trigger condition on (value & mask), fires on the sample it becomes true
+#define CLI_CAPTURE_TRIG_NONE     0
+#define CLI_CAPTURE_TRIG_ABOVE    1     // > threshold
+#define CLI_CAPTURE_TRIG_BELOW    2     // < threshold
+#define CLI_CAPTURE_TRIG_EQ       3     // == threshold
+#define CLI_CAPTURE_TRIG_NE       4     // != threshold
+
+// cause of trigger
+#define CLI_CAPTURE_CAUSE_NONE    0
+#define CLI_CAPTURE_CAUSE_VALUE   1     // condition of a channel
+#define CLI_CAPTURE_CAUSE_EVENT   2     // CLI_CaptureTrigger() of an application (e.g. logging an error)
+#define CLI_CAPTURE_CAUSE_COMMAND 3     // CAPTURE FIRE
+
+/* Exported types ------------------------------------------------------------*/
+// trigger condition
+typedef struct
+{
+  uint8_t op;               // CLI_CAPTURE_TRIG_xxx
+  uint8_t channel;          // channel tested
+  uint32_t threshold;       // compared with (value & mask)
+  uint32_t mask;            // bits tested
+} CaptureTrigger;
+
+// status of capture
+typedef struct
+{
+  uint8_t state;            // CLI_CAPTURE_xxx
+  uint8_t cause;            // CLI_CAPTURE_CAUSE_xxx of the window
+  uint16_t pre;             // samples before the trigger (configured, or in the window if frozen)
+  uint16_t num;             // samples in the window (frozen)
+  uint32_t samples;         // samples taken since armed
+  uint32_t time;            // time of the trigger sample
+  uint32_t sent;            // bytes of the window queued on the channel
+  uint32_t length;          // bytes of the window
+} CaptureStatus;
+
+/* Exported functions ------------------------------------------------------- */
+void CLI_CaptureTick(void);
+void CLI_CapturePump(void);
+int8_t CLI_CaptureSetChannel(uint8_t channel, uint32_t addr);
+uint32_t CLI_CaptureGetChannel(uint8_t channel);
+int8_t CLI_CaptureSetTrigger(const CaptureTrigger* pTrigger);
+void CLI_CaptureGetTrigger(CaptureTrigger* pTrigger);
+int8_t CLI_CaptureArm(uint16_t pre);
+void CLI_CaptureStop(void);
+int8_t CLI_CaptureTrigger(uint8_t cause);
+int8_t CLI_CaptureRead(void);
+void CLI_CaptureGetStatus(CaptureStatus* pStatus);
+
+#endif /* __USBD_CLI_CAPTURE_H */
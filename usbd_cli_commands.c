@@ -6,14 +6,49 @@
   ******************************************************************************
   */
 /* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "usbd_cli.h"
 #include "usbd_cli_commands.h"
+#include "usbd_cli_arena.h"
+#include "usbd_cli_pool.h"
+#include "usbd_cli_mux.h"
+#include "usbd_cli_tx.h"
+#include "usbd_cli_scan.h"
+#include "usbd_cli_reg.h"
+#include "usbd_cli_usbstat.h"
+#include "usbd_cli_enum.h"
+#include "usbd_cli_time.h"
+#include "usbd_cli_sync.h"
+#include "usbd_cli_counter.h"
+#include "usbd_cli_bench.h"
+#include "usbd_cli_telem.h"
+#include "usbd_cli_capture.h"
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
 /* Private macro -------------------------------------------------------------*/
 /* Private function prototypes -----------------------------------------------*/
 int8_t TEST(uint8_t* pArg, uint8_t* pRes);
+int8_t ARENA(uint8_t* pArg, uint8_t* pRes);
+int8_t POOL(uint8_t* pArg, uint8_t* pRes);
+int8_t MUX(uint8_t* pArg, uint8_t* pRes);
+int8_t TXSTAT(uint8_t* pArg, uint8_t* pRes);
+int8_t MODE(uint8_t* pArg, uint8_t* pRes);
+int8_t SCANBENCH(uint8_t* pArg, uint8_t* pRes);
+int8_t HELP(uint8_t* pArg, uint8_t* pRes);
+int8_t USBSTAT(uint8_t* pArg, uint8_t* pRes);
+int8_t USB_ENUM_TRACE(uint8_t* pArg, uint8_t* pRes);
+int8_t TSYNC(uint8_t* pArg, uint8_t* pRes);
+int8_t COUNTERS(uint8_t* pArg, uint8_t* pRes);
+int8_t BENCH(uint8_t* pArg, uint8_t* pRes);
+int8_t BUILD_ID(uint8_t* pArg, uint8_t* pRes);
+int8_t TELEM(uint8_t* pArg, uint8_t* pRes);
+int8_t CAPTURE(uint8_t* pArg, uint8_t* pRes);
+
+/* Private variables ---------------------------------------------------------*/
+CLI_ARG_PARSER(Args_Iterations, 0, CLI_ARG_SPEC_UINT(1, CLI_BENCH_MAX_ITERATIONS));
 
 /* Exported variables --------------------------------------------------------*/
 
@@ -22,12 +57,42 @@ int8_t TEST(uint8_t* pArg, uint8_t* pRes);
   - Type of function is CommandFxn,
       int8_t (*CommandFxn)(uint8_t* pArg, uint8_t* pRes)
   - String after the space following command name is passed to the function as arguments.
-  - Each command functions have to parse the arguments individually.
+  - Each command functions have to parse the arguments individually,
+    or set an argument parser (usbd_cli_args.h) as the third member.
+    Then arguments are validated before the function is called and the
+    values are got by CLI_GetArgs().
+  - Set CLI_CMD_FLAG_CACHE as the fourth member if the command always returns
+    the same response for the same arguments. The response is sent from cache
+    until CLI_InvalidateResponse() is called with the command name.
+  - Temporary memory can be taken by CLI_ArenaAlloc() instead of large local
+    or static arrays. It is released when the command function returns.
+  - Other modules can add their own command set with CLI_RegisterCommands()
+    before CLI_Init() is called. Commands are looked up by binary search.
+  - Each command also has a numeric opcode, and "#<opcode> <arguments>" runs
+    it without name lookup ("HELP -n" lists them). Opcodes of this set are
+    positions in it, add new commands at the end to keep existing opcodes.
+    A module set has its own range from the base given at registration.
 */
 // Set of command function
 CommandUnit CommandSet[] =
 {
   {"GET_LOG", TEST},
+  {"ARENA", ARENA, &Args_None},
+  {"POOL", POOL, &Args_None},
+  {CLI_MUX_START_COMMAND, MUX, &Args_None},
+  {"TXSTAT", TXSTAT, &Args_Flag},
+  {"MODE", MODE},
+  {"SCANBENCH", SCANBENCH, &Args_Iterations},
+  {"HELP", HELP},
+  {"REG_BATCH", CLI_RegBatch},
+  {"USBSTAT", USBSTAT},
+  {"USB_ENUM_TRACE", USB_ENUM_TRACE},
+  {"TSYNC", TSYNC, &Args_None},
+  {"COUNTERS", COUNTERS},
+  {"BENCH", BENCH},
+  {"BUILD_ID", BUILD_ID, &Args_None, CLI_CMD_FLAG_CACHE},
+  {"TELEM", TELEM},
+  {"CAPTURE", CAPTURE},
 };
 
 /****************************************************************/ 
@@ -53,4 +118,782 @@ int8_t TEST(uint8_t* pArg, uint8_t* pRes)
   }
 
   return CLI_RESULT_OK;
-}
\ No newline at end of file
+}
+
+/**
+  * @brief  ARENA: report usage of scratch arena
+  * @param  pArg: pointer of arguments string (no argument)
+  * @param  pRes: pointer of response buffer
+  * @retval Result
+  */
+int8_t ARENA(uint8_t* pArg, uint8_t* pRes)
+{
+  ArenaStats stats;
+
+  CLI_ArenaGetStats(&stats);
+  snprintf((char*)pRes, CLI_RESPONSE_LENGTH, "size=%lu high=%lu fail=%lu",
+           (unsigned long)stats.size, (unsigned long)stats.highWater, (unsigned long)stats.failures);
+
+  return CLI_RESULT_OK;
+}
+
+/**
+  * @brief  POOL: report usage of block pools
+  *         "<id>:<in use>/<blocks>x<size> exh=<failures>" for each pool
+  * @param  pArg: pointer of arguments string (no argument)
+  * @param  pRes: pointer of response buffer
+  * @retval Result
+  */
+int8_t POOL(uint8_t* pArg, uint8_t* pRes)
+{
+  PoolStats stats;
+  int length = 0;
+
+  for(uint16_t id=0; id<CLI_NUM_OF_POOLS && length < CLI_RESPONSE_LENGTH; id++)
+  {
+    CLI_PoolGetStats((PoolId)id, &stats);
+    length += snprintf((char*)&pRes[length], CLI_RESPONSE_LENGTH - length, "%s%u:%lu/%ux%u exh=%lu",
+                       (id == 0) ? "" : " ", id, (unsigned long)stats.inUse, stats.numBlocks,
+                       stats.blockSize, (unsigned long)stats.exhausted);
+  }
+
+  return CLI_RESULT_OK;
+}
+
+/**
+  * @brief  MUX: enter multiplexed mode (usbd_cli_mux.h)
+  *         The response and all output after it are sent in frames.
+  * @param  pArg: pointer of arguments string (no argument)
+  * @param  pRes: pointer of response buffer
+  * @retval Result
+  */
+int8_t MUX(uint8_t* pArg, uint8_t* pRes)
+{
+  CLI_MuxStart();
+  snprintf((char*)pRes, CLI_RESPONSE_LENGTH, "MUX ON");
+
+  return CLI_RESULT_OK;
+}
+
+/**
+  * @brief  TXSTAT: report TX scheduler statistics and reply latency
+  *         "TXSTAT 1" clears them after the report (e.g. before a stream test)
+  *         lat and max are the last and worst reply latency [us]
+  * @param  pArg: pointer of arguments string ([<clear>])
+  * @param  pRes: pointer of response buffer
+  * @retval Result
+  */
+int8_t TXSTAT(uint8_t* pArg, uint8_t* pRes)
+{
+  const ArgValues *pValues = CLI_GetArgs();
+  TxStats stats;
+
+  CLI_TxGetStats(&stats, (0 < pValues->num) ? (uint8_t)pValues->value[0] : 0);
+  snprintf((char*)pRes, CLI_RESPONSE_LENGTH, "pkt=%lu zlp=%lu ctl=%lu stream=%lu err=%lu lat=%lu max=%lu n=%lu",
+           (unsigned long)stats.packets, (unsigned long)stats.zlps, (unsigned long)stats.controlBytes,
+           (unsigned long)stats.streamBytes, (unsigned long)stats.errors, (unsigned long)stats.latencyLast,
+           (unsigned long)stats.latencyMax, (unsigned long)stats.replies);
+
+  return CLI_RESULT_OK;
+}
+
+/**
+  * @brief  MODE: get or change mode of the session
+  *         "MODE MACHINE"     : no echo nor prompt, "$<result>" line after each response
+  *         "MODE INTERACTIVE" : echo and prompt (default, and after reconnection)
+  * @param  pArg: pointer of arguments string ([MACHINE|INTERACTIVE])
+  * @param  pRes: pointer of response buffer
+  * @retval Result
+  */
+int8_t MODE(uint8_t* pArg, uint8_t* pRes)
+{
+  if(pArg == NULL)
+  {
+    // report only
+  }
+  else if(strcmp((const char*)pArg, "MACHINE") == 0)
+  {
+    CLI_SetMode(CLI_MODE_MACHINE);
+  }
+  else if(strcmp((const char*)pArg, "INTERACTIVE") == 0)
+  {
+    CLI_SetMode(CLI_MODE_INTERACTIVE);
+  }
+  else
+  {
+    return CLI_RESULT_INVALID;
+  }
+
+  snprintf((char*)pRes, CLI_RESPONSE_LENGTH, "%s", (CLI_GetMode() == CLI_MODE_MACHINE) ? "MACHINE" : "INTERACTIVE");
+
+  return CLI_RESULT_OK;
+}
+
+/**
+  * @brief  SCANBENCH: input scanner (usbd_cli_scan.c) by BENCH kernels "scan_byte" and "scan"
+  *         Time per byte (x100) of byte-at-a-time copy and of CLI_ScanCopy without the
+  *         call cost, in DWT cycles on target or ns on host build. n is the fewest
+  *         iterations run by the kernels (each run is bounded by CLI_BENCH_TIME_MAX).
+  * @param  pArg: pointer of arguments string ([<iterations>] up to CLI_BENCH_MAX_ITERATIONS, 1000 if omitted)
+  * @param  pRes: pointer of response buffer
+  * @retval Result
+  */
+int8_t SCANBENCH(uint8_t* pArg, uint8_t* pRes)
+{
+  static const char* const kernels[2] = { "scan_byte", "scan" };
+  const ArgValues *pValues = CLI_GetArgs();
+  uint32_t iterations = (0 < pValues->num) ? pValues->value[0] : 1000;
+  uint32_t run = iterations;
+  unsigned long perByte[2];
+  BenchResult bench;
+
+  for(uint8_t k=0; k<2; k++)
+  {
+    if(CLI_RunBenchmark(CLI_FindBenchmark(kernels[k]), iterations, &bench) != CLI_RESULT_OK)
+    {
+      return CLI_RESULT_FAIL;
+    }
+    perByte[k] = (unsigned long)((uint64_t)((bench.baseline < bench.time) ? bench.time - bench.baseline : 0) * 100
+                                 / ((uint64_t)bench.iterations * CLI_SCAN_BENCH_LENGTH));
+    run = (bench.iterations < run) ? bench.iterations : run;
+  }
+  snprintf((char*)pRes, CLI_RESPONSE_LENGTH, "len=%lu n=%lu byte=%lu word=%lu (x100 %s/byte)",
+           (unsigned long)CLI_SCAN_BENCH_LENGTH, (unsigned long)run,
+           perByte[0], perByte[1], bench.unit);
+
+  return CLI_RESULT_OK;
+}
+
+/**
+  * @brief  HELP: list command names, or opcodes and names with -n ("<opcode>=<name>")
+  *         The list starts at opcode <first>, " ..." at the end if it continues.
+  * @param  pArg: pointer of arguments string ([-n] [<first>])
+  * @param  pRes: pointer of response buffer
+  * @retval Result
+  */
+int8_t HELP(uint8_t* pArg, uint8_t* pRes)
+{
+  const CommandUnit *pUnit;
+  uint8_t numbers = 0;
+  unsigned long first = 0;
+  uint16_t op;
+  char *pEnd;
+  int length = 0;
+
+  if(pArg != NULL && pArg[0] == '-' && pArg[1] == 'n' && (pArg[2] == '\0' || pArg[2] == ' '))
+  {
+    numbers = 1;
+    pArg += 2;
+    while(*pArg == ' ')
+    {
+      ++pArg;
+    }
+  }
+  if(pArg != NULL && *pArg != '\0')
+  {
+    first = strtoul((const char*)pArg, &pEnd, 10);
+    if(*pEnd != '\0' || (const uint8_t*)pEnd == pArg || 0xFFFF < first)
+    {
+      return CLI_RESULT_INVALID;
+    }
+  }
+
+  // opcodes of sets are not contiguous, the next command is searched from each one
+  op = (uint16_t)first;
+  while((pUnit = CLI_NextCommand(&op)) != NULL)
+  {
+    char item[32];
+    int n = numbers ? snprintf(item, sizeof(item), "%u=%s", op, pUnit->name)
+                    : snprintf(item, sizeof(item), "%s", pUnit->name);
+
+    // keep room for " ..."
+    if(CLI_RESPONSE_LENGTH - 5 <= length + 1 + n)
+    {
+      strcpy((char*)&pRes[length], " ...");
+      break;
+    }
+    length += sprintf((char*)&pRes[length], "%s%s", (length == 0) ? "" : " ", item);
+    if(op == 0xFFFF)
+    {
+      break;
+    }
+    ++op;
+  }
+
+  return CLI_RESULT_OK;
+}
+
+/**
+  * @brief  USBSTAT: report USB statistics (usbd_cli_usbstat.h)
+  *         "USBSTAT"        : "<event>=<count>@<last time>" of bus events
+  *         "USBSTAT <ep>"   : counters of endpoint (e.g. 0x81 : IN 1, 0x01 : OUT 1)
+  *         "USBSTAT CLEAR"  : clear all
+  *         Times are in ms, "now" is the current time.
+  * @param  pArg: pointer of arguments string ([<ep>|CLEAR])
+  * @param  pRes: pointer of response buffer
+  * @retval Result
+  */
+int8_t USBSTAT(uint8_t* pArg, uint8_t* pRes)
+{
+  static const char* const eventNames[CLI_NUM_OF_USB_EVENTS] =
+  {
+    "setup", "sof", "rst", "sus", "res", "con", "dis"
+  };
+  UsbDevStats dev;
+  UsbEpStats ep;
+  unsigned long addr;
+  char *pEnd;
+  int length;
+
+  if(pArg == NULL)
+  {
+    CLI_UsbStatGetDevice(&dev);
+    length = snprintf((char*)pRes, CLI_RESPONSE_LENGTH, "now=%lu", (unsigned long)CLI_UsbStatGetTick());
+    for(uint16_t i=0; i<CLI_NUM_OF_USB_EVENTS && length < CLI_RESPONSE_LENGTH; i++)
+    {
+      length += snprintf((char*)&pRes[length], CLI_RESPONSE_LENGTH - length, " %s=%lu@%lu",
+                         eventNames[i], (unsigned long)dev.events[i], (unsigned long)dev.lastTick[i]);
+    }
+  }
+  else if(strcmp((const char*)pArg, "CLEAR") == 0)
+  {
+    CLI_UsbStatClear();
+    snprintf((char*)pRes, CLI_RESPONSE_LENGTH, "OK");
+  }
+  else
+  {
+    addr = strtoul((const char*)pArg, &pEnd, 0);
+    if(*pEnd != '\0' || (const uint8_t*)pEnd == pArg || 0xFF < addr
+       || !CLI_UsbStatGetEndpoint((uint8_t)addr, &ep))
+    {
+      return CLI_RESULT_INVALID;
+    }
+    snprintf((char*)pRes, CLI_RESPONSE_LENGTH, "ep=0x%02lX pkt=%lu byte=%lu xfer=%lu stall=%lu iso=%lu last=%lu now=%lu",
+             addr, (unsigned long)ep.packets, (unsigned long)ep.bytes, (unsigned long)ep.transfers,
+             (unsigned long)ep.stalls, (unsigned long)ep.isoIncomplete, (unsigned long)ep.lastTick,
+             (unsigned long)CLI_UsbStatGetTick());
+  }
+
+  return CLI_RESULT_OK;
+}
+
+/**
+  * @brief  USB_ENUM_TRACE: dump setup packets recorded (usbd_cli_enum.h)
+  *         "<seq>:+<gap> <bmRequestType><bRequest> <wValue> <wIndex> <wLength> d<desc> c<done>"
+  *         for each, times in us : gap from the previous setup packet, time in
+  *         descriptor callbacks and time to the last data/status stage.
+  *         The list starts at <seq> (the oldest kept if omitted), " ..." at the end if it continues.
+  *         "USB_ENUM_TRACE CLEAR" clears the trace (e.g. before reconnection).
+  * @param  pArg: pointer of arguments string ([<seq>|CLEAR])
+  * @param  pRes: pointer of response buffer
+  * @retval Result
+  */
+int8_t USB_ENUM_TRACE(uint8_t* pArg, uint8_t* pRes)
+{
+  EnumTraceEntry entry;
+  uint32_t count = CLI_EnumTraceCount();
+  uint32_t seq = (CLI_ENUM_TRACE_SIZE < count) ? count - CLI_ENUM_TRACE_SIZE : 0;
+  uint64_t prevTime = 0;
+  uint8_t hasPrev = 0;
+  char *pEnd;
+  int length = 0;
+
+  if(pArg != NULL && strcmp((const char*)pArg, "CLEAR") == 0)
+  {
+    CLI_EnumTraceClear();
+    snprintf((char*)pRes, CLI_RESPONSE_LENGTH, "OK");
+    return CLI_RESULT_OK;
+  }
+  if(pArg != NULL)
+  {
+    unsigned long first = strtoul((const char*)pArg, &pEnd, 10);
+
+    if(*pEnd != '\0' || (const uint8_t*)pEnd == pArg || first < seq || count < first)
+    {
+      return CLI_RESULT_INVALID;
+    }
+    seq = (uint32_t)first;
+  }
+
+  if(seq != 0 && CLI_EnumTraceGet(seq - 1, &entry))
+  {
+    prevTime = entry.time;
+    hasPrev = 1;
+  }
+
+  for(; CLI_EnumTraceGet(seq, &entry); seq++)
+  {
+    char item[64];
+    int n = snprintf(item, sizeof(item), "%lu:+%lu %02X%02X %02X%02X %02X%02X %u d%lu c%lu",
+                     (unsigned long)seq,
+                     hasPrev ? (unsigned long)CLI_TimeToUs(entry.time - prevTime) : 0UL,
+                     entry.setup[0], entry.setup[1], entry.setup[3], entry.setup[2],
+                     entry.setup[5], entry.setup[4], entry.setup[6] | (entry.setup[7] << 8),
+                     (unsigned long)CLI_TimeToUs(entry.descTime),
+                     (unsigned long)CLI_TimeToUs(entry.doneTime));
+
+    // keep room for " ..."
+    if(CLI_RESPONSE_LENGTH - 5 <= length + 1 + n)
+    {
+      strcpy((char*)&pRes[length], " ...");
+      break;
+    }
+    length += sprintf((char*)&pRes[length], "%s%s", (length == 0) ? "" : " ", item);
+    prevTime = entry.time;
+    hasPrev = 1;
+  }
+  if(length == 0)
+  {
+    snprintf((char*)pRes, CLI_RESPONSE_LENGTH, "NONE");
+  }
+
+  return CLI_RESULT_OK;
+}
+
+/**
+  * @brief  TSYNC: report local time of the latest SOF (usbd_cli_sync.h)
+  *         "frame=<frame number> t=<time of SOF> now=<time>", times in s with 9 decimals.
+  *         USB Host maps local time to its own with host/cli_sync.c.
+  * @param  pArg: pointer of arguments string (no argument)
+  * @param  pRes: pointer of response buffer
+  * @retval Result
+  */
+int8_t TSYNC(uint8_t* pArg, uint8_t* pRes)
+{
+  SyncSample sample;
+  uint64_t now = CLI_TimeToNs(CLI_TimeNow());
+  uint64_t sof;
+
+  if(!CLI_SyncGet(&sample))
+  {
+    return CLI_RESULT_FAIL;
+  }
+  sof = CLI_TimeToNs(sample.time);
+
+  // printf of embedded C library may not have 64-bit integers
+  snprintf((char*)pRes, CLI_RESPONSE_LENGTH, "frame=%lu t=%lu.%09lu now=%lu.%09lu",
+           (unsigned long)sample.frame,
+           (unsigned long)(sof / 1000000000ULL), (unsigned long)(sof % 1000000000ULL),
+           (unsigned long)(now / 1000000000ULL), (unsigned long)(now % 1000000000ULL));
+
+  return CLI_RESULT_OK;
+}
+
+/**
+  * @brief  COUNTERS: list counters and gauges (usbd_cli_counter.h), "<name>=<value>"
+  *         With -d, counters show the difference since they were listed last.
+  *         The list starts at counter <first>, " ..." at the end if it continues.
+  * @param  pArg: pointer of arguments string ([-d] [<first>])
+  * @param  pRes: pointer of response buffer
+  * @retval Result
+  */
+int8_t COUNTERS(uint8_t* pArg, uint8_t* pRes)
+{
+  uint8_t delta = 0;
+  unsigned long first = 0;
+  char *pEnd;
+  int length = 0;
+
+  if(pArg != NULL && pArg[0] == '-' && pArg[1] == 'd' && (pArg[2] == '\0' || pArg[2] == ' '))
+  {
+    delta = 1;
+    pArg += 2;
+    while(*pArg == ' ')
+    {
+      ++pArg;
+    }
+  }
+  if(pArg != NULL && *pArg != '\0')
+  {
+    first = strtoul((const char*)pArg, &pEnd, 10);
+    if(*pEnd != '\0' || (const uint8_t*)pEnd == pArg || CLI_NUM_OF_COUNTERS < first)
+    {
+      return CLI_RESULT_INVALID;
+    }
+  }
+
+  for(uint16_t id=(uint16_t)first; id<CLI_NUM_OF_COUNTERS; id++)
+  {
+    const char *pName = CLI_CounterName(id);
+
+    // keep room for " ...", the value is read only if it is listed (10 digits at most)
+    if(CLI_RESPONSE_LENGTH - 5 <= length + 1 + (int)strlen(pName) + 1 + 10)
+    {
+      strcpy((char*)&pRes[length], " ...");
+      break;
+    }
+    length += sprintf((char*)&pRes[length], "%s%s=%lu", (length == 0) ? "" : " ",
+                      pName, (unsigned long)CLI_CounterRead(id, delta));
+  }
+
+  return CLI_RESULT_OK;
+}
+
+/**
+  * @brief  BENCH: run a registered benchmark (usbd_cli_bench.h), or list them
+  *         "<name> n=<iterations> <time> <unit>/iter base=<baseline> target=<target>" (2 decimals),
+  *         time of the kernel without the call cost, in DWT cycles ("cyc") on target or ns on
+  *         host build, target is CLI_BENCH_TARGET.
+  *         Without a name, the list starts at benchmark <first>, " ..." at the end if it continues.
+  * @param  pArg: pointer of arguments string ([<first>] or <name> [<iterations>], 1000 iterations if omitted)
+  * @param  pRes: pointer of response buffer
+  * @retval Result
+  */
+int8_t BENCH(uint8_t* pArg, uint8_t* pRes)
+{
+  const BenchUnit *pUnit;
+  BenchResult bench;
+  unsigned long iterations = 1000;
+  uint32_t net;
+  char *pIter;
+  char *pEnd;
+  int length = 0;
+
+  // names do not start with a digit, a number is the first of the list
+  if(pArg == NULL || ('0' <= pArg[0] && pArg[0] <= '9'))
+  {
+    unsigned long first = 0;
+
+    if(pArg != NULL)
+    {
+      first = strtoul((const char*)pArg, &pEnd, 10);
+      if(*pEnd != '\0' || 0xFFFF < first)
+      {
+        return CLI_RESULT_INVALID;
+      }
+    }
+    for(uint16_t i=(uint16_t)first; (pUnit = CLI_GetBenchmark(i)) != NULL; i++)
+    {
+      // keep room for " ..."
+      if(CLI_RESPONSE_LENGTH - 5 <= length + 1 + (int)strlen(pUnit->name))
+      {
+        strcpy((char*)&pRes[length], " ...");
+        break;
+      }
+      length += sprintf((char*)&pRes[length], "%s%s", (length == 0) ? "" : " ", pUnit->name);
+    }
+    return CLI_RESULT_OK;
+  }
+
+  pIter = strchr((char*)pArg, ' ');
+  if(pIter != NULL)
+  {
+    *pIter++ = '\0';
+    iterations = strtoul(pIter, &pEnd, 0);
+    if(*pEnd != '\0' || pEnd == pIter || *pIter == '-')
+    {
+      return CLI_RESULT_INVALID;
+    }
+  }
+  pUnit = CLI_FindBenchmark((const char*)pArg);
+  if(pUnit == NULL || CLI_RunBenchmark(pUnit, (uint32_t)iterations, &bench) != CLI_RESULT_OK)
+  {
+    return CLI_RESULT_INVALID;
+  }
+
+  net = (bench.baseline < bench.time) ? bench.time - bench.baseline : 0;
+  snprintf((char*)pRes, CLI_RESPONSE_LENGTH, "%s n=%lu %lu.%02lu %s/iter base=%lu.%02lu target=%s",
+           pUnit->name, (unsigned long)bench.iterations,
+           (unsigned long)(net / bench.iterations), (unsigned long)((uint64_t)net * 100 / bench.iterations % 100),
+           bench.unit,
+           (unsigned long)(bench.baseline / bench.iterations),
+           (unsigned long)((uint64_t)bench.baseline * 100 / bench.iterations % 100), bench.target);
+
+  return CLI_RESULT_OK;
+}
+
+/**
+  * @brief  BUILD_ID: report build ID of firmware (CLI_BUILD_ID), results of benchmarks are kept with it
+  * @param  pArg: pointer of arguments string (no argument)
+  * @param  pRes: pointer of response buffer
+  * @retval Result
+  */
+int8_t BUILD_ID(uint8_t* pArg, uint8_t* pRes)
+{
+  snprintf((char*)pRes, CLI_RESPONSE_LENGTH, "%s", CLI_BUILD_ID);
+
+  return CLI_RESULT_OK;
+}
+
+/**
+  * @brief  TELEM: configure aggregation of telemetry streams (usbd_cli_telem.h)
+  *         "TELEM <stream> OFF|RAW"                  : stop, or send every sample
+  *         "TELEM <stream> STATS <window>"           : min, max, mean and RMS of each window
+  *         "TELEM <stream> FIR <factor> [<tap> ...]" : FIR filter decimated by factor,
+  *                                                     taps in Q15 (moving average if omitted)
+  *         Then (or without a type) the stream is shown, all streams without argument :
+  *         "<name>=<type>[/<window or factor>] [taps=<n>] in=<samples> out=<records> drop=<records>"
+  *         Records are sent on CLI_MUX_TELEMETRY, " ..." at the end if the list continues.
+  * @param  pArg: pointer of arguments string ([<stream name or id> [<type> ...]])
+  * @param  pRes: pointer of response buffer
+  * @retval Result
+  */
+int8_t TELEM(uint8_t* pArg, uint8_t* pRes)
+{
+  static const char* const typeNames[] = { "OFF", "RAW", "STATS", "FIR" };
+  TelemConfig config;
+  TelemStats stats;
+  uint16_t first = 0;
+  uint16_t last = CLI_NUM_OF_TELEM_STREAMS;
+  char *pSave;
+  char *pToken;
+  char *pEnd;
+  long value;
+  int length = 0;
+
+  if(pArg != NULL)
+  {
+    pToken = strtok_r((char*)pArg, " ", &pSave);
+    value = CLI_TelemFindStream(pToken);
+    if(value < 0)
+    {
+      value = strtol(pToken, &pEnd, 10);
+      if(*pEnd != '\0' || pEnd == pToken || value < 0 || CLI_NUM_OF_TELEM_STREAMS <= value)
+      {
+        return CLI_RESULT_INVALID;
+      }
+    }
+    first = (uint16_t)value;
+    last = first + 1;
+
+    pToken = strtok_r(NULL, " ", &pSave);
+    if(pToken != NULL)
+    {
+      memset(&config, 0, sizeof(config));
+      while(config.type <= CLI_TELEM_FIR && strcmp(pToken, typeNames[config.type]) != 0)
+      {
+        ++config.type;
+      }
+      if(config.type == CLI_TELEM_STATS || config.type == CLI_TELEM_FIR)
+      {
+        pToken = strtok_r(NULL, " ", &pSave);
+        value = (pToken != NULL) ? strtol(pToken, &pEnd, 0) : 0;
+        if(pToken == NULL || *pEnd != '\0' || value <= 0 || 0xFFFF < value)
+        {
+          return CLI_RESULT_INVALID;
+        }
+        config.length = (uint16_t)value;
+      }
+      while((pToken = strtok_r(NULL, " ", &pSave)) != NULL)
+      {
+        value = strtol(pToken, &pEnd, 0);
+        if(config.type != CLI_TELEM_FIR || *pEnd != '\0' || pEnd == pToken
+           || value < INT16_MIN || INT16_MAX < value || CLI_TELEM_MAX_TAPS <= config.numTaps)
+        {
+          return CLI_RESULT_INVALID;
+        }
+        config.taps[config.numTaps++] = (int16_t)value;
+      }
+      if(CLI_TelemConfigure((TelemStream)first, &config) != CLI_RESULT_OK)
+      {
+        return CLI_RESULT_INVALID;
+      }
+    }
+  }
+
+  for(uint16_t i=first; i<last; i++)
+  {
+    char item[96];
+    int n;
+
+    CLI_TelemGetConfig((TelemStream)i, &config);
+    CLI_TelemGetStats((TelemStream)i, &stats);
+    n = snprintf(item, sizeof(item), "%s=%s", CLI_TelemStreamName(i), typeNames[config.type]);
+    if(config.type == CLI_TELEM_STATS || config.type == CLI_TELEM_FIR)
+    {
+      n += snprintf(&item[n], sizeof(item) - n, "/%u", config.length);
+    }
+    if(config.type == CLI_TELEM_FIR)
+    {
+      n += snprintf(&item[n], sizeof(item) - n, " taps=%u", config.numTaps);
+    }
+    n += snprintf(&item[n], sizeof(item) - n, " in=%lu out=%lu drop=%lu", (unsigned long)stats.samples,
+                  (unsigned long)stats.records, (unsigned long)stats.dropped);
+
+    // keep room for " ..."
+    if(CLI_RESPONSE_LENGTH - 5 <= length + 1 + n)
+    {
+      strcpy((char*)&pRes[length], " ...");
+      break;
+    }
+    length += sprintf((char*)&pRes[length], "%s%s", (length == 0) ? "" : " ", item);
+  }
+
+  return CLI_RESULT_OK;
+}
+
+/**
+  * @brief  CAPTURE: trigger capture of values (usbd_cli_capture.h)
+  *         "CAPTURE CH <ch> <addr>|OFF"                      : value sampled by a channel (CLI_REG_MAP)
+  *         "CAPTURE TRIG <ch> ABOVE|BELOW|EQ|NE <thr> [<mask>]" : condition on (value & mask)
+  *         "CAPTURE TRIG NONE"                               : event and FIRE only
+  *         "CAPTURE ARM [<pre>]"  : sample, keep <pre> samples before the trigger (default half)
+  *         "CAPTURE FIRE"         : fire the trigger
+  *         "CAPTURE READ"         : stream the frozen window on CLI_MUX_BULK
+  *         "CAPTURE STOP"         : stop sampling
+  *         Then (or without argument) the status is shown :
+  *         "<state> pre=<n> [num=<n> cause=<cause> t=<time> sent=<bytes>/<bytes>] samples=<n>
+  *          trig=<ch>:<op>:<thr>/<mask> ch<n>=<addr> ..."
+  * @param  pArg: pointer of arguments string
+  * @param  pRes: pointer of response buffer
+  * @retval Result
+  */
+int8_t CAPTURE(uint8_t* pArg, uint8_t* pRes)
+{
+  static const char* const stateNames[] = { "IDLE", "ARMED", "TRIGGERED", "FROZEN" };
+  static const char* const opNames[] = { "NONE", "ABOVE", "BELOW", "EQ", "NE" };
+  static const char* const causeNames[] = { "NONE", "VALUE", "EVENT", "COMMAND" };
+  CaptureTrigger trigger;
+  CaptureStatus status;
+  char *pSave;
+  char *pToken;
+  char *pEnd;
+  unsigned long value;
+  int8_t result = CLI_RESULT_OK;
+  int length;
+
+  pToken = (pArg != NULL) ? strtok_r((char*)pArg, " ", &pSave) : NULL;
+  if(pToken == NULL)
+  {
+    // status only
+  }
+  else if(strcmp(pToken, "CH") == 0)
+  {
+    char *pAddr;
+
+    pToken = strtok_r(NULL, " ", &pSave);
+    pAddr = strtok_r(NULL, " ", &pSave);
+    value = (pToken != NULL) ? strtoul(pToken, &pEnd, 10) : 0;
+    if(pToken == NULL || *pEnd != '\0' || pAddr == NULL || strtok_r(NULL, " ", &pSave) != NULL)
+    {
+      return CLI_RESULT_INVALID;
+    }
+    if(strcmp(pAddr, "OFF") == 0)
+    {
+      result = CLI_CaptureSetChannel((uint8_t)value, 0);
+    }
+    else
+    {
+      unsigned long addr = strtoul(pAddr, &pEnd, 0);
+
+      if(*pEnd != '\0' || addr == 0 || 0xFFFFFFFFUL < addr || CLI_CAPTURE_CHANNELS <= value)
+      {
+        return CLI_RESULT_INVALID;
+      }
+      result = CLI_CaptureSetChannel((uint8_t)value, (uint32_t)addr);
+    }
+  }
+  else if(strcmp(pToken, "TRIG") == 0)
+  {
+    memset(&trigger, 0, sizeof(trigger));
+    pToken = strtok_r(NULL, " ", &pSave);
+    if(pToken == NULL)
+    {
+      return CLI_RESULT_INVALID;
+    }
+    if(strcmp(pToken, "NONE") != 0)
+    {
+      value = strtoul(pToken, &pEnd, 10);
+      if(*pEnd != '\0' || CLI_CAPTURE_CHANNELS <= value)
+      {
+        return CLI_RESULT_INVALID;
+      }
+      trigger.channel = (uint8_t)value;
+
+      pToken = strtok_r(NULL, " ", &pSave);
+      trigger.op = CLI_CAPTURE_TRIG_ABOVE;
+      while(pToken != NULL && trigger.op <= CLI_CAPTURE_TRIG_NE && strcmp(pToken, opNames[trigger.op]) != 0)
+      {
+        ++trigger.op;
+      }
+      pToken = strtok_r(NULL, " ", &pSave);
+      value = (pToken != NULL) ? strtoul(pToken, &pEnd, 0) : 0;
+      if(CLI_CAPTURE_TRIG_NE < trigger.op || pToken == NULL || *pEnd != '\0' || 0xFFFFFFFFUL < value)
+      {
+        return CLI_RESULT_INVALID;
+      }
+      trigger.threshold = (uint32_t)value;
+
+      trigger.mask = 0xFFFFFFFFUL;
+      pToken = strtok_r(NULL, " ", &pSave);
+      if(pToken != NULL)
+      {
+        value = strtoul(pToken, &pEnd, 0);
+        if(*pEnd != '\0' || 0xFFFFFFFFUL < value)
+        {
+          return CLI_RESULT_INVALID;
+        }
+        trigger.mask = (uint32_t)value;
+      }
+    }
+    result = CLI_CaptureSetTrigger(&trigger);
+  }
+  else if(strcmp(pToken, "ARM") == 0)
+  {
+    value = CLI_CAPTURE_DEPTH / 2;
+    pToken = strtok_r(NULL, " ", &pSave);
+    if(pToken != NULL)
+    {
+      value = strtoul(pToken, &pEnd, 10);
+      if(*pEnd != '\0' || CLI_CAPTURE_DEPTH <= value)
+      {
+        return CLI_RESULT_INVALID;
+      }
+    }
+    result = CLI_CaptureArm((uint16_t)value);
+  }
+  else if(strcmp(pToken, "FIRE") == 0)
+  {
+    result = CLI_CaptureTrigger(CLI_CAPTURE_CAUSE_COMMAND);
+  }
+  else if(strcmp(pToken, "READ") == 0)
+  {
+    result = CLI_CaptureRead();
+  }
+  else if(strcmp(pToken, "STOP") == 0)
+  {
+    CLI_CaptureStop();
+  }
+  else
+  {
+    return CLI_RESULT_INVALID;
+  }
+  if(result != CLI_RESULT_OK)
+  {
+    return result;
+  }
+
+  CLI_CaptureGetStatus(&status);
+  CLI_CaptureGetTrigger(&trigger);
+  length = snprintf((char*)pRes, CLI_RESPONSE_LENGTH, "%s pre=%u", stateNames[status.state], status.pre);
+  if(status.state == CLI_CAPTURE_FROZEN)
+  {
+    length += snprintf((char*)&pRes[length], CLI_RESPONSE_LENGTH - length, " num=%u cause=%s t=%lu sent=%lu/%lu",
+                       status.num, causeNames[status.cause], (unsigned long)status.time,
+                       (unsigned long)status.sent, (unsigned long)status.length);
+  }
+  length += snprintf((char*)&pRes[length], CLI_RESPONSE_LENGTH - length, " samples=%lu trig=%u:%s:0x%lX/0x%lX",
+                     (unsigned long)status.samples, trigger.channel, opNames[trigger.op],
+                     (unsigned long)trigger.threshold, (unsigned long)trigger.mask);
+  for(uint8_t ch=0; ch<CLI_CAPTURE_CHANNELS; ch++)
+  {
+    char item[24];
+    int n;
+
+    if(CLI_CaptureGetChannel(ch) == 0)
+    {
+      continue;
+    }
+    n = snprintf(item, sizeof(item), " ch%u=0x%08lX", ch, (unsigned long)CLI_CaptureGetChannel(ch));
+
+    // keep room for " ..."
+    if(CLI_RESPONSE_LENGTH - 5 <= length + n)
+    {
+      strcpy((char*)&pRes[length], " ...");
+      break;
+    }
+    length += sprintf((char*)&pRes[length], "%s", item);
+  }
+
+  return CLI_RESULT_OK;
+}
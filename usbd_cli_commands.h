@@ -0,0 +1,70 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_commands.h
+  * @author  Katagiri
+  * @brief   Header file for USB command line's commands.
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CLI_COMMANDS_H
+#define __USBD_CLI_COMMANDS_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "usbd_cli_args.h"
+
+/* Exported types ------------------------------------------------------------*/
+// type of command function
+typedef int8_t (*CommandFxn)(uint8_t* pArg, uint8_t* pRes);
+
+// command definition
+typedef struct
+{
+  const char* name;         // command name (upper case, no spaces)
+  CommandFxn command;       // command function
+  const ArgParser* args;    // arguments validated before command function is called (NULL : not validated)
+  uint8_t flags;            // CLI_CMD_FLAG_xxx
+} CommandUnit;
+
+/* Exported constants --------------------------------------------------------*/
+// flags of CommandUnit
+#define CLI_CMD_FLAG_CACHE        0x01    // response depends only on arguments, keep it in response cache
+
+// max number of command sets registered by CLI_RegisterCommands
+#ifndef CLI_MAX_COMMAND_GROUPS
+#define CLI_MAX_COMMAND_GROUPS    8
+#endif
+
+// max number of commands in the index (CommandSet included)
+#ifndef CLI_MAX_COMMANDS
+#define CLI_MAX_COMMANDS          64
+#endif
+
+// prefix of numeric opcode in command line ("#<opcode> <arguments>")
+#define CLI_OPCODE_PREFIX         '#'
+
+// opcodes : CommandSet has 0 to CLI_OPCODE_USER_BASE - 1 (position in the set),
+// a set of CLI_RegisterCommands has base to base + num - 1, base given by the module
+#ifndef CLI_OPCODE_USER_BASE
+#define CLI_OPCODE_USER_BASE      100
+#endif
+
+// max number of nodes in the trie of command names (one node per distinct prefix)
+#ifndef CLI_TRIE_NODES
+#define CLI_TRIE_NODES            256
+#endif
+
+// build ID reported by BUILD_ID (e.g. -DCLI_BUILD_ID=\"<commit hash>\")
+#ifndef CLI_BUILD_ID
+#define CLI_BUILD_ID              __DATE__ " " __TIME__
+#endif
+
+/* Exported macro ------------------------------------------------------------*/
+/* Exported functions ------------------------------------------------------- */
+int8_t CLI_RegisterCommands(const CommandUnit* pSet, uint16_t num, uint16_t base);
+const CommandUnit* CLI_FindCommand(const char* pName);
+const CommandUnit* CLI_ResolveCommand(const char* pName);
+const CommandUnit* CLI_GetCommand(uint16_t opcode);
+const CommandUnit* CLI_NextCommand(uint16_t* pOpcode);
+
+#endif /* __USBD_CLI_COMMANDS_H */
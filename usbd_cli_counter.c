@@ -0,0 +1,75 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_counter.c
+  * @author  Katagiri
+  * @brief   Source file for USB command line's counter registry.
+  *          Counters and gauges are declared in CLI_COUNTER_MAP, and any
+  *          module updates them with CLI_COUNTER_INC etc. : a load, an add and
+  *          a store on a fixed address, no lock, no registration at run time.
+  *          COUNTERS lists all of them, or the differences since the last list.
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include "usbd_cli_counter.h"
+
+/* Private typedef -----------------------------------------------------------*/
+// declaration of counter
+typedef struct
+{
+  const char* name;         // name shown by COUNTERS
+  uint8_t kind;             // CLI_COUNTER or CLI_GAUGE
+} CounterInfo;
+
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+/* Private function prototypes -----------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static const CounterInfo CounterInfos[CLI_NUM_OF_COUNTERS] =
+{
+#define CLI_COUNTER_INFO(__ID__, __NAME__, __KIND__)    { __NAME__, __KIND__ },
+  CLI_COUNTER_MAP(CLI_COUNTER_INFO)
+  CLI_COUNTER_MAP_USER(CLI_COUNTER_INFO)
+#undef CLI_COUNTER_INFO
+};
+
+static uint32_t LastRead[CLI_NUM_OF_COUNTERS];  // values at the last read
+
+/* Exported variables --------------------------------------------------------*/
+volatile uint32_t CLI_CounterValue[CLI_NUM_OF_COUNTERS];
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  CLI_CounterName: name of counter
+  * @param  id: counter id
+  * @retval Pointer of name, NULL if no such counter
+  */
+const char* CLI_CounterName(uint16_t id)
+{
+  return ( id < CLI_NUM_OF_COUNTERS ) ? CounterInfos[id].name : NULL;
+}
+
+/**
+  * @brief  CLI_CounterKind: kind of counter
+  * @param  id: counter id (valid)
+  * @retval CLI_COUNTER or CLI_GAUGE
+  */
+uint8_t CLI_CounterKind(uint16_t id)
+{
+  return CounterInfos[id].kind;
+}
+
+/**
+  * @brief  CLI_CounterRead: read a counter, and keep the value for the next delta
+  * @param  id: counter id (valid)
+  * @param  delta: 1 to get the difference since the last read (not for gauges)
+  * @retval Value
+  */
+uint32_t CLI_CounterRead(uint16_t id, uint8_t delta)
+{
+  uint32_t value = CLI_CounterValue[id];
+  uint32_t last = LastRead[id];
+
+  LastRead[id] = value;
+  return ( delta && CounterInfos[id].kind == CLI_COUNTER ) ? value - last : value;
+}
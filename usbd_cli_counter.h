@@ -0,0 +1,64 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_counter.h
+  * @author  Katagiri
+  * @brief   Header file for USB command line's counter registry.
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CLI_COUNTER_H
+#define __USBD_CLI_COUNTER_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+// kind of counter
+#define CLI_COUNTER               0     // counts up, COUNTERS -d shows the difference
+#define CLI_GAUGE                 1     // set to the current value
+
+// counter map : X(counter id, name, kind)
+#ifndef CLI_COUNTER_MAP
+#define CLI_COUNTER_MAP(X)                                                      \
+  X(CLI_CNT_RX_BYTES,     "rx.bytes",     CLI_COUNTER)  /* input bytes */       \
+  X(CLI_CNT_RX_DROPS,     "rx.drops",     CLI_COUNTER)  /* ignored, busy */     \
+  X(CLI_CNT_COMMANDS,     "cmd.runs",     CLI_COUNTER)  /* lines executed */    \
+  X(CLI_CNT_CMD_ERRORS,   "cmd.errors",   CLI_COUNTER)  /* result not OK */     \
+  X(CLI_CNT_CMD_CACHED,   "cmd.cached",   CLI_COUNTER)  /* sent from cache */   \
+  X(CLI_GAUGE_CMD_TIME,   "cmd.time",     CLI_GAUGE)    /* last run [count] */  \
+  X(CLI_CNT_TX_DEFERRED,  "tx.deferred",  CLI_COUNTER)  /* endpoint was busy */ \
+  X(CLI_CNT_MUX_FRAMING,  "mux.framing",  CLI_COUNTER)  /* bad frames ignored */
+#endif
+
+// counters of application modules, declared the same way (e.g. in build options)
+#ifndef CLI_COUNTER_MAP_USER
+#define CLI_COUNTER_MAP_USER(X)
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+// counter id
+typedef enum
+{
+#define CLI_COUNTER_ENUM(__ID__, __NAME__, __KIND__)    __ID__,
+  CLI_COUNTER_MAP(CLI_COUNTER_ENUM)
+  CLI_COUNTER_MAP_USER(CLI_COUNTER_ENUM)
+#undef CLI_COUNTER_ENUM
+  CLI_NUM_OF_COUNTERS
+} CounterId;
+
+/* Exported variables --------------------------------------------------------*/
+extern volatile uint32_t CLI_CounterValue[CLI_NUM_OF_COUNTERS];
+
+/* Exported macro ------------------------------------------------------------*/
+// No lock : an increment preempted by an increment of the same counter
+// (other interrupt priority) may be lost, counters are statistics.
+#define CLI_COUNTER_INC(__ID__)           (++CLI_CounterValue[__ID__])
+#define CLI_COUNTER_ADD(__ID__, __N__)    (CLI_CounterValue[__ID__] += (uint32_t)(__N__))
+#define CLI_GAUGE_SET(__ID__, __V__)      (CLI_CounterValue[__ID__] = (uint32_t)(__V__))
+
+/* Exported functions ------------------------------------------------------- */
+const char* CLI_CounterName(uint16_t id);
+uint8_t CLI_CounterKind(uint16_t id);
+uint32_t CLI_CounterRead(uint16_t id, uint8_t delta);
+
+#endif /* __USBD_CLI_COUNTER_H */
@@ -0,0 +1,111 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_enum.c
+  * @author  Katagiri
+  * @brief   Source file for USB command line's enumeration trace.
+  *          Each setup packet is kept in a ring with the time it was received,
+  *          the time spent in descriptor callbacks (usbd_desc.c) while it was
+  *          handled, and the time until its last data or status stage on
+  *          endpoint 0. Gaps between setup packets are the time of USB Host.
+  *          All of them are written in the USB interrupt.
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "usbd_cli_enum.h"
+#include "usbd_cli_time.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+#define ENTRY(__SEQ__)            (&TraceRing[(__SEQ__) % CLI_ENUM_TRACE_SIZE])
+
+/* Private function prototypes -----------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static EnumTraceEntry TraceRing[CLI_ENUM_TRACE_SIZE];
+static volatile uint32_t TraceCount;    // number of setup packets recorded
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  CLI_EnumTraceSetup: record a setup packet (before it is handled)
+  * @param  pSetup: pointer of setup packet (8 bytes)
+  * @retval None
+  */
+void CLI_EnumTraceSetup(const uint8_t* pSetup)
+{
+  EnumTraceEntry *pEntry = ENTRY(TraceCount);
+
+  pEntry->time = CLI_TimeNow();
+  pEntry->descTime = 0;
+  pEntry->doneTime = 0;
+  memcpy(pEntry->setup, pSetup, sizeof(pEntry->setup));
+  ++TraceCount;
+}
+
+/**
+  * @brief  CLI_EnumTraceDescriptor: a descriptor callback returns
+  * @param  start: CLI_TimeNow32() at the beginning of the callback
+  * @retval None
+  */
+void CLI_EnumTraceDescriptor(uint32_t start)
+{
+  uint32_t now = CLI_TimeNow32();
+
+  if( TraceCount != 0 )
+  {
+    ENTRY(TraceCount - 1)->descTime += now - start;
+  }
+}
+
+/**
+  * @brief  CLI_EnumTraceStage: a data or status stage completed on endpoint 0
+  * @retval None
+  */
+void CLI_EnumTraceStage(void)
+{
+  uint64_t now = CLI_TimeNow();
+
+  if( TraceCount != 0 )
+  {
+    EnumTraceEntry *pEntry = ENTRY(TraceCount - 1);
+
+    pEntry->doneTime = (uint32_t)(now - pEntry->time);
+  }
+}
+
+/**
+  * @brief  CLI_EnumTraceCount: number of setup packets recorded
+  *         The last CLI_ENUM_TRACE_SIZE of them are kept.
+  * @retval Number
+  */
+uint32_t CLI_EnumTraceCount(void)
+{
+  return TraceCount;
+}
+
+/**
+  * @brief  CLI_EnumTraceGet: get a recorded control transfer
+  * @param  seq: sequence number (0 : the first after clear)
+  * @param  pEntry: pointer of entry
+  * @retval 1 if kept, 0 if overwritten or not recorded yet
+  */
+uint8_t CLI_EnumTraceGet(uint32_t seq, EnumTraceEntry* pEntry)
+{
+  uint32_t count = TraceCount;
+
+  if( count <= seq || CLI_ENUM_TRACE_SIZE < count - seq )
+  {
+    return 0;
+  }
+  *pEntry = *ENTRY(seq);
+  return 1;
+}
+
+/**
+  * @brief  CLI_EnumTraceClear: clear the trace
+  * @retval None
+  */
+void CLI_EnumTraceClear(void)
+{
+  TraceCount = 0;
+}
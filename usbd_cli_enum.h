@@ -0,0 +1,39 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_enum.h
+  * @author  Katagiri
+  * @brief   Header file for USB command line's enumeration trace.
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CLI_ENUM_H
+#define __USBD_CLI_ENUM_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+// number of setup packets kept (the latest ones)
+#ifndef CLI_ENUM_TRACE_SIZE
+#define CLI_ENUM_TRACE_SIZE       32
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+// a control transfer
+typedef struct
+{
+  uint64_t time;            // time setup packet was received [count] (usbd_cli_time.h)
+  uint32_t descTime;        // time spent in descriptor callbacks [count]
+  uint32_t doneTime;        // time from setup to the last data/status stage [count]
+  uint8_t setup[8];         // setup packet
+} EnumTraceEntry;
+
+/* Exported functions ------------------------------------------------------- */
+void CLI_EnumTraceSetup(const uint8_t* pSetup);
+void CLI_EnumTraceDescriptor(uint32_t start);
+void CLI_EnumTraceStage(void);
+uint32_t CLI_EnumTraceCount(void);
+uint8_t CLI_EnumTraceGet(uint32_t seq, EnumTraceEntry* pEntry);
+void CLI_EnumTraceClear(void);
+
+#endif /* __USBD_CLI_ENUM_H */
@@ -0,0 +1,572 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_mux.c
+  * @author  Katagiri
+  * @brief   Source file for USB command line's channel multiplexer.
+  *          Several logical channels share the CDC bulk endpoints in frames.
+  *          Each channel has its own credits granted by the receiver, so a
+  *          flooded channel can not delay command responses on CLI_MUX_CONTROL
+  *          nor overrun the buffers of the other side.
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "usbd_cli.h"
+#include "usbd_cli_mux.h"
+#include "usbd_cli_counter.h"
+
+/* Private typedef -----------------------------------------------------------*/
+// ring buffer with one writer and one reader
+typedef struct
+{
+  uint8_t* pBuf;              // memory of ring (size + 1 bytes)
+  uint16_t size;              // capacity of ring
+  volatile uint16_t head;     // index to write
+  volatile uint16_t tail;     // index to read
+} MuxRing;
+
+// state of channel
+//  - each counter is written by one context only (USB RX interrupt or TX scheduler)
+typedef struct
+{
+  volatile uint32_t creditGranted;    // credits granted by USB Host (RX)
+  volatile uint32_t creditUsed;       // data bytes sent (TX)
+  volatile uint32_t rxFreed;          // credits to grant to USB Host (RX, control : TX)
+  volatile uint32_t rxGranted;        // credits granted to USB Host (TX)
+  volatile uint32_t rxBytes;          // data bytes received (RX)
+  volatile uint32_t rxDropped;        // data bytes dropped (RX)
+  volatile uint32_t txDropped;        // data bytes not queued (writer)
+  MuxRxFxn receiver;                  // receiver of data from USB Host
+} MuxState;
+
+/* Private define ------------------------------------------------------------*/
+// state of frame parser
+#define PARSE_SYNC                0
+#define PARSE_HEADER              1
+#define PARSE_LENGTH              2
+#define PARSE_PAYLOAD             3
+
+/* Private macro -------------------------------------------------------------*/
+#define FRAME_TYPE(__HEADER__)            ((__HEADER__) >> 4)
+#define FRAME_CHANNEL(__HEADER__)         ((__HEADER__) & 0x0F)
+#define FRAME_HEADER(__TYPE__, __CH__)    (uint8_t)(((__TYPE__) << 4) | (__CH__))
+#define MIN(__A__, __B__)                 (((__A__) < (__B__)) ? (__A__) : (__B__))
+
+/* Private function prototypes -----------------------------------------------*/
+static uint16_t RingUsed(const MuxRing* pRing);
+static uint16_t RingFree(const MuxRing* pRing);
+static void RingPut(MuxRing* pRing, const uint8_t* pData, uint16_t length);
+static void RingGet(MuxRing* pRing, uint8_t* pData, uint16_t length);
+static void ReceivePayload(const uint8_t* pData, uint16_t length);
+static void FeedCommandLine(void);
+static uint16_t PutFrame(uint8_t* pBuf, uint16_t idx, uint8_t header, uint16_t length);
+static uint16_t PutCredits(uint8_t* pBuf, uint16_t size);
+static uint16_t PutControl(uint8_t* pBuf, uint16_t idx, uint16_t size);
+static uint16_t PutChannel(uint8_t* pBuf, uint16_t idx, uint16_t size, MuxChannel ch);
+
+/* Private variables ---------------------------------------------------------*/
+// TX queues of channels
+#define CLI_MUX_STORAGE(__ID__, __SIZE__)   \
+  static uint8_t __ID__##_Queue[(__SIZE__) + 1];
+CLI_MUX_CHANNEL_MAP(CLI_MUX_STORAGE)
+#undef CLI_MUX_STORAGE
+
+static MuxRing TxQueues[CLI_MUX_NUM_OF_CHANNELS] =
+{
+#define CLI_MUX_QUEUE(__ID__, __SIZE__)   \
+  { __ID__##_Queue, (__SIZE__), 0, 0 },
+  CLI_MUX_CHANNEL_MAP(CLI_MUX_QUEUE)
+#undef CLI_MUX_QUEUE
+};
+
+static uint8_t RxBuffer[CLI_MUX_RX_SIZE + 1];
+static MuxRing RxRing = { RxBuffer, CLI_MUX_RX_SIZE, 0, 0 };   // command input of CLI_MUX_CONTROL
+
+static MuxState States[CLI_MUX_NUM_OF_CHANNELS];
+static volatile uint8_t MuxActive;      // 1 : multiplexed mode
+static uint8_t ParseState;              // state of frame parser
+static uint8_t ParseHeader;             // header of frame being received
+static uint8_t ParseLength;             // payload length of the frame
+static uint8_t ParseRemain;             // payload bytes left in the frame
+static uint8_t ParseCredit[2];          // payload of CREDIT frame
+static uint8_t* pControl;               // CLI output being sent on CLI_MUX_CONTROL
+static uint16_t ControlLeft;            // length left of pControl
+static uint8_t NextChannel;             // channel sent first after CLI_MUX_CONTROL (round robin)
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  CLI_MuxStart: enter multiplexed mode.
+  *         Initial credits are granted to USB Host in the first frames sent.
+  * @retval None
+  */
+void CLI_MuxStart(void)
+{
+  if( MuxActive )
+  {
+    return;
+  }
+
+  for(uint16_t ch=0; ch<CLI_MUX_NUM_OF_CHANNELS; ch++)
+  {
+    MuxRxFxn receiver = States[ch].receiver;
+
+    memset(&States[ch], 0, sizeof(MuxState));
+    States[ch].receiver = receiver;
+    States[ch].rxFreed = (ch == CLI_MUX_CONTROL) ? CLI_MUX_RX_SIZE : CLI_MUX_RX_WINDOW;
+    TxQueues[ch].head = 0;
+    TxQueues[ch].tail = 0;
+  }
+  RxRing.head = 0;
+  RxRing.tail = 0;
+  ParseState = PARSE_SYNC;
+  pControl = NULL;
+  ControlLeft = 0;
+  NextChannel = CLI_MUX_CONTROL + 1;
+
+  MuxActive = 1;
+}
+
+/**
+  * @brief  CLI_MuxStop: leave multiplexed mode, the command line is text again.
+  * @retval None
+  */
+void CLI_MuxStop(void)
+{
+  MuxActive = 0;
+}
+
+/**
+  * @brief  CLI_MuxIsActive: check the mode
+  * @retval 1 if multiplexed mode, 0 if text mode
+  */
+uint8_t CLI_MuxIsActive(void)
+{
+  return MuxActive;
+}
+
+/**
+  * @brief  CLI_MuxInput: parse frames received from USB Host.
+  *         Frames may be split across packets.
+  * @param  pInput: pointer of received data
+  * @param  length: length of received data
+  * @retval None
+  */
+void CLI_MuxInput(uint8_t* pInput, uint16_t length)
+{
+  uint16_t i = 0;
+
+  while( i < length && MuxActive )
+  {
+    switch( ParseState )
+    {
+    case PARSE_SYNC:
+      if( pInput[i] == CLI_MUX_SYNC )
+      {
+        ParseState = PARSE_HEADER;
+      }
+      ++i;
+      break;
+
+    case PARSE_HEADER:
+      ParseHeader = pInput[i++];
+      ParseState = PARSE_LENGTH;
+      break;
+
+    case PARSE_LENGTH:
+      ParseLength = pInput[i++];
+      ParseRemain = ParseLength;
+      ParseState = ( ParseRemain != 0 ) ? PARSE_PAYLOAD : PARSE_SYNC;
+      if( FRAME_TYPE(ParseHeader) == CLI_MUX_TYPE_RESET )
+      {
+        CLI_MuxStop();
+      }
+      else if( FRAME_TYPE(ParseHeader) == CLI_MUX_TYPE_CREDIT && ParseLength != 2 )
+      {
+        // its payload is skipped
+        CLI_COUNTER_INC(CLI_CNT_MUX_FRAMING);
+      }
+      break;
+
+    default:  // PARSE_PAYLOAD
+    {
+      uint16_t n = MIN((uint16_t)ParseRemain, length - i);
+
+      ReceivePayload(&pInput[i], n);
+      ParseRemain -= (uint8_t)n;
+      i += n;
+      if( ParseRemain == 0 )
+      {
+        ParseState = PARSE_SYNC;
+      }
+      break;
+    }
+    }
+  }
+}
+
+/**
+  * @brief  CLI_MuxOutputControl: run received command lines and build frames of
+  *         credits and CLI_MUX_CONTROL (TX scheduler, control priority).
+  * @param  pBuf: pointer of packet buffer
+  * @param  size: free size of packet buffer
+  * @retval Length of frames
+  */
+uint16_t CLI_MuxOutputControl(uint8_t* pBuf, uint16_t size)
+{
+  FeedCommandLine();
+
+  return PutControl(pBuf, PutCredits(pBuf, size), size);
+}
+
+/**
+  * @brief  CLI_MuxOutputStream: build frames of queued channels in turn
+  *         (TX scheduler, stream priority).
+  * @param  pBuf: pointer of packet buffer
+  * @param  size: free size of packet buffer
+  * @retval Length of frames
+  */
+uint16_t CLI_MuxOutputStream(uint8_t* pBuf, uint16_t size)
+{
+  uint16_t idx = 0;
+
+  for(uint16_t i=0; i<CLI_MUX_NUM_OF_CHANNELS - 1; i++)
+  {
+    uint16_t ch = CLI_MUX_CONTROL + 1 + (NextChannel - 1 + i) % (CLI_MUX_NUM_OF_CHANNELS - 1);
+    idx = PutChannel(pBuf, idx, size, (MuxChannel)ch);
+  }
+  NextChannel = ( NextChannel + 1 < CLI_MUX_NUM_OF_CHANNELS ) ? NextChannel + 1 : CLI_MUX_CONTROL + 1;
+
+  return idx;
+}
+
+/**
+  * @brief  CLI_MuxWrite: queue data to send on a channel.
+  *         Data is queued entirely or not at all. One writer context per channel.
+  * @param  ch: channel (not CLI_MUX_CONTROL)
+  * @param  pData: pointer of data
+  * @param  length: length of data
+  * @retval Length queued, 0 if the queue is full or not in multiplexed mode
+  */
+uint16_t CLI_MuxWrite(MuxChannel ch, const uint8_t* pData, uint16_t length)
+{
+  if( !MuxActive || ch == CLI_MUX_CONTROL || CLI_MUX_NUM_OF_CHANNELS <= ch )
+  {
+    return 0;
+  }
+  if( RingFree(&TxQueues[ch]) < length )
+  {
+    States[ch].txDropped += length;
+    return 0;
+  }
+
+  RingPut(&TxQueues[ch], pData, length);
+  return length;
+}
+
+/**
+  * @brief  CLI_MuxSetReceiver: set the function receiving data of a channel.
+  *         The function is called from USB RX interrupt, and the data has to be
+  *         taken before it returns. Credits are granted again after that.
+  * @param  ch: channel (not CLI_MUX_CONTROL)
+  * @param  receiver: receiver function, NULL to drop data
+  * @retval None
+  */
+void CLI_MuxSetReceiver(MuxChannel ch, MuxRxFxn receiver)
+{
+  if( ch != CLI_MUX_CONTROL && ch < CLI_MUX_NUM_OF_CHANNELS )
+  {
+    States[ch].receiver = receiver;
+  }
+}
+
+/**
+  * @brief  CLI_MuxGetStats: get statistics of a channel
+  * @param  ch: channel
+  * @param  pStats: pointer of statistics
+  * @retval None
+  */
+void CLI_MuxGetStats(MuxChannel ch, MuxStats* pStats)
+{
+  pStats->txBytes = States[ch].creditUsed;
+  pStats->rxBytes = States[ch].rxBytes;
+  pStats->txDropped = States[ch].txDropped;
+  pStats->rxDropped = States[ch].rxDropped;
+  pStats->txCredit = States[ch].creditGranted - States[ch].creditUsed;
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  RingUsed: number of bytes in ring
+  * @param  pRing: pointer of ring
+  * @retval Number of bytes
+  */
+static uint16_t RingUsed(const MuxRing* pRing)
+{
+  uint16_t head = pRing->head;
+  uint16_t tail = pRing->tail;
+
+  return ( tail <= head ) ? head - tail : (uint16_t)(pRing->size + 1 - tail + head);
+}
+
+/**
+  * @brief  RingFree: number of bytes which can be put in ring
+  * @param  pRing: pointer of ring
+  * @retval Number of bytes
+  */
+static uint16_t RingFree(const MuxRing* pRing)
+{
+  return pRing->size - RingUsed(pRing);
+}
+
+/**
+  * @brief  RingPut: put data in ring (caller checked free space)
+  * @param  pRing: pointer of ring
+  * @param  pData: pointer of data
+  * @param  length: length of data
+  * @retval None
+  */
+static void RingPut(MuxRing* pRing, const uint8_t* pData, uint16_t length)
+{
+  uint16_t head = pRing->head;
+  uint16_t n = MIN(length, (uint16_t)(pRing->size + 1 - head));
+
+  memcpy(&pRing->pBuf[head], pData, n);
+  memcpy(&pRing->pBuf[0], &pData[n], length - n);
+  head += length;
+  pRing->head = ( pRing->size < head ) ? head - (pRing->size + 1) : head;
+}
+
+/**
+  * @brief  RingGet: take data from ring (caller checked used size)
+  * @param  pRing: pointer of ring
+  * @param  pData: pointer of buffer
+  * @param  length: length of data
+  * @retval None
+  */
+static void RingGet(MuxRing* pRing, uint8_t* pData, uint16_t length)
+{
+  uint16_t tail = pRing->tail;
+  uint16_t n = MIN(length, (uint16_t)(pRing->size + 1 - tail));
+
+  memcpy(pData, &pRing->pBuf[tail], n);
+  memcpy(&pData[n], &pRing->pBuf[0], length - n);
+  tail += length;
+  pRing->tail = ( pRing->size < tail ) ? tail - (pRing->size + 1) : tail;
+}
+
+/**
+  * @brief  ReceivePayload: handle payload of the frame being received
+  * @param  pData: pointer of payload (part of it)
+  * @param  length: length of payload
+  * @retval None
+  */
+static void ReceivePayload(const uint8_t* pData, uint16_t length)
+{
+  uint8_t ch = FRAME_CHANNEL(ParseHeader);
+  MuxState *pState;
+
+  if( CLI_MUX_NUM_OF_CHANNELS <= ch )
+  {
+    return;
+  }
+  pState = &States[ch];
+
+  switch( FRAME_TYPE(ParseHeader) )
+  {
+  case CLI_MUX_TYPE_DATA:
+    pState->rxBytes += length;
+    if( ch == CLI_MUX_CONTROL )
+    {
+      // command lines are run in the polling interval, as they were granted
+      uint16_t n = MIN(length, RingFree(&RxRing));
+      RingPut(&RxRing, pData, n);
+      pState->rxDropped += length - n;
+    }
+    else
+    {
+      if( pState->receiver != NULL )
+      {
+        pState->receiver(pData, length);
+      }
+      else
+      {
+        pState->rxDropped += length;
+      }
+      pState->rxFreed += length;
+    }
+    break;
+
+  case CLI_MUX_TYPE_CREDIT:
+    if( ParseLength != 2 )
+    {
+      // framing error (counted on the length)
+      break;
+    }
+    for(uint16_t i=0; i<length; i++)
+    {
+      ParseCredit[(ParseRemain - i) & 1] = pData[i];
+      if( ParseRemain - i == 1 )
+      {
+        // the last byte of payload, credits are little endian uint16_t
+        pState->creditGranted += (uint32_t)ParseCredit[0] | ((uint32_t)ParseCredit[1] << 8);
+      }
+    }
+    break;
+
+  default:
+    break;
+  }
+}
+
+/**
+  * @brief  FeedCommandLine: pass received command input to the interpreter.
+  *         Input is passed line by line while the interpreter has a free slot,
+  *         and credits are returned for the bytes passed.
+  * @retval None
+  */
+static void FeedCommandLine(void)
+{
+  uint8_t line[CLI_COMMAND_LENGTH];
+
+  while( CLI_InputReady() && 0 < RingUsed(&RxRing) )
+  {
+    uint16_t length = MIN(RingUsed(&RxRing), (uint16_t)sizeof(line));
+    uint16_t tail = RxRing.tail;
+    uint16_t n;
+
+    // take up to the end of the first line
+    for(n=0; n<length; n++)
+    {
+      if( RxRing.pBuf[tail] == '\n' )
+      {
+        ++n;
+        break;
+      }
+      tail = ( tail < RxRing.size ) ? tail + 1 : 0;
+    }
+
+    RingGet(&RxRing, line, n);
+    States[CLI_MUX_CONTROL].rxFreed += n;
+    CLI_Input(line, n);
+  }
+}
+
+/**
+  * @brief  PutFrame: write a frame header in packet buffer
+  * @param  pBuf: pointer of packet buffer
+  * @param  idx: index of packet buffer
+  * @param  header: type and channel
+  * @param  length: length of payload
+  * @retval Index of payload
+  */
+static uint16_t PutFrame(uint8_t* pBuf, uint16_t idx, uint8_t header, uint16_t length)
+{
+  pBuf[idx++] = CLI_MUX_SYNC;
+  pBuf[idx++] = header;
+  pBuf[idx++] = (uint8_t)length;
+  return idx;
+}
+
+/**
+  * @brief  PutCredits: grant credits of freed buffers to USB Host
+  * @param  pBuf: pointer of packet buffer
+  * @param  size: size of packet buffer
+  * @retval Index of packet buffer after the frames
+  */
+static uint16_t PutCredits(uint8_t* pBuf, uint16_t size)
+{
+  uint16_t idx = 0;
+
+  for(uint16_t ch=0; ch<CLI_MUX_NUM_OF_CHANNELS; ch++)
+  {
+    uint32_t credit = MIN(States[ch].rxFreed - States[ch].rxGranted, 0xFFFFUL);
+
+    if( credit == 0 || size < idx + CLI_MUX_HEADER_LENGTH + 2 )
+    {
+      continue;
+    }
+    idx = PutFrame(pBuf, idx, FRAME_HEADER(CLI_MUX_TYPE_CREDIT, ch), 2);
+    pBuf[idx++] = (uint8_t)credit;
+    pBuf[idx++] = (uint8_t)(credit >> 8);
+    States[ch].rxGranted += credit;
+  }
+  return idx;
+}
+
+/**
+  * @brief  PutControl: put output of the interpreter in CLI_MUX_CONTROL frames
+  * @param  pBuf: pointer of packet buffer
+  * @param  idx: index of packet buffer
+  * @param  size: size of packet buffer
+  * @retval Index of packet buffer after the frames
+  */
+static uint16_t PutControl(uint8_t* pBuf, uint16_t idx, uint16_t size)
+{
+  MuxState *pState = &States[CLI_MUX_CONTROL];
+
+  while( idx + CLI_MUX_HEADER_LENGTH < size )
+  {
+    uint32_t credit = pState->creditGranted - pState->creditUsed;
+    uint16_t n;
+
+    if( ControlLeft == 0 )
+    {
+      if( credit == 0 )
+      {
+        break;
+      }
+      pControl = CLI_Output();
+      if( pControl == NULL || *pControl == '\0' )
+      {
+        break;
+      }
+      ControlLeft = (uint16_t)strlen((const char*)pControl);
+    }
+
+    n = MIN(ControlLeft, size - idx - CLI_MUX_HEADER_LENGTH);
+    n = MIN(n, CLI_MUX_MAX_PAYLOAD);
+    n = (uint16_t)MIN((uint32_t)n, credit);
+    if( n == 0 )
+    {
+      break;
+    }
+    idx = PutFrame(pBuf, idx, FRAME_HEADER(CLI_MUX_TYPE_DATA, CLI_MUX_CONTROL), n);
+    memcpy(&pBuf[idx], pControl, n);
+    idx += n;
+    pControl += n;
+    ControlLeft -= n;
+    pState->creditUsed += n;
+  }
+  return idx;
+}
+
+/**
+  * @brief  PutChannel: put queued data of a channel in frames
+  * @param  pBuf: pointer of packet buffer
+  * @param  idx: index of packet buffer
+  * @param  size: size of packet buffer
+  * @param  ch: channel
+  * @retval Index of packet buffer after the frames
+  */
+static uint16_t PutChannel(uint8_t* pBuf, uint16_t idx, uint16_t size, MuxChannel ch)
+{
+  MuxState *pState = &States[ch];
+
+  while( idx + CLI_MUX_HEADER_LENGTH < size )
+  {
+    uint32_t credit = pState->creditGranted - pState->creditUsed;
+    uint16_t n = MIN(RingUsed(&TxQueues[ch]), size - idx - CLI_MUX_HEADER_LENGTH);
+
+    n = MIN(n, CLI_MUX_MAX_PAYLOAD);
+    n = (uint16_t)MIN((uint32_t)n, credit);
+    if( n == 0 )
+    {
+      break;
+    }
+    idx = PutFrame(pBuf, idx, FRAME_HEADER(CLI_MUX_TYPE_DATA, ch), n);
+    RingGet(&TxQueues[ch], &pBuf[idx], n);
+    idx += n;
+    pState->creditUsed += n;
+  }
+  return idx;
+}
@@ -0,0 +1,97 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_mux.h
+  * @author  Katagiri
+  * @brief   Header file for USB command line's channel multiplexer.
+  *          This header is shared with the host library (host/cli_mux.h).
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CLI_MUX_H
+#define __USBD_CLI_MUX_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "usbd_cli.h"
+
+/* Exported constants --------------------------------------------------------*/
+/*
+  Frame format (both directions)
+    [SYNC] [type << 4 | channel] [length] [payload (length bytes)]
+
+  - MUX_TYPE_DATA   : payload is data of the channel
+  - MUX_TYPE_CREDIT : payload is uint16_t (little endian), number of data bytes
+                      the receiver can take more on the channel. A frame of
+                      another length is a framing error, and is ignored
+  - MUX_TYPE_RESET  : host to device only, leave multiplexed mode (no payload)
+
+  A sender never sends more data bytes on a channel than the credits granted
+  by the receiver, so buffers of the receiver never overrun.
+*/
+#define CLI_MUX_SYNC              0xA5
+#define CLI_MUX_HEADER_LENGTH     3
+#define CLI_MUX_MAX_PAYLOAD       255
+
+#define CLI_MUX_TYPE_DATA         0x0
+#define CLI_MUX_TYPE_CREDIT       0x1
+#define CLI_MUX_TYPE_RESET        0x2
+
+// command line to enter multiplexed mode (sent in text mode)
+#define CLI_MUX_START_COMMAND     "MUX"
+
+// channel map : X(channel id, size of TX queue in device)
+//  - CLI_MUX_CONTROL is sent with control priority, others share the rest in turn
+//  - CLI_MUX_CONTROL carries the command line, it has no queue
+#ifndef CLI_MUX_CHANNEL_MAP
+#define CLI_MUX_CHANNEL_MAP(X)                                                  \
+  X(CLI_MUX_CONTROL,    0)      /* command lines and responses */               \
+  X(CLI_MUX_LOG,        256)    /* log messages */                              \
+  X(CLI_MUX_TELEMETRY,  256)    /* telemetry samples */                         \
+  X(CLI_MUX_BULK,       512)    /* bulk data */
+#endif
+
+// size of buffer for command input received on CLI_MUX_CONTROL
+#ifndef CLI_MUX_RX_SIZE
+#define CLI_MUX_RX_SIZE           256
+#endif
+
+// credits granted to the host for other channels (data is passed to receiver at once)
+#ifndef CLI_MUX_RX_WINDOW
+#define CLI_MUX_RX_WINDOW         512
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+// channel id
+typedef enum
+{
+#define CLI_MUX_ENUM(__ID__, __SIZE__)    __ID__,
+  CLI_MUX_CHANNEL_MAP(CLI_MUX_ENUM)
+#undef CLI_MUX_ENUM
+  CLI_MUX_NUM_OF_CHANNELS
+} MuxChannel;
+
+// type of function receiving data of a channel from USB Host
+typedef void (*MuxRxFxn)(const uint8_t* pData, uint16_t length);
+
+// statistics of channel
+typedef struct
+{
+  uint32_t txBytes;         // data bytes sent
+  uint32_t rxBytes;         // data bytes received
+  uint32_t txDropped;       // data bytes not queued (queue full)
+  uint32_t rxDropped;       // data bytes received beyond credits, or without receiver
+  uint32_t txCredit;        // credits granted by USB Host, not used yet
+} MuxStats;
+
+/* Exported functions ------------------------------------------------------- */
+void CLI_MuxStart(void);
+void CLI_MuxStop(void);
+uint8_t CLI_MuxIsActive(void);
+void CLI_MuxInput(uint8_t* pInput, uint16_t length);
+uint16_t CLI_MuxOutputControl(uint8_t* pBuf, uint16_t size);
+uint16_t CLI_MuxOutputStream(uint8_t* pBuf, uint16_t size);
+uint16_t CLI_MuxWrite(MuxChannel ch, const uint8_t* pData, uint16_t length);
+void CLI_MuxSetReceiver(MuxChannel ch, MuxRxFxn receiver);
+void CLI_MuxGetStats(MuxChannel ch, MuxStats* pStats);
+
+#endif /* __USBD_CLI_MUX_H */
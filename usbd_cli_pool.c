@@ -0,0 +1,224 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_pool.c
+  * @author  Katagiri
+  * @brief   Source file for USB command line's fixed-size block pools.
+  *          Free blocks are kept in a lock-free list (LDREX/STREX), so blocks
+  *          can be allocated and freed from interrupts and thread context.
+  *          All blocks of a pool have the same size, no fragmentation occurs.
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_cli_pool.h"
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+#include "stm32f4xx.h"
+#endif
+
+/* Private typedef -----------------------------------------------------------*/
+// free block
+typedef struct PoolBlock
+{
+  struct PoolBlock* pNext;
+} PoolBlock;
+
+// configuration of pool
+typedef struct
+{
+  void** pStorage;          // memory of blocks
+  uint16_t blockSize;       // size of a block (multiple of pointer size)
+  uint16_t numBlocks;       // number of blocks
+} PoolConfig;
+
+// state of pool
+typedef struct
+{
+  PoolBlock* volatile pFree;      // list of free blocks
+  volatile uint32_t inUse;        // number of allocated blocks
+  volatile uint32_t exhausted;    // number of allocations failed
+} PoolState;
+
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+// number of pointers to store a block
+#define BLOCK_PTRS(__SIZE__)      (((__SIZE__) + sizeof(void*) - 1) / sizeof(void*))
+
+/* Private function prototypes -----------------------------------------------*/
+static PoolBlock* PopBlock(PoolState* pState);
+static void PushBlock(PoolState* pState, PoolBlock* pBlock);
+static void AtomicAdd(volatile uint32_t* pValue, int32_t add);
+
+/* Private variables ---------------------------------------------------------*/
+// memory of blocks
+#define CLI_POOL_STORAGE(__ID__, __SIZE__, __NUM__)   \
+  static void* __ID__##_Storage[BLOCK_PTRS(__SIZE__) * (__NUM__)];
+CLI_POOL_MAP(CLI_POOL_STORAGE)
+#undef CLI_POOL_STORAGE
+
+// pool map
+static const PoolConfig PoolConfigs[CLI_NUM_OF_POOLS] =
+{
+#define CLI_POOL_CONFIG(__ID__, __SIZE__, __NUM__)    \
+  { __ID__##_Storage, (uint16_t)(BLOCK_PTRS(__SIZE__) * sizeof(void*)), (__NUM__) },
+  CLI_POOL_MAP(CLI_POOL_CONFIG)
+#undef CLI_POOL_CONFIG
+};
+
+static PoolState PoolStates[CLI_NUM_OF_POOLS];
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  CLI_PoolInit: link all blocks in free lists. Call before pools are used.
+  * @retval None
+  */
+void CLI_PoolInit(void)
+{
+  for(uint16_t id=0; id<CLI_NUM_OF_POOLS; id++)
+  {
+    const PoolConfig *pConfig = &PoolConfigs[id];
+    uint8_t *pMem = (uint8_t*)pConfig->pStorage;
+
+    PoolStates[id].pFree = NULL;
+    PoolStates[id].inUse = 0;
+    PoolStates[id].exhausted = 0;
+    for(uint16_t i=pConfig->numBlocks; 0<i; i--)
+    {
+      PoolBlock *pBlock = (PoolBlock*)(pMem + (uint32_t)(i - 1) * pConfig->blockSize);
+      pBlock->pNext = PoolStates[id].pFree;
+      PoolStates[id].pFree = pBlock;
+    }
+  }
+}
+
+/**
+  * @brief  CLI_PoolAlloc: take a block from a pool
+  * @param  id: pool id
+  * @retval Pointer of block, NULL if the pool is exhausted
+  */
+void* CLI_PoolAlloc(PoolId id)
+{
+  PoolBlock *pBlock = PopBlock(&PoolStates[id]);
+
+  if(pBlock == NULL)
+  {
+    AtomicAdd(&PoolStates[id].exhausted, 1);
+    return NULL;
+  }
+  AtomicAdd(&PoolStates[id].inUse, 1);
+  return pBlock;
+}
+
+/**
+  * @brief  CLI_PoolFree: return a block to its pool
+  * @param  id: pool id the block was taken from
+  * @param  pBlock: pointer of block
+  * @retval None
+  */
+void CLI_PoolFree(PoolId id, void* pBlock)
+{
+  if(pBlock == NULL)
+  {
+    return;
+  }
+  PushBlock(&PoolStates[id], (PoolBlock*)pBlock);
+  AtomicAdd(&PoolStates[id].inUse, -1);
+}
+
+/**
+  * @brief  CLI_PoolGetStats: get statistics of a pool
+  * @param  id: pool id
+  * @param  pStats: pointer of statistics
+  * @retval None
+  */
+void CLI_PoolGetStats(PoolId id, PoolStats* pStats)
+{
+  pStats->blockSize = PoolConfigs[id].blockSize;
+  pStats->numBlocks = PoolConfigs[id].numBlocks;
+  pStats->inUse = PoolStates[id].inUse;
+  pStats->exhausted = PoolStates[id].exhausted;
+}
+
+/* Private functions ---------------------------------------------------------*/
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+/*
+  Exclusive monitor is cleared on exception entry and return, so STREX fails
+  whenever an interrupt ran between LDREX and STREX. The list head can not be
+  changed behind our back (no ABA problem) and the operation is just retried.
+*/
+/**
+  * @brief  PopBlock: take the first block of free list
+  * @param  pState: pointer of pool state
+  * @retval Pointer of block, NULL if the list is empty
+  */
+static PoolBlock* PopBlock(PoolState* pState)
+{
+  PoolBlock *pBlock;
+
+  do
+  {
+    pBlock = (PoolBlock*)__LDREXW((volatile uint32_t*)&pState->pFree);
+    if(pBlock == NULL)
+    {
+      __CLREX();
+      return NULL;
+    }
+  } while(__STREXW((uint32_t)pBlock->pNext, (volatile uint32_t*)&pState->pFree) != 0);
+
+  return pBlock;
+}
+
+/**
+  * @brief  PushBlock: put a block at the head of free list
+  * @param  pState: pointer of pool state
+  * @param  pBlock: pointer of block
+  * @retval None
+  */
+static void PushBlock(PoolState* pState, PoolBlock* pBlock)
+{
+  do
+  {
+    pBlock->pNext = (PoolBlock*)__LDREXW((volatile uint32_t*)&pState->pFree);
+  } while(__STREXW((uint32_t)pBlock, (volatile uint32_t*)&pState->pFree) != 0);
+}
+
+/**
+  * @brief  AtomicAdd: add to a counter shared with interrupts
+  * @param  pValue: pointer of counter
+  * @param  add: value to add
+  * @retval None
+  */
+static void AtomicAdd(volatile uint32_t* pValue, int32_t add)
+{
+  uint32_t value;
+
+  do
+  {
+    value = __LDREXW(pValue);
+  } while(__STREXW(value + (uint32_t)add, pValue) != 0);
+}
+
+#else
+/* Host build (simulation) : same functions with compiler atomics */
+static PoolBlock* PopBlock(PoolState* pState)
+{
+  PoolBlock *pBlock = __atomic_load_n(&pState->pFree, __ATOMIC_ACQUIRE);
+
+  while(pBlock != NULL
+        && !__atomic_compare_exchange_n(&pState->pFree, &pBlock, pBlock->pNext, 1, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+  {
+  }
+  return pBlock;
+}
+
+static void PushBlock(PoolState* pState, PoolBlock* pBlock)
+{
+  pBlock->pNext = __atomic_load_n(&pState->pFree, __ATOMIC_RELAXED);
+  while(!__atomic_compare_exchange_n(&pState->pFree, &pBlock->pNext, pBlock, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+  {
+  }
+}
+
+static void AtomicAdd(volatile uint32_t* pValue, int32_t add)
+{
+  __atomic_fetch_add(pValue, (uint32_t)add, __ATOMIC_RELAXED);
+}
+#endif
@@ -0,0 +1,54 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_pool.h
+  * @author  Katagiri
+  * @brief   Header file for USB command line's fixed-size block pools.
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CLI_POOL_H
+#define __USBD_CLI_POOL_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "usbd_cli.h"
+
+/* Exported constants --------------------------------------------------------*/
+// size of USB bulk packet
+#ifndef CLI_POOL_PACKET_SIZE
+#define CLI_POOL_PACKET_SIZE      64
+#endif
+
+// pool map : X(pool id, block size, number of blocks)
+// (only pools in use, define the map in build options to add pools of the application)
+#ifndef CLI_POOL_MAP
+#define CLI_POOL_MAP(X)                                                         \
+  X(CLI_POOL_TX,    CLI_POOL_PACKET_SIZE,   1)    /* TX packet (one on the endpoint at a time) */
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+// pool id
+typedef enum
+{
+#define CLI_POOL_ENUM(__ID__, __SIZE__, __NUM__)    __ID__,
+  CLI_POOL_MAP(CLI_POOL_ENUM)
+#undef CLI_POOL_ENUM
+  CLI_NUM_OF_POOLS
+} PoolId;
+
+// statistics of pool
+typedef struct
+{
+  uint16_t blockSize;       // size of a block
+  uint16_t numBlocks;       // number of blocks
+  uint32_t inUse;           // number of allocated blocks
+  uint32_t exhausted;       // number of allocations failed
+} PoolStats;
+
+/* Exported functions ------------------------------------------------------- */
+void CLI_PoolInit(void);
+void* CLI_PoolAlloc(PoolId id);
+void CLI_PoolFree(PoolId id, void* pBlock);
+void CLI_PoolGetStats(PoolId id, PoolStats* pStats);
+
+#endif /* __USBD_CLI_POOL_H */
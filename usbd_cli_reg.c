@@ -0,0 +1,452 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_reg.c
+  * @author  Katagiri
+  * @brief   Source file for USB command line's register batch.
+  *          A list of register operations is parsed entirely first, then run
+  *          back to back in one command, and all read values are returned
+  *          in one response.
+  *
+  *          REG_BATCH <op>;<op>;...
+  *            R <addr>                 read 32-bit register
+  *            W <addr> <value>         write
+  *            M <addr> <mask> <value>  modify : (reg & ~mask) | (value & mask)
+  *            D <us>                   delay (busy wait)
+  *            I                        mask interrupts (atomic section begins)
+  *            E                        unmask interrupts (atomic section ends)
+  *          Addresses are checked against the memory map (CLI_REG_MAP), an
+  *          access out of it would end in a bus fault. The map is shared with
+  *          the trigger capture (usbd_cli_capture.c), whose channels are read
+  *          by CLI_RegRead in SysTick.
+  *          Numbers are decimal or hexadecimal with "0x", up to 32 bits. Delays
+  *          of a batch are CLI_REG_DELAY_MAX in total, as the batch runs in the
+  *          USB interrupt. Interrupts masked by I are unmasked at the end of the
+  *          batch in any case.
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "usbd_cli.h"
+#include "usbd_cli_reg.h"
+#include "usbd_cli_arena.h"
+#include "usbd_cli_time.h"
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+#include "stm32f4xx.h"
+#else
+#include <time.h>
+#endif
+
+/* Private typedef -----------------------------------------------------------*/
+// operation of batch
+typedef struct
+{
+  uint8_t type;             // 'R', 'W', 'M', 'D', 'I' or 'E'
+  uint32_t addr;            // address of register (delay for 'D')
+  uint32_t mask;            // bits to modify
+  uint32_t value;           // value to write
+} RegOp;
+
+/* Private define ------------------------------------------------------------*/
+#define OP_SEPARATOR              ';'
+
+/* Private macro -------------------------------------------------------------*/
+/* Private function prototypes -----------------------------------------------*/
+static uint8_t ParseOp(char* pStr, RegOp* pOp);
+static uint8_t ParseNumbers(char* pStr, uint32_t* pValues, uint8_t num);
+static char* ParseNumber(char* pStr, uint32_t* pValue);
+static uint32_t RegRead(uint32_t addr);
+static void RegWrite(uint32_t addr, uint32_t value);
+static void DelayUs(uint32_t us);
+static uint32_t MaskIrq(void);
+static void UnmaskIrq(uint32_t state);
+
+/* Private variables ---------------------------------------------------------*/
+// memory map
+static const uint32_t RegMap[][2] =
+{
+#define CLI_REG_RANGE(__FIRST__, __LAST__)    { (__FIRST__), (__LAST__) },
+  CLI_REG_MAP(CLI_REG_RANGE)
+#undef CLI_REG_RANGE
+};
+
+#if !defined(__ARM_ARCH_7M__) && !defined(__ARM_ARCH_7EM__)
+static uint32_t SimRegs[256];           // registers of host build
+#endif
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  CLI_RegBatch: REG_BATCH command
+  *         Nothing is run if any operation is invalid.
+  * @param  pArg: pointer of arguments string (operations)
+  * @param  pRes: pointer of response buffer (read values in order, "OK" if none)
+  * @retval Result
+  */
+int8_t CLI_RegBatch(uint8_t* pArg, uint8_t* pRes)
+{
+  RegOp *pOps = CLI_ArenaAlloc(sizeof(RegOp) * CLI_REG_BATCH_MAX);
+  char *pStr = (char*)pArg;
+  uint16_t num = 0;
+  uint32_t delay = 0;
+  uint32_t irqState = 0;
+  uint8_t masked = 0;
+  int length = 0;
+
+  if(pArg == NULL || pOps == NULL)
+  {
+    return CLI_RESULT_INVALID;
+  }
+
+  // parse all operations
+  while(pStr != NULL)
+  {
+    char *pNext = strchr(pStr, OP_SEPARATOR);
+
+    if(pNext != NULL)
+    {
+      *pNext++ = '\0';
+    }
+    if(CLI_REG_BATCH_MAX <= num || !ParseOp(pStr, &pOps[num]))
+    {
+      return CLI_RESULT_INVALID;
+    }
+    if(pOps[num].type == 'D')
+    {
+      // each delay is CLI_REG_DELAY_MAX at most, the sum does not wrap
+      delay += pOps[num].addr;
+      if(CLI_REG_DELAY_MAX < delay)
+      {
+        return CLI_RESULT_INVALID;
+      }
+    }
+    ++num;
+    pStr = pNext;
+  }
+
+  // run them back to back
+  for(uint16_t i=0; i<num; i++)
+  {
+    RegOp *pOp = &pOps[i];
+
+    switch(pOp->type)
+    {
+    case 'R':
+      pOp->value = RegRead(pOp->addr);
+      break;
+    case 'W':
+      RegWrite(pOp->addr, pOp->value);
+      break;
+    case 'M':
+      RegWrite(pOp->addr, (RegRead(pOp->addr) & ~pOp->mask) | (pOp->value & pOp->mask));
+      break;
+    case 'D':
+      DelayUs(pOp->addr);
+      break;
+    case 'I':
+      if(!masked)
+      {
+        irqState = MaskIrq();
+        masked = 1;
+      }
+      break;
+    default:  // 'E'
+      if(masked)
+      {
+        UnmaskIrq(irqState);
+        masked = 0;
+      }
+      break;
+    }
+  }
+  if(masked)
+  {
+    UnmaskIrq(irqState);
+  }
+
+  // read values
+  for(uint16_t i=0; i<num && length < CLI_RESPONSE_LENGTH; i++)
+  {
+    if(pOps[i].type == 'R')
+    {
+      length += snprintf((char*)&pRes[length], CLI_RESPONSE_LENGTH - length, "%s%08lX",
+                         (length == 0) ? "" : " ", (unsigned long)pOps[i].value);
+    }
+  }
+  if(length == 0)
+  {
+    snprintf((char*)pRes, CLI_RESPONSE_LENGTH, "OK");
+  }
+
+  return CLI_RESULT_OK;
+}
+
+/**
+  * @brief  CLI_RegRead: read a 32-bit register for other modules (an array on host build)
+  * @param  addr: address of register
+  * @retval Value
+  */
+uint32_t CLI_RegRead(uint32_t addr)
+{
+  return RegRead(addr);
+}
+
+/**
+  * @brief  CLI_RegValid: check an address of 32-bit register against the memory map (CLI_REG_MAP)
+  * @param  addr: address
+  * @retval 1 if it is aligned and mapped, 0 if not
+  */
+uint8_t CLI_RegValid(uint32_t addr)
+{
+  if((addr & 0x3) != 0)
+  {
+    return 0;
+  }
+  for(uint16_t i=0; i<sizeof(RegMap) / sizeof(RegMap[0]); i++)
+  {
+    if(RegMap[i][0] <= addr && addr + 3 <= RegMap[i][1])
+    {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  ParseOp: parse an operation
+  * @param  pStr: pointer of operation string (modified)
+  * @param  pOp: pointer of operation
+  * @retval 1 if valid, 0 if invalid
+  */
+static uint8_t ParseOp(char* pStr, RegOp* pOp)
+{
+  uint32_t values[3];
+
+  while(*pStr == ' ')
+  {
+    ++pStr;
+  }
+  pOp->type = (uint8_t)*pStr++;
+  pOp->mask = 0xFFFFFFFFUL;
+
+  switch(pOp->type)
+  {
+  case 'R':
+    if(!ParseNumbers(pStr, values, 1))
+    {
+      return 0;
+    }
+    pOp->addr = values[0];
+    break;
+  case 'W':
+    if(!ParseNumbers(pStr, values, 2))
+    {
+      return 0;
+    }
+    pOp->addr = values[0];
+    pOp->value = values[1];
+    break;
+  case 'M':
+    if(!ParseNumbers(pStr, values, 3))
+    {
+      return 0;
+    }
+    pOp->addr = values[0];
+    pOp->mask = values[1];
+    pOp->value = values[2];
+    break;
+  case 'D':
+    if(!ParseNumbers(pStr, values, 1) || CLI_REG_DELAY_MAX < values[0])
+    {
+      return 0;
+    }
+    pOp->addr = values[0];
+    return 1;
+  case 'I':
+  case 'E':
+    return ParseNumbers(pStr, values, 0);
+  default:
+    return 0;
+  }
+
+  // registers are accessed in 32 bits, in the memory map
+  return CLI_RegValid(pOp->addr);
+}
+
+/**
+  * @brief  ParseNumbers: parse numbers separated by spaces
+  * @param  pStr: pointer of string
+  * @param  pValues: pointer of values
+  * @param  num: number of values required (no more, no less)
+  * @retval 1 if valid, 0 if invalid
+  */
+static uint8_t ParseNumbers(char* pStr, uint32_t* pValues, uint8_t num)
+{
+  char *pEnd;
+
+  for(uint8_t i=0; i<num; i++)
+  {
+    if(*pStr != ' ')
+    {
+      return 0;
+    }
+    while(*pStr == ' ')
+    {
+      ++pStr;
+    }
+    if(*pStr == '-' || *pStr == '\0')
+    {
+      return 0;
+    }
+    pEnd = ParseNumber(pStr, &pValues[i]);
+    if(pEnd == NULL)
+    {
+      return 0;
+    }
+    pStr = pEnd;
+  }
+
+  while(*pStr == ' ')
+  {
+    ++pStr;
+  }
+  return (*pStr == '\0') ? 1 : 0;
+}
+
+/**
+  * @brief  ParseNumber: parse a decimal number, or a hexadecimal one after "0x"
+  *         (no octal, no sign, no value beyond 32 bits)
+  * @param  pStr: pointer of string
+  * @param  pValue: pointer of value
+  * @retval Pointer of the character after the number, NULL if invalid
+  */
+static char* ParseNumber(char* pStr, uint32_t* pValue)
+{
+  uint32_t base = 10;
+  uint32_t value = 0;
+  char *pDigits;
+
+  if(pStr[0] == '0' && (pStr[1] == 'x' || pStr[1] == 'X'))
+  {
+    base = 16;
+    pStr += 2;
+  }
+
+  for(pDigits = pStr; ; pStr++)
+  {
+    uint32_t digit;
+
+    if('0' <= *pStr && *pStr <= '9')
+    {
+      digit = (uint32_t)(*pStr - '0');
+    }
+    else if(base == 16 && 'a' <= (*pStr | 0x20) && (*pStr | 0x20) <= 'f')
+    {
+      digit = (uint32_t)((*pStr | 0x20) - 'a' + 10);
+    }
+    else
+    {
+      break;
+    }
+    if((0xFFFFFFFFUL - digit) / base < value)
+    {
+      return NULL;
+    }
+    value = value * base + digit;
+  }
+
+  if(pStr == pDigits || (*pStr != ' ' && *pStr != '\0'))
+  {
+    return NULL;
+  }
+  *pValue = value;
+  return pStr;
+}
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+/**
+  * @brief  RegRead: read a register
+  * @param  addr: address
+  * @retval Value
+  */
+static uint32_t RegRead(uint32_t addr)
+{
+  return *(volatile uint32_t*)addr;
+}
+
+/**
+  * @brief  RegWrite: write a register
+  * @param  addr: address
+  * @param  value: value
+  * @retval None
+  */
+static void RegWrite(uint32_t addr, uint32_t value)
+{
+  *(volatile uint32_t*)addr = value;
+}
+
+/**
+  * @brief  DelayUs: busy wait by cycle counter (HAL_Delay can not be used in interrupts)
+  * @param  us: delay [us]
+  * @retval None
+  */
+static void DelayUs(uint32_t us)
+{
+  uint32_t start = CLI_TimeNow32();
+  uint32_t cycles = (uint32_t)CLI_TimeFromUs(us);
+
+  while(CLI_TimeNow32() - start < cycles)
+  {
+  }
+}
+
+/**
+  * @brief  MaskIrq: mask interrupts
+  * @retval State to restore
+  */
+static uint32_t MaskIrq(void)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  return primask;
+}
+
+/**
+  * @brief  UnmaskIrq: restore interrupt mask
+  * @param  state: state returned by MaskIrq
+  * @retval None
+  */
+static void UnmaskIrq(uint32_t state)
+{
+  __set_PRIMASK(state);
+}
+
+#else
+/* Host build (simulation) : registers are an array, no interrupts */
+static uint32_t RegRead(uint32_t addr)
+{
+  return SimRegs[(addr >> 2) % (sizeof(SimRegs) / sizeof(SimRegs[0]))];
+}
+
+static void RegWrite(uint32_t addr, uint32_t value)
+{
+  SimRegs[(addr >> 2) % (sizeof(SimRegs) / sizeof(SimRegs[0]))] = value;
+}
+
+static void DelayUs(uint32_t us)
+{
+  struct timespec ts = { 0, (long)us * 1000L };
+
+  nanosleep(&ts, NULL);
+}
+
+static uint32_t MaskIrq(void)
+{
+  return 0;
+}
+
+static void UnmaskIrq(uint32_t state)
+{
+}
+#endif
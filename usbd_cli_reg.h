@@ -0,0 +1,64 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_reg.h
+  * @author  Katagiri
+  * @brief   Header file for USB command line's register batch.
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CLI_REG_H
+#define __USBD_CLI_REG_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+// max number of operations in a batch
+#ifndef CLI_REG_BATCH_MAX
+#define CLI_REG_BATCH_MAX         32
+#endif
+
+// max delay of a batch in total [us] (the batch runs in the USB interrupt)
+#ifndef CLI_REG_DELAY_MAX
+#define CLI_REG_DELAY_MAX         5000
+#endif
+
+// memory map : X(first address, last address) of ranges accessed by REG_BATCH and CAPTURE,
+// one per peripheral block or contiguous group, reserved gaps left out
+// (STM32F405/407, RM0090 memory map, define the map in build options for other devices)
+#ifndef CLI_REG_MAP
+#define CLI_REG_MAP(X)                                                          \
+  X(0x10000000UL, 0x1000FFFFUL)   /* CCM RAM */                                 \
+  X(0x20000000UL, 0x2001FFFFUL)   /* SRAM1, SRAM2 */                            \
+  X(0x40000000UL, 0x400023FFUL)   /* TIM2-7, TIM12-14 */                        \
+  X(0x40002800UL, 0x400033FFUL)   /* RTC & BKP, WWDG, IWDG */                   \
+  X(0x40003400UL, 0x40005FFFUL)   /* SPI2-3, I2S2-3ext, USART2-5, I2C1-3 */     \
+  X(0x40006400UL, 0x40006BFFUL)   /* CAN1-2 */                                  \
+  X(0x40007000UL, 0x400077FFUL)   /* PWR, DAC */                                \
+  X(0x40010000UL, 0x400107FFUL)   /* TIM1, TIM8 */                              \
+  X(0x40011000UL, 0x400117FFUL)   /* USART1, USART6 */                          \
+  X(0x40012000UL, 0x400123FFUL)   /* ADC1-3 */                                  \
+  X(0x40012C00UL, 0x400133FFUL)   /* SDIO, SPI1 */                              \
+  X(0x40013800UL, 0x40013FFFUL)   /* SYSCFG, EXTI */                            \
+  X(0x40014000UL, 0x40014BFFUL)   /* TIM9-11 */                                 \
+  X(0x40020000UL, 0x400223FFUL)   /* GPIOA-I */                                 \
+  X(0x40023000UL, 0x400233FFUL)   /* CRC */                                     \
+  X(0x40023800UL, 0x40024FFFUL)   /* RCC, Flash interface, BKPSRAM */           \
+  X(0x40026000UL, 0x400267FFUL)   /* DMA1-2 */                                  \
+  X(0x40028000UL, 0x400293FFUL)   /* Ethernet MAC */                            \
+  X(0x40040000UL, 0x4007FFFFUL)   /* USB OTG HS */                              \
+  X(0x50000000UL, 0x5003FFFFUL)   /* USB OTG FS */                              \
+  X(0x50050000UL, 0x500503FFUL)   /* DCMI */                                    \
+  X(0x50060800UL, 0x50060BFFUL)   /* RNG */                                     \
+  X(0xA0000000UL, 0xA0000FFFUL)   /* FSMC registers */                          \
+  X(0xE0000000UL, 0xE0002FFFUL)   /* ITM, DWT, FPB */                           \
+  X(0xE000E000UL, 0xE000EFFFUL)   /* SCS (SysTick, NVIC, SCB) */                \
+  X(0xE0040000UL, 0xE00423FFUL)   /* TPIU, ETM, DBGMCU */
+#endif
+
+/* Exported functions ------------------------------------------------------- */
+int8_t CLI_RegBatch(uint8_t* pArg, uint8_t* pRes);
+uint32_t CLI_RegRead(uint32_t addr);
+uint8_t CLI_RegValid(uint32_t addr);
+
+#endif /* __USBD_CLI_REG_H */
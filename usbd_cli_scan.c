@@ -0,0 +1,168 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_scan.c
+  * @author  Katagiri
+  * @brief   Source file for USB command line's input scanner.
+  *          Printable characters are checked and copied a 32-bit word at a
+  *          time. A word with any control character (CR, LF, Tab ...) or
+  *          non-ASCII byte is left to the caller byte by byte.
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "usbd_cli.h"
+#include "usbd_cli_scan.h"
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+#include "stm32f4xx.h"
+#endif
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+#define ONES                      0x01010101UL
+#define HIGHS                     0x80808080UL
+
+/* Private macro -------------------------------------------------------------*/
+#define IS_PRINTABLE(__CHAR__)    (' ' <= (__CHAR__) && (__CHAR__) <= '~')
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t IsWordPrintable(uint32_t word);
+static uint16_t ScanCopyBytes(const uint8_t* pSrc, uint8_t* pDst, uint16_t length);
+static void FillBenchLine(uint8_t* pLine);
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t BenchLine[CLI_SCAN_BENCH_LENGTH + 2];   // line of BENCH kernels (+1 for offset)
+static uint8_t BenchOut[CLI_SCAN_BENCH_LENGTH + 1];
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  CLI_ScanCopy: copy printable characters (' ' to '~') up to the first other one
+  * @param  pSrc: pointer of input (need not be aligned)
+  * @param  pDst: pointer of destination (need not be aligned)
+  * @param  length: max length to copy
+  * @retval Length copied, pSrc[length copied] is the first non printable character
+  */
+uint16_t CLI_ScanCopy(const uint8_t* pSrc, uint8_t* pDst, uint16_t length)
+{
+  uint16_t i = 0;
+  uint32_t word;
+
+  // memcpy of 4 bytes compiles to a single unaligned LDR/STR on Cortex-M4
+  while( i + 4 <= length )
+  {
+    memcpy(&word, &pSrc[i], 4);
+    if( !IsWordPrintable(word) )
+    {
+      break;
+    }
+    memcpy(&pDst[i], &word, 4);
+    i += 4;
+  }
+
+  while( i < length && IS_PRINTABLE(pSrc[i]) )
+  {
+    pDst[i] = pSrc[i];
+    ++i;
+  }
+  return i;
+}
+
+/**
+  * @brief  CLI_ScanBenchWord: BENCH kernel "scan", a line by CLI_ScanCopy
+  * @param  iteration: number of iteration (odd : line not aligned)
+  * @retval Length copied
+  */
+uint32_t CLI_ScanBenchWord(uint32_t iteration)
+{
+  if( iteration == 0 )
+  {
+    BenchLine[0] = ' ';
+    FillBenchLine(&BenchLine[1]);
+  }
+  return CLI_ScanCopy(&BenchLine[iteration & 1], BenchOut, CLI_SCAN_BENCH_LENGTH);
+}
+
+/**
+  * @brief  CLI_ScanBenchByte: BENCH kernel "scan_byte", a line one byte at a time
+  * @param  iteration: number of iteration (odd : line not aligned)
+  * @retval Length copied
+  */
+uint32_t CLI_ScanBenchByte(uint32_t iteration)
+{
+  if( iteration == 0 )
+  {
+    BenchLine[0] = ' ';
+    FillBenchLine(&BenchLine[1]);
+  }
+  return ScanCopyBytes(&BenchLine[iteration & 1], BenchOut, CLI_SCAN_BENCH_LENGTH);
+}
+
+/* Private functions ---------------------------------------------------------*/
+#if defined(__ARM_FEATURE_SIMD32)
+/**
+  * @brief  IsWordPrintable: check 4 characters at once (Cortex-M4 SIMD)
+  *         USUB8 sets GE flag of each byte without borrow, SEL collects them.
+  * @param  word: 4 characters
+  * @retval Non zero if all are printable
+  */
+static uint32_t IsWordPrintable(uint32_t word)
+{
+  uint32_t lower;
+  uint32_t upper;
+
+  __USUB8(word, 0x20202020UL);      // GE : byte >= ' '
+  lower = __SEL(0xFFFFFFFFUL, 0);
+  __USUB8(0x7E7E7E7EUL, word);      // GE : byte <= '~'
+  upper = __SEL(0xFFFFFFFFUL, 0);
+
+  return (lower & upper) == 0xFFFFFFFFUL;
+}
+
+#else
+/**
+  * @brief  IsWordPrintable: check 4 characters at once (SWAR)
+  *         - a byte < 0x20 borrows into its bit 7 : (w - 0x20..) & ~w & 0x80..
+  *         - a byte > 0x7E has bit 7 set after adding 1 : (w + 0x01..) | w) & 0x80..
+  * @param  word: 4 characters
+  * @retval Non zero if all are printable
+  */
+static uint32_t IsWordPrintable(uint32_t word)
+{
+  uint32_t below = (word - ONES * ' ') & ~word & HIGHS;
+  uint32_t above = ((word + ONES) | word) & HIGHS;
+
+  return (below | above) == 0;
+}
+#endif
+
+/**
+  * @brief  ScanCopyBytes: reference of CLI_ScanCopy, one byte at a time
+  * @param  pSrc: pointer of input
+  * @param  pDst: pointer of destination
+  * @param  length: max length to copy
+  * @retval Length copied
+  */
+static uint16_t ScanCopyBytes(const uint8_t* pSrc, uint8_t* pDst, uint16_t length)
+{
+  uint16_t i = 0;
+
+  while( i < length && IS_PRINTABLE(pSrc[i]) )
+  {
+    pDst[i] = pSrc[i];
+    ++i;
+  }
+  return i;
+}
+
+/**
+  * @brief  FillBenchLine: make a printable line ending with CR
+  * @param  pLine: pointer of line (CLI_SCAN_BENCH_LENGTH + 1 bytes)
+  * @retval None
+  */
+static void FillBenchLine(uint8_t* pLine)
+{
+  for(uint16_t i=0; i<CLI_SCAN_BENCH_LENGTH; i++)
+  {
+    pLine[i] = (uint8_t)(' ' + i % ('~' - ' ' + 1));
+  }
+  pLine[CLI_SCAN_BENCH_LENGTH] = '\r';
+}
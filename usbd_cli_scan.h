@@ -0,0 +1,25 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_scan.h
+  * @author  Katagiri
+  * @brief   Header file for USB command line's input scanner.
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CLI_SCAN_H
+#define __USBD_CLI_SCAN_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "usbd_cli.h"
+
+/* Exported constants --------------------------------------------------------*/
+// length of the line of BENCH kernels "scan" and "scan_byte"
+#define CLI_SCAN_BENCH_LENGTH     (CLI_COMMAND_LENGTH - 8)
+
+/* Exported functions ------------------------------------------------------- */
+uint16_t CLI_ScanCopy(const uint8_t* pSrc, uint8_t* pDst, uint16_t length);
+uint32_t CLI_ScanBenchWord(uint32_t iteration);
+uint32_t CLI_ScanBenchByte(uint32_t iteration);
+
+#endif /* __USBD_CLI_SCAN_H */
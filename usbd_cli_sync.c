@@ -0,0 +1,58 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_sync.c
+  * @author  Katagiri
+  * @brief   Source file for USB command line's time synchronization.
+  *          SOF starts each USB frame on the same time for USB Host and all
+  *          devices, so the local time of a numbered SOF ties the local clock
+  *          to the frame clock of USB Host. The SOF interrupt keeps the latest
+  *          pair, TSYNC reports it, and host/cli_sync.c fits offset and drift.
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_cli_sync.h"
+#include "usbd_cli_time.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+/* Private function prototypes -----------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static volatile uint32_t SampleSeq;     // odd while the sample is being written
+static volatile SyncSample Sample;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  CLI_SyncSof: SOF received (USB interrupt)
+  * @param  frame: frame number of SOF
+  * @retval None
+  */
+void CLI_SyncSof(uint32_t frame)
+{
+  uint64_t now = CLI_TimeNow();
+
+  ++SampleSeq;
+  Sample.frame = frame;
+  Sample.time = now;
+  ++SampleSeq;
+}
+
+/**
+  * @brief  CLI_SyncGet: get the latest SOF sample, from any context
+  * @param  pSample: pointer of sample
+  * @retval 1 if got, 0 if no SOF received yet
+  */
+uint8_t CLI_SyncGet(SyncSample* pSample)
+{
+  uint32_t seq;
+
+  // read again if SOF interrupt wrote it in between
+  do
+  {
+    seq = SampleSeq;
+    pSample->frame = Sample.frame;
+    pSample->time = Sample.time;
+  } while( (seq & 1) != 0 || seq != SampleSeq );
+
+  return (seq != 0) ? 1 : 0;
+}
@@ -0,0 +1,33 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_sync.h
+  * @author  Katagiri
+  * @brief   Header file for USB command line's time synchronization.
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CLI_SYNC_H
+#define __USBD_CLI_SYNC_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+// frame number : 11 bits, one each 1 ms
+// (high speed SOF of each 125 us microframe : only microframe 0 is given, as its frame)
+#define CLI_SYNC_FRAME_MASK       0x7FF
+#define CLI_SYNC_FRAME_NS         1000000UL
+
+/* Exported types ------------------------------------------------------------*/
+// local time of the latest SOF
+typedef struct
+{
+  uint32_t frame;           // frame number (CLI_SYNC_FRAME_MASK)
+  uint64_t time;            // time SOF interrupt was taken [count] (usbd_cli_time.h)
+} SyncSample;
+
+/* Exported functions ------------------------------------------------------- */
+void CLI_SyncSof(uint32_t frame);
+uint8_t CLI_SyncGet(SyncSample* pSample);
+
+#endif /* __USBD_CLI_SYNC_H */
@@ -0,0 +1,354 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_telem.c
+  * @author  Katagiri
+  * @brief   Source file for USB command line's telemetry aggregation.
+  *          Each stream declared in CLI_TELEM_STREAM_MAP has a stage between
+  *          its samples and CLI_MUX_TELEMETRY, configured at run time (TELEM):
+  *            RAW   : every sample
+  *            STATS : min, max, mean and RMS of each window of samples
+  *            FIR   : FIR low-pass filter decimated by a factor, the filter
+  *                    is computed only for the samples sent
+  *          so the bandwidth follows the records needed, not the sample rate.
+  *          A stream is sampled in one context (any interrupt), and records
+  *          go through a ring of the stream to CLI_TelemFlush(), which queues
+  *          them on the channel from the CDC timer, its only writer.
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "usbd_cli.h"
+#include "usbd_cli_telem.h"
+#include "usbd_cli_mux.h"
+
+/* Private typedef -----------------------------------------------------------*/
+// state of stream
+typedef struct
+{
+  TelemConfig config;                 // configuration
+  volatile uint8_t active;            // type in effect (CLI_TELEM_OFF while configured)
+  uint16_t count;                     // samples in window, or since the last FIR output
+  int32_t min;                        // min of window
+  int32_t max;                        // max of window
+  int64_t sum;                        // sum of window
+  uint64_t squares;                   // sum of squares of window
+  int32_t history[CLI_TELEM_MAX_TAPS];  // samples of FIR filter
+  uint8_t pos;                        // index of history for the next sample
+  uint16_t seq;                       // number of the next record
+  volatile TelemRecord ring[CLI_TELEM_RING_RECORDS];  // records not queued yet
+  volatile uint16_t head;             // records put (sample context)
+  volatile uint16_t tail;             // records taken (CLI_TelemFlush)
+  TelemStats stats;                   // statistics
+} TelemState;
+
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+/* Private function prototypes -----------------------------------------------*/
+static void PutRecord(TelemState* pState, TelemStream stream, const int32_t* pValue);
+static int32_t FilterOutput(const TelemState* pState);
+static uint32_t Sqrt64(uint64_t value);
+
+/* Private variables ---------------------------------------------------------*/
+static const char* const StreamNames[CLI_NUM_OF_TELEM_STREAMS] =
+{
+#define CLI_TELEM_NAME(__ID__, __NAME__)    __NAME__,
+  CLI_TELEM_STREAM_MAP(CLI_TELEM_NAME)
+  CLI_TELEM_STREAM_MAP_USER(CLI_TELEM_NAME)
+#undef CLI_TELEM_NAME
+};
+
+static TelemState States[CLI_NUM_OF_TELEM_STREAMS];
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  CLI_TelemSample: take a sample of a stream
+  *         The sum of squares of a window is exact while |value| < 2^24.
+  * @param  stream: stream id
+  * @param  value: sample
+  * @retval None
+  */
+void CLI_TelemSample(TelemStream stream, int32_t value)
+{
+  TelemState *pState;
+  int32_t values[4];
+
+  if( CLI_NUM_OF_TELEM_STREAMS <= stream )
+  {
+    return;
+  }
+  pState = &States[stream];
+
+  switch( pState->active )
+  {
+  case CLI_TELEM_RAW:
+    ++pState->stats.samples;
+    values[0] = value;
+    PutRecord(pState, stream, values);
+    break;
+
+  case CLI_TELEM_STATS:
+    ++pState->stats.samples;
+    if( pState->count == 0 )
+    {
+      pState->min = value;
+      pState->max = value;
+      pState->sum = 0;
+      pState->squares = 0;
+    }
+    pState->min = (value < pState->min) ? value : pState->min;
+    pState->max = (pState->max < value) ? value : pState->max;
+    pState->sum += value;
+    pState->squares += (uint64_t)((int64_t)value * value);
+    if( ++pState->count == pState->config.length )
+    {
+      values[0] = pState->min;
+      values[1] = pState->max;
+      values[2] = (int32_t)(pState->sum / pState->count);
+      values[3] = (int32_t)Sqrt64(pState->squares / pState->count);
+      pState->count = 0;
+      PutRecord(pState, stream, values);
+    }
+    break;
+
+  case CLI_TELEM_FIR:
+    ++pState->stats.samples;
+    pState->history[pState->pos] = value;
+    pState->pos = (uint8_t)((pState->pos + 1) % pState->config.numTaps);
+    if( ++pState->count == pState->config.length )
+    {
+      values[0] = FilterOutput(pState);
+      pState->count = 0;
+      PutRecord(pState, stream, values);
+    }
+    break;
+
+  default:
+    break;
+  }
+}
+
+/**
+  * @brief  CLI_TelemFlush: queue records on CLI_MUX_TELEMETRY (CDC timer).
+  *         Records wait in the rings while the channel is full, and are
+  *         dropped while the port is not in multiplexed mode.
+  * @retval None
+  */
+void CLI_TelemFlush(void)
+{
+  for(uint16_t i=0; i<CLI_NUM_OF_TELEM_STREAMS; i++)
+  {
+    TelemState *pState = &States[i];
+
+    while( pState->tail != pState->head )
+    {
+      volatile TelemRecord *pSlot = &pState->ring[pState->tail % CLI_TELEM_RING_RECORDS];
+      TelemRecord record;
+
+      record.stream = pSlot->stream;
+      record.type = pSlot->type;
+      record.seq = pSlot->seq;
+      for(uint8_t k=0; k<4; k++)
+      {
+        record.value[k] = pSlot->value[k];
+      }
+
+      if( !CLI_MuxIsActive() )
+      {
+        ++pState->stats.dropped;
+      }
+      else if( CLI_MuxWrite(CLI_MUX_TELEMETRY, (const uint8_t*)&record, CLI_TELEM_RECORD_LENGTH(record.type)) != 0 )
+      {
+        ++pState->stats.records;
+      }
+      else
+      {
+        // channel full, next time
+        break;
+      }
+      ++pState->tail;
+    }
+  }
+}
+
+/**
+  * @brief  CLI_TelemConfigure: change the stage of a stream
+  *         The stream is stopped while it is changed, windows and filter restart
+  *         (a sample preempting the change may go into the new stage).
+  *         FIR without taps is a moving average of the factor (up to CLI_TELEM_MAX_TAPS).
+  * @param  stream: stream id
+  * @param  pConfig: pointer of configuration
+  * @retval Result
+  */
+int8_t CLI_TelemConfigure(TelemStream stream, const TelemConfig* pConfig)
+{
+  TelemState *pState;
+
+  if( CLI_NUM_OF_TELEM_STREAMS <= stream || CLI_TELEM_FIR < pConfig->type
+      || (pConfig->type == CLI_TELEM_STATS && pConfig->length == 0)
+      || (pConfig->type == CLI_TELEM_FIR && (pConfig->length == 0 || CLI_TELEM_MAX_FACTOR < pConfig->length
+                                             || CLI_TELEM_MAX_TAPS < pConfig->numTaps)) )
+  {
+    return CLI_RESULT_INVALID;
+  }
+  pState = &States[stream];
+
+  pState->active = CLI_TELEM_OFF;
+  pState->config = *pConfig;
+  if( pConfig->type == CLI_TELEM_FIR && pConfig->numTaps == 0 )
+  {
+    uint8_t num = (CLI_TELEM_MAX_TAPS < pConfig->length) ? CLI_TELEM_MAX_TAPS : (uint8_t)pConfig->length;
+    int32_t tap = (32768 + num / 2) / num;
+
+    pState->config.numTaps = num;
+    for(uint8_t k=0; k<num; k++)
+    {
+      pState->config.taps[k] = (int16_t)((32767 < tap) ? 32767 : tap);
+    }
+  }
+  pState->count = 0;
+  pState->pos = 0;
+  memset(pState->history, 0, sizeof(pState->history));
+  pState->active = pConfig->type;
+
+  return CLI_RESULT_OK;
+}
+
+/**
+  * @brief  CLI_TelemGetConfig: get the stage of a stream
+  * @param  stream: stream id (valid)
+  * @param  pConfig: pointer of configuration
+  * @retval None
+  */
+void CLI_TelemGetConfig(TelemStream stream, TelemConfig* pConfig)
+{
+  *pConfig = States[stream].config;
+}
+
+/**
+  * @brief  CLI_TelemGetStats: get statistics of a stream
+  * @param  stream: stream id (valid)
+  * @param  pStats: pointer of statistics
+  * @retval None
+  */
+void CLI_TelemGetStats(TelemStream stream, TelemStats* pStats)
+{
+  *pStats = States[stream].stats;
+}
+
+/**
+  * @brief  CLI_TelemStreamName: name of stream
+  * @param  stream: stream id
+  * @retval Pointer of name, NULL if no such stream
+  */
+const char* CLI_TelemStreamName(uint16_t stream)
+{
+  return ( stream < CLI_NUM_OF_TELEM_STREAMS ) ? StreamNames[stream] : NULL;
+}
+
+/**
+  * @brief  CLI_TelemFindStream: search a stream by name
+  * @param  pName: name
+  * @retval Stream id, -1 if not found
+  */
+int16_t CLI_TelemFindStream(const char* pName)
+{
+  for(uint16_t i=0; i<CLI_NUM_OF_TELEM_STREAMS; i++)
+  {
+    if( strcmp(StreamNames[i], pName) == 0 )
+    {
+      return (int16_t)i;
+    }
+  }
+  return -1;
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  PutRecord: put a record in the ring of the stream
+  * @param  pState: pointer of state
+  * @param  stream: stream id
+  * @param  pValue: values (as many as the type has)
+  * @retval None
+  */
+static void PutRecord(TelemState* pState, TelemStream stream, const int32_t* pValue)
+{
+  volatile TelemRecord *pSlot;
+  uint8_t type = pState->config.type;
+
+  if( CLI_TELEM_RING_RECORDS <= (uint16_t)(pState->head - pState->tail) )
+  {
+    ++pState->stats.dropped;
+    ++pState->seq;
+    return;
+  }
+
+  pSlot = &pState->ring[pState->head % CLI_TELEM_RING_RECORDS];
+  pSlot->stream = (uint8_t)stream;
+  pSlot->type = type;
+  pSlot->seq = pState->seq++;
+  for(uint8_t k=0; k<((type == CLI_TELEM_STATS) ? 4 : 1); k++)
+  {
+    pSlot->value[k] = pValue[k];
+  }
+  ++pState->head;
+}
+
+/**
+  * @brief  FilterOutput: output of FIR filter for the latest sample
+  * @param  pState: pointer of state
+  * @retval Output (saturated)
+  */
+static int32_t FilterOutput(const TelemState* pState)
+{
+  uint8_t num = pState->config.numTaps;
+  uint8_t idx = pState->pos;
+  int64_t acc = 0;
+
+  // taps[0] for the latest sample, history is read backward from it
+  for(uint8_t k=0; k<num; k++)
+  {
+    idx = (idx == 0) ? num - 1 : idx - 1;
+    acc += (int64_t)pState->config.taps[k] * pState->history[idx];
+  }
+  acc >>= 15;
+
+  if( INT32_MAX < acc )
+  {
+    return INT32_MAX;
+  }
+  if( acc < INT32_MIN )
+  {
+    return INT32_MIN;
+  }
+  return (int32_t)acc;
+}
+
+/**
+  * @brief  Sqrt64: integer square root
+  * @param  value: value
+  * @retval floor(sqrt(value))
+  */
+static uint32_t Sqrt64(uint64_t value)
+{
+  uint64_t root = 0;
+  uint64_t bit = 1ULL << 62;
+
+  while( value < bit )
+  {
+    bit >>= 2;
+  }
+  while( bit != 0 )
+  {
+    if( root + bit <= value )
+    {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else
+    {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint32_t)root;
+}
@@ -0,0 +1,105 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_telem.h
+  * @author  Katagiri
+  * @brief   Header file for USB command line's telemetry aggregation.
+  *          This header is shared with the host (record format).
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CLI_TELEM_H
+#define __USBD_CLI_TELEM_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+/*
+  Record format on CLI_MUX_TELEMETRY (little endian)
+    [stream] [type] [seq (uint16_t)] [values (int32_t) ...]
+
+  - CLI_TELEM_RAW   : 1 value, the sample
+  - CLI_TELEM_STATS : 4 values, min, max, mean and RMS of a window
+  - CLI_TELEM_FIR   : 1 value, output of FIR filter decimated by the factor
+  seq counts records of the stream, a gap means records were dropped.
+*/
+#define CLI_TELEM_OFF             0
+#define CLI_TELEM_RAW             1
+#define CLI_TELEM_STATS           2
+#define CLI_TELEM_FIR             3
+
+#define CLI_TELEM_HEADER_LENGTH   4
+#define CLI_TELEM_RECORD_LENGTH(__TYPE__)   \
+  (CLI_TELEM_HEADER_LENGTH + (((__TYPE__) == CLI_TELEM_STATS) ? 16 : 4))
+
+// max number of FIR taps (coefficients in Q15)
+#ifndef CLI_TELEM_MAX_TAPS
+#define CLI_TELEM_MAX_TAPS        32
+#endif
+
+// max decimation factor of FIR stage
+#define CLI_TELEM_MAX_FACTOR      256
+
+// records kept per stream until they are queued on the channel
+#ifndef CLI_TELEM_RING_RECORDS
+#define CLI_TELEM_RING_RECORDS    8
+#endif
+
+// stream map : X(stream id, name)
+#ifndef CLI_TELEM_STREAM_MAP
+#define CLI_TELEM_STREAM_MAP(X)                                                 \
+  X(CLI_TELEM_CMD_TIME,   "cmd.time")   /* time of each command [count] */
+#endif
+
+// streams of application modules, declared the same way (e.g. in build options)
+#ifndef CLI_TELEM_STREAM_MAP_USER
+#define CLI_TELEM_STREAM_MAP_USER(X)
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+// stream id
+typedef enum
+{
+#define CLI_TELEM_ENUM(__ID__, __NAME__)    __ID__,
+  CLI_TELEM_STREAM_MAP(CLI_TELEM_ENUM)
+  CLI_TELEM_STREAM_MAP_USER(CLI_TELEM_ENUM)
+#undef CLI_TELEM_ENUM
+  CLI_NUM_OF_TELEM_STREAMS
+} TelemStream;
+
+// record (the first CLI_TELEM_RECORD_LENGTH(type) bytes are sent)
+typedef struct
+{
+  uint8_t stream;           // TelemStream
+  uint8_t type;             // CLI_TELEM_RAW, CLI_TELEM_STATS or CLI_TELEM_FIR
+  uint16_t seq;             // number of record in the stream
+  int32_t value[4];         // values
+} TelemRecord;
+
+// configuration of aggregation stage
+typedef struct
+{
+  uint8_t type;             // CLI_TELEM_xxx
+  uint16_t length;          // samples per window (STATS) or decimation factor (FIR)
+  uint8_t numTaps;          // number of FIR taps
+  int16_t taps[CLI_TELEM_MAX_TAPS];   // FIR coefficients in Q15, taps[0] for the latest sample
+} TelemConfig;
+
+// statistics of stream
+typedef struct
+{
+  uint32_t samples;         // samples taken
+  uint32_t records;         // records queued on the channel
+  uint32_t dropped;         // records lost (ring full)
+} TelemStats;
+
+/* Exported functions ------------------------------------------------------- */
+void CLI_TelemSample(TelemStream stream, int32_t value);
+void CLI_TelemFlush(void);
+int8_t CLI_TelemConfigure(TelemStream stream, const TelemConfig* pConfig);
+void CLI_TelemGetConfig(TelemStream stream, TelemConfig* pConfig);
+void CLI_TelemGetStats(TelemStream stream, TelemStats* pStats);
+const char* CLI_TelemStreamName(uint16_t stream);
+int16_t CLI_TelemFindStream(const char* pName);
+
+#endif /* __USBD_CLI_TELEM_H */
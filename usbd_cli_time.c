@@ -0,0 +1,189 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_time.c
+  * @author  Katagiri
+  * @brief   Source file for USB command line's timestamp service.
+  *          The 32-bit DWT cycle counter is extended to 64 bits by counting
+  *          its half periods: bit 0 of the count is the expected bit 31 of
+  *          the cycle counter, and whoever reads a different bit advances the
+  *          count with LDREX/STREX. A read is two loads in the usual case,
+  *          from any context, without masking interrupts.
+  *          The counter has to be read at least once per half period
+  *          (12.7 s at 168 MHz), CLI_TimeUpdate() is called by SysTick.
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_cli_time.h"
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+#include "stm32f4xx.h"
+#else
+#include <time.h>
+#endif
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+/* Private function prototypes -----------------------------------------------*/
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+static uint32_t AdvanceHalf(uint32_t half);
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+static volatile uint32_t HalfPeriods;   // half periods of cycle counter passed
+static uint32_t Freq;                   // counts per second
+#endif
+
+/* Exported functions --------------------------------------------------------*/
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+/**
+  * @brief  CLI_TimeInit: start cycle counter (after the system clock is configured)
+  * @retval None
+  */
+void CLI_TimeInit(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  Freq = SystemCoreClock;
+}
+
+/**
+  * @brief  CLI_TimeNow: current time
+  * @retval Time [count]
+  */
+uint64_t CLI_TimeNow(void)
+{
+  uint32_t half = HalfPeriods;
+  uint32_t low = DWT->CYCCNT;
+
+  if( (low >> 31) != (half & 1) )
+  {
+    half = AdvanceHalf(half);
+  }
+  return ((uint64_t)(half >> 1) << 32) | low;
+}
+
+/**
+  * @brief  CLI_TimeNow32: lower 32 bits of current time, for short intervals
+  * @retval Time [count]
+  */
+uint32_t CLI_TimeNow32(void)
+{
+  return DWT->CYCCNT;
+}
+
+/**
+  * @brief  CLI_TimeFreq: frequency of time count
+  * @retval Counts per second
+  */
+uint32_t CLI_TimeFreq(void)
+{
+  return (Freq != 0) ? Freq : SystemCoreClock;
+}
+
+#else
+/* Host build (simulation) : host monotonic clock, a count is 1 ns */
+void CLI_TimeInit(void)
+{
+}
+
+uint64_t CLI_TimeNow(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+uint32_t CLI_TimeNow32(void)
+{
+  return (uint32_t)CLI_TimeNow();
+}
+
+uint32_t CLI_TimeFreq(void)
+{
+  return 1000000000UL;
+}
+#endif
+
+/**
+  * @brief  CLI_TimeUpdate: keep track of cycle counter (at least once per half period)
+  * @retval None
+  */
+void CLI_TimeUpdate(void)
+{
+  (void)CLI_TimeNow();
+}
+
+/**
+  * @brief  CLI_TimeToNs: convert time
+  * @param  count: time [count]
+  * @retval Time [ns]
+  */
+uint64_t CLI_TimeToNs(uint64_t count)
+{
+  uint32_t freq = CLI_TimeFreq();
+
+  // split not to overflow : count * 1e9 exceeds 64 bits in about 2 minutes
+  return (count / freq) * 1000000000ULL + (count % freq) * 1000000000ULL / freq;
+}
+
+/**
+  * @brief  CLI_TimeToUs: convert time
+  * @param  count: time [count]
+  * @retval Time [us]
+  */
+uint64_t CLI_TimeToUs(uint64_t count)
+{
+  uint32_t freq = CLI_TimeFreq();
+
+  return (count / freq) * 1000000ULL + (count % freq) * 1000000ULL / freq;
+}
+
+/**
+  * @brief  CLI_TimeToMs: convert time
+  * @param  count: time [count]
+  * @retval Time [ms] (wraps in 49 days)
+  */
+uint32_t CLI_TimeToMs(uint64_t count)
+{
+  uint32_t freq = CLI_TimeFreq();
+
+  return (uint32_t)((count / freq) * 1000ULL + (count % freq) * 1000ULL / freq);
+}
+
+/**
+  * @brief  CLI_TimeFromUs: convert time
+  * @param  us: time [us]
+  * @retval Time [count]
+  */
+uint64_t CLI_TimeFromUs(uint32_t us)
+{
+  return (uint64_t)us * CLI_TimeFreq() / 1000000ULL;
+}
+
+/* Private functions ---------------------------------------------------------*/
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+/**
+  * @brief  AdvanceHalf: count a half period, once for all readers seeing it
+  * @param  half: half periods read before the cycle counter
+  * @retval Half periods matching the cycle counter read
+  */
+static uint32_t AdvanceHalf(uint32_t half)
+{
+  uint32_t current;
+
+  do
+  {
+    current = __LDREXW(&HalfPeriods);
+    if( current != half )
+    {
+      // advanced by an interrupt in between
+      __CLREX();
+      return current;
+    }
+  } while( __STREXW(half + 1, &HalfPeriods) != 0 );
+
+  return half + 1;
+}
+#endif
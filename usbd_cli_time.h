@@ -0,0 +1,28 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_time.h
+  * @author  Katagiri
+  * @brief   Header file for USB command line's timestamp service.
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CLI_TIME_H
+#define __USBD_CLI_TIME_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported types ------------------------------------------------------------*/
+/* Exported functions ------------------------------------------------------- */
+void CLI_TimeInit(void);
+uint64_t CLI_TimeNow(void);
+uint32_t CLI_TimeNow32(void);
+void CLI_TimeUpdate(void);
+uint32_t CLI_TimeFreq(void);
+uint64_t CLI_TimeToNs(uint64_t count);
+uint64_t CLI_TimeToUs(uint64_t count);
+uint32_t CLI_TimeToMs(uint64_t count);
+uint64_t CLI_TimeFromUs(uint32_t us);
+
+#endif /* __USBD_CLI_TIME_H */
@@ -0,0 +1,293 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_tx.c
+  * @author  Katagiri
+  * @brief   Source file for USB command line's TX scheduler.
+  *          Packets are built one at a time at each packet boundary (transfer
+  *          complete, polling timer or received packet). Command line output
+  *          always goes first, and streams of multiplexed channels fill the
+  *          rest of the packet and the following packets. So a reply waits
+  *          at most for the packet already on the endpoint.
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "usbd_cli.h"
+#include "usbd_cli_tx.h"
+#include "usbd_cli_mux.h"
+#include "usbd_cli_counter.h"
+#include "usbd_cli_time.h"
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+#include "stm32f4xx_hal.h"
+#endif
+
+/* Private typedef -----------------------------------------------------------*/
+// source of packet data : fills the buffer and returns the length
+typedef uint16_t (*TxSourceFxn)(uint8_t* pBuf, uint16_t size);
+
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+#define MIN(__A__, __B__)                 (((__A__) < (__B__)) ? (__A__) : (__B__))
+
+/* Private function prototypes -----------------------------------------------*/
+static uint16_t TextOutput(uint8_t* pBuf, uint16_t size);
+static uint8_t ClaimTx(void);
+static void ReleaseTx(void);
+
+/* Private variables ---------------------------------------------------------*/
+static TxTransmitFxn Transmit;          // starts transmission on the endpoint
+static volatile uint32_t TxClaimed;     // 1 : a packet is being built or sent
+static uint8_t* pInFlight;              // packet on the endpoint (TX block)
+static uint8_t LastFull;                // 1 : the last packet was full, short packet needed
+static uint8_t* pText;                  // CLI output being sent in text mode
+static uint16_t TextLeft;               // length left of pText
+static uint8_t TextMode;                // 1 : pText belongs to text mode
+static volatile uint32_t RequestTime;   // time a packet was received (CLI_TimeNow32)
+static volatile uint8_t RequestPending; // 1 : no reply sent since RequestTime
+static TxStats Stats;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  CLI_TxInit: start the scheduler (CDC interface initialized)
+  * @param  transmit: function starting transmission of a packet
+  * @retval None
+  */
+void CLI_TxInit(TxTransmitFxn transmit)
+{
+  CLI_TxStop();
+  Transmit = transmit;
+}
+
+/**
+  * @brief  CLI_TxStop: stop the scheduler (CDC interface de-initialized).
+  *         The packet on the endpoint is dropped.
+  * @retval None
+  */
+void CLI_TxStop(void)
+{
+  Transmit = NULL;
+  if( pInFlight != NULL )
+  {
+    CLI_PoolFree(CLI_POOL_TX, pInFlight);
+    pInFlight = NULL;
+  }
+  LastFull = 0;
+  TextLeft = 0;
+  RequestPending = 0;
+  ReleaseTx();
+}
+
+/**
+  * @brief  CLI_TxKick: build and send the next packet if the endpoint is free
+  * @retval None
+  */
+void CLI_TxKick(void)
+{
+  TxSourceFxn control = TextOutput;
+  uint8_t *pPacket;
+  uint16_t length;
+
+  if( Transmit == NULL )
+  {
+    return;
+  }
+  if( !ClaimTx() )
+  {
+    // sent at the next packet boundary
+    CLI_COUNTER_INC(CLI_CNT_TX_DEFERRED);
+    return;
+  }
+
+  pPacket = (uint8_t*)CLI_PoolAlloc(CLI_POOL_TX);
+  if( pPacket == NULL )
+  {
+    ++Stats.errors;
+    ReleaseTx();
+    return;
+  }
+
+  if( CLI_MuxIsActive() )
+  {
+    control = CLI_MuxOutputControl;
+  }
+  if( TextMode != (control == TextOutput) )
+  {
+    // mode changed, output of the other mode is not sent any more
+    TextMode = (control == TextOutput);
+    TextLeft = 0;
+  }
+
+  // command line output first, at every packet boundary
+  length = control(pPacket, CLI_TX_PACKET_SIZE);
+  if( 0 < length && RequestPending )
+  {
+    Stats.latencyLast = (uint32_t)CLI_TimeToUs(CLI_TimeNow32() - RequestTime);
+    if( Stats.latencyMax < Stats.latencyLast )
+    {
+      Stats.latencyMax = Stats.latencyLast;
+    }
+    ++Stats.replies;
+    RequestPending = 0;
+  }
+  Stats.controlBytes += length;
+
+  // streams fill the rest
+  if( !TextMode && length < CLI_TX_PACKET_SIZE )
+  {
+    uint16_t n = CLI_MuxOutputStream(&pPacket[length], CLI_TX_PACKET_SIZE - length);
+    Stats.streamBytes += n;
+    length += n;
+  }
+
+  if( length == 0 && !LastFull )
+  {
+    // nothing to send
+    CLI_PoolFree(CLI_POOL_TX, pPacket);
+    ReleaseTx();
+    return;
+  }
+
+  // a full packet is followed by a short one (zero length if nothing), or USB Host keeps waiting
+  LastFull = (length == CLI_TX_PACKET_SIZE);
+  pInFlight = pPacket;
+  if( Transmit(pPacket, length) != 0 )
+  {
+    ++Stats.errors;
+    pInFlight = NULL;
+    CLI_PoolFree(CLI_POOL_TX, pPacket);
+    ReleaseTx();
+    return;
+  }
+  ++Stats.packets;
+  if( length == 0 )
+  {
+    ++Stats.zlps;
+  }
+}
+
+/**
+  * @brief  CLI_TxRequest: a packet was received from USB Host.
+  *         The time until the next command line output is the reply latency.
+  * @retval None
+  */
+void CLI_TxRequest(void)
+{
+  if( !RequestPending )
+  {
+    RequestTime = CLI_TimeNow32();
+    RequestPending = 1;
+  }
+  CLI_TxKick();
+}
+
+/**
+  * @brief  CLI_TxComplete: the packet on the endpoint has been sent (IN transfer complete)
+  * @retval None
+  */
+void CLI_TxComplete(void)
+{
+  if( pInFlight == NULL )
+  {
+    return;
+  }
+  CLI_PoolFree(CLI_POOL_TX, pInFlight);
+  pInFlight = NULL;
+  ReleaseTx();
+
+  // next packet boundary
+  CLI_TxKick();
+}
+
+/**
+  * @brief  CLI_TxGetStats: get statistics of scheduler
+  * @param  pStats: pointer of statistics
+  * @param  clear: 1 to clear statistics after reading
+  * @retval None
+  */
+void CLI_TxGetStats(TxStats* pStats, uint8_t clear)
+{
+  *pStats = Stats;
+  if( clear )
+  {
+    memset(&Stats, 0, sizeof(Stats));
+  }
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  TextOutput: put command line output of text mode in packet
+  * @param  pBuf: pointer of packet buffer
+  * @param  size: size of packet buffer
+  * @retval Length put
+  */
+static uint16_t TextOutput(uint8_t* pBuf, uint16_t size)
+{
+  uint16_t idx = 0;
+
+  while( idx < size )
+  {
+    uint16_t n;
+
+    if( TextLeft == 0 )
+    {
+      pText = CLI_Output();
+      if( pText == NULL || *pText == '\0' )
+      {
+        break;
+      }
+      TextLeft = (uint16_t)strlen((const char*)pText);
+    }
+
+    n = MIN(TextLeft, size - idx);
+    memcpy(&pBuf[idx], pText, n);
+    idx += n;
+    pText += n;
+    TextLeft -= n;
+  }
+  return idx;
+}
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+/**
+  * @brief  ClaimTx: take the endpoint, interrupts of other priorities may try at the same time
+  * @retval 1 if taken, 0 if a packet is being built or sent
+  */
+static uint8_t ClaimTx(void)
+{
+  do
+  {
+    if( __LDREXW(&TxClaimed) != 0 )
+    {
+      __CLREX();
+      return 0;
+    }
+  } while( __STREXW(1, &TxClaimed) != 0 );
+
+  __DMB();
+  return 1;
+}
+
+/**
+  * @brief  ReleaseTx: give the endpoint back
+  * @retval None
+  */
+static void ReleaseTx(void)
+{
+  __DMB();
+  TxClaimed = 0;
+}
+
+#else
+/* Host build (simulation) : same functions with compiler atomics */
+static uint8_t ClaimTx(void)
+{
+  uint32_t expected = 0;
+
+  return __atomic_compare_exchange_n(&TxClaimed, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) ? 1 : 0;
+}
+
+static void ReleaseTx(void)
+{
+  __atomic_store_n(&TxClaimed, 0, __ATOMIC_RELEASE);
+}
+#endif
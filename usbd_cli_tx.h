@@ -0,0 +1,47 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_tx.h
+  * @author  Katagiri
+  * @brief   Header file for USB command line's TX scheduler.
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CLI_TX_H
+#define __USBD_CLI_TX_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "usbd_cli_pool.h"
+
+/* Exported constants --------------------------------------------------------*/
+// size of a packet built by the scheduler (max packet size of bulk IN endpoint)
+#ifndef CLI_TX_PACKET_SIZE
+#define CLI_TX_PACKET_SIZE        CLI_POOL_PACKET_SIZE
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+// function starting transmission of a packet, returns 0 on success
+typedef uint8_t (*TxTransmitFxn)(uint8_t* pBuf, uint16_t length);
+
+// statistics of scheduler
+typedef struct
+{
+  uint32_t packets;         // packets sent (zero length packets included)
+  uint32_t zlps;            // zero length packets sent after a full packet
+  uint32_t controlBytes;    // bytes of command line output
+  uint32_t streamBytes;     // bytes of streams
+  uint32_t errors;          // packets failed to start or no TX block
+  uint32_t latencyLast;     // latency of the last reply [us]
+  uint32_t latencyMax;      // worst latency of reply [us]
+  uint32_t replies;         // number of latencies measured
+} TxStats;
+
+/* Exported functions ------------------------------------------------------- */
+void CLI_TxInit(TxTransmitFxn transmit);
+void CLI_TxStop(void);
+void CLI_TxKick(void);
+void CLI_TxRequest(void);
+void CLI_TxComplete(void);
+void CLI_TxGetStats(TxStats* pStats, uint8_t clear);
+
+#endif /* __USBD_CLI_TX_H */
@@ -0,0 +1,187 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_usbstat.c
+  * @author  Katagiri
+  * @brief   Source file for USB command line's USB statistics.
+  *          The callbacks of the low level driver (usbd_conf.c) count packets,
+  *          bytes, transfers, stalls and incomplete isochronous transfers of
+  *          each endpoint, and bus events (setup, SOF, reset, suspend ...).
+  *          All of them are counted in the USB interrupt, one writer only.
+  *          The driver reports whole transfers, so packets are counted from
+  *          the length and max packet size (a zero length packet is one).
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "usbd_cli_usbstat.h"
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+#include "stm32f4xx_hal.h"
+#else
+#include <time.h>
+#endif
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+#define EP_NUM(__ADDR__)          ((__ADDR__) & 0x7F)
+#define IS_EP_IN(__ADDR__)        (((__ADDR__) & CLI_USBSTAT_DIR_IN) != 0)
+
+/* Private function prototypes -----------------------------------------------*/
+static UsbEpStats* GetEndpoint(uint8_t epAddr);
+
+/* Private variables ---------------------------------------------------------*/
+static UsbEpStats InStats[CLI_USBSTAT_ENDPOINTS];
+static UsbEpStats OutStats[CLI_USBSTAT_ENDPOINTS];
+static UsbDevStats DevStats;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  CLI_UsbStatEvent: count a bus event
+  * @param  event: bus event
+  * @retval None
+  */
+void CLI_UsbStatEvent(UsbEvent event)
+{
+  if( CLI_NUM_OF_USB_EVENTS <= event )
+  {
+    return;
+  }
+  ++DevStats.events[event];
+  DevStats.lastTick[event] = CLI_UsbStatGetTick();
+}
+
+/**
+  * @brief  CLI_UsbStatTransfer: count a completed transfer
+  * @param  epAddr: endpoint address (bit 7 : IN)
+  * @param  length: length transferred
+  * @param  maxPacket: max packet size of endpoint
+  * @retval None
+  */
+void CLI_UsbStatTransfer(uint8_t epAddr, uint32_t length, uint16_t maxPacket)
+{
+  UsbEpStats *pEp = GetEndpoint(epAddr);
+
+  if( pEp == NULL )
+  {
+    return;
+  }
+  if( length == 0 || maxPacket == 0 )
+  {
+    ++pEp->packets;
+  }
+  else
+  {
+    pEp->packets += (length + maxPacket - 1) / maxPacket;
+  }
+  pEp->bytes += length;
+  ++pEp->transfers;
+  pEp->lastTick = CLI_UsbStatGetTick();
+}
+
+/**
+  * @brief  CLI_UsbStatStall: count a stall set on an endpoint
+  * @param  epAddr: endpoint address (bit 7 : IN)
+  * @retval None
+  */
+void CLI_UsbStatStall(uint8_t epAddr)
+{
+  UsbEpStats *pEp = GetEndpoint(epAddr);
+
+  if( pEp != NULL )
+  {
+    ++pEp->stalls;
+    pEp->lastTick = CLI_UsbStatGetTick();
+  }
+}
+
+/**
+  * @brief  CLI_UsbStatIsoIncomplete: count an incomplete isochronous transfer
+  * @param  epAddr: endpoint address (bit 7 : IN)
+  * @retval None
+  */
+void CLI_UsbStatIsoIncomplete(uint8_t epAddr)
+{
+  UsbEpStats *pEp = GetEndpoint(epAddr);
+
+  if( pEp != NULL )
+  {
+    ++pEp->isoIncomplete;
+    pEp->lastTick = CLI_UsbStatGetTick();
+  }
+}
+
+/**
+  * @brief  CLI_UsbStatGetEndpoint: get statistics of an endpoint.
+  *         Counting may go on while copying, fields are not a single snapshot.
+  * @param  epAddr: endpoint address (bit 7 : IN)
+  * @param  pStats: pointer of statistics
+  * @retval 1 if counted, 0 if out of range
+  */
+uint8_t CLI_UsbStatGetEndpoint(uint8_t epAddr, UsbEpStats* pStats)
+{
+  UsbEpStats *pEp = GetEndpoint(epAddr);
+
+  if( pEp == NULL )
+  {
+    return 0;
+  }
+  *pStats = *pEp;
+  return 1;
+}
+
+/**
+  * @brief  CLI_UsbStatGetDevice: get statistics of bus events
+  * @param  pStats: pointer of statistics
+  * @retval None
+  */
+void CLI_UsbStatGetDevice(UsbDevStats* pStats)
+{
+  *pStats = DevStats;
+}
+
+/**
+  * @brief  CLI_UsbStatClear: clear all statistics
+  * @retval None
+  */
+void CLI_UsbStatClear(void)
+{
+  memset(InStats, 0, sizeof(InStats));
+  memset(OutStats, 0, sizeof(OutStats));
+  memset(&DevStats, 0, sizeof(DevStats));
+}
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+/**
+  * @brief  CLI_UsbStatGetTick: time of activities
+  * @retval Time [ms]
+  */
+uint32_t CLI_UsbStatGetTick(void)
+{
+  return HAL_GetTick();
+}
+
+#else
+/* Host build (simulation) : host clock */
+uint32_t CLI_UsbStatGetTick(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+#endif
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  GetEndpoint: statistics of an endpoint
+  * @param  epAddr: endpoint address (bit 7 : IN)
+  * @retval Pointer of statistics, NULL if out of range
+  */
+static UsbEpStats* GetEndpoint(uint8_t epAddr)
+{
+  if( CLI_USBSTAT_ENDPOINTS <= EP_NUM(epAddr) )
+  {
+    return NULL;
+  }
+  return IS_EP_IN(epAddr) ? &InStats[EP_NUM(epAddr)] : &OutStats[EP_NUM(epAddr)];
+}
@@ -0,0 +1,66 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cli_usbstat.h
+  * @author  Katagiri
+  * @brief   Header file for USB command line's USB statistics.
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CLI_USBSTAT_H
+#define __USBD_CLI_USBSTAT_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+// number of endpoints counted in each direction (endpoint 0 included)
+#ifndef CLI_USBSTAT_ENDPOINTS
+#define CLI_USBSTAT_ENDPOINTS     6
+#endif
+
+// direction bit of endpoint address
+#define CLI_USBSTAT_DIR_IN        0x80
+
+/* Exported types ------------------------------------------------------------*/
+// bus events
+typedef enum
+{
+  CLI_USB_EVENT_SETUP = 0,
+  CLI_USB_EVENT_SOF,
+  CLI_USB_EVENT_RESET,
+  CLI_USB_EVENT_SUSPEND,
+  CLI_USB_EVENT_RESUME,
+  CLI_USB_EVENT_CONNECT,
+  CLI_USB_EVENT_DISCONNECT,
+  CLI_NUM_OF_USB_EVENTS
+} UsbEvent;
+
+// statistics of an endpoint
+typedef struct
+{
+  uint32_t packets;         // packets transferred (from length and max packet size)
+  uint32_t bytes;           // bytes transferred
+  uint32_t transfers;       // transfers completed
+  uint32_t stalls;          // stalls set
+  uint32_t isoIncomplete;   // incomplete isochronous transfers
+  uint32_t lastTick;        // time of the last activity [ms]
+} UsbEpStats;
+
+// statistics of device
+typedef struct
+{
+  uint32_t events[CLI_NUM_OF_USB_EVENTS];   // number of each bus event
+  uint32_t lastTick[CLI_NUM_OF_USB_EVENTS]; // time of the last one of each [ms]
+} UsbDevStats;
+
+/* Exported functions ------------------------------------------------------- */
+void CLI_UsbStatEvent(UsbEvent event);
+void CLI_UsbStatTransfer(uint8_t epAddr, uint32_t length, uint16_t maxPacket);
+void CLI_UsbStatStall(uint8_t epAddr);
+void CLI_UsbStatIsoIncomplete(uint8_t epAddr);
+uint8_t CLI_UsbStatGetEndpoint(uint8_t epAddr, UsbEpStats* pStats);
+void CLI_UsbStatGetDevice(UsbDevStats* pStats);
+void CLI_UsbStatClear(void);
+uint32_t CLI_UsbStatGetTick(void);
+
+#endif /* __USBD_CLI_USBSTAT_H */
@@ -45,6 +45,11 @@
 /* Includes ------------------------------------------------------------------*/
 #include "stm32f4xx_hal.h"
 #include "usbd_core.h"
+#include "usbd_cdc.h"
+#include "usbd_cli_tx.h"
+#include "usbd_cli_usbstat.h"
+#include "usbd_cli_enum.h"
+#include "usbd_cli_sync.h"
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
@@ -201,6 +206,8 @@ void HAL_PCD_MspDeInit(PCD_HandleTypeDef *hpcd)
   */
 void HAL_PCD_SetupStageCallback(PCD_HandleTypeDef *hpcd)
 {
+  CLI_UsbStatEvent(CLI_USB_EVENT_SETUP);
+  CLI_EnumTraceSetup((uint8_t *)hpcd->Setup);
   USBD_LL_SetupStage(hpcd->pData, (uint8_t *)hpcd->Setup);
 }
 
@@ -212,6 +219,11 @@ void HAL_PCD_SetupStageCallback(PCD_HandleTypeDef *hpcd)
   */
 void HAL_PCD_DataOutStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 {
+  CLI_UsbStatTransfer(epnum, hpcd->OUT_ep[epnum].xfer_count, hpcd->OUT_ep[epnum].maxpacket);
+  if(epnum == 0)
+  {
+    CLI_EnumTraceStage();
+  }
   USBD_LL_DataOutStage(hpcd->pData, epnum, hpcd->OUT_ep[epnum].xfer_buff);
 }
 
@@ -223,7 +235,18 @@ void HAL_PCD_DataOutStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
   */
 void HAL_PCD_DataInStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 {
+  CLI_UsbStatTransfer(epnum | 0x80, hpcd->IN_ep[epnum].xfer_count, hpcd->IN_ep[epnum].maxpacket);
+  if(epnum == 0)
+  {
+    CLI_EnumTraceStage();
+  }
   USBD_LL_DataInStage(hpcd->pData, epnum, hpcd->IN_ep[epnum].xfer_buff);
+  
+  /* Packet boundary of CDC data: TX scheduler sends the next packet */
+  if(epnum == (CDC_IN_EP & 0x7F))
+  {
+    CLI_TxComplete();
+  }
 }
 
 /**
@@ -233,6 +256,20 @@ void HAL_PCD_DataInStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
   */
 void HAL_PCD_SOFCallback(PCD_HandleTypeDef *hpcd)
 {
+  USB_OTG_GlobalTypeDef *USBx = hpcd->Instance;
+  uint32_t frame = (USBx_DEVICE->DSTS & USB_OTG_DSTS_FNSOF) >> 8;
+  
+  /* Local time of this frame for time synchronization with USB Host
+     (high speed : frame << 3 | microframe, the frame starts at microframe 0) */
+  if(hpcd->Init.speed != PCD_SPEED_HIGH)
+  {
+    CLI_SyncSof(frame);
+  }
+  else if((frame & 0x7) == 0)
+  {
+    CLI_SyncSof(frame >> 3);
+  }
+  CLI_UsbStatEvent(CLI_USB_EVENT_SOF);
   USBD_LL_SOF(hpcd->pData);
 }
 
@@ -245,6 +282,8 @@ void HAL_PCD_ResetCallback(PCD_HandleTypeDef *hpcd)
 { 
   USBD_SpeedTypeDef speed = USBD_SPEED_FULL;
 
+  CLI_UsbStatEvent(CLI_USB_EVENT_RESET);
+
   /* Set USB Current Speed */
   switch(hpcd->Init.speed)
   {
@@ -273,6 +312,7 @@ void HAL_PCD_ResetCallback(PCD_HandleTypeDef *hpcd)
   */
 void HAL_PCD_SuspendCallback(PCD_HandleTypeDef *hpcd)
 {
+  CLI_UsbStatEvent(CLI_USB_EVENT_SUSPEND);
   USBD_LL_Suspend(hpcd->pData);
 }
 
@@ -283,6 +323,7 @@ void HAL_PCD_SuspendCallback(PCD_HandleTypeDef *hpcd)
   */
 void HAL_PCD_ResumeCallback(PCD_HandleTypeDef *hpcd)
 {
+  CLI_UsbStatEvent(CLI_USB_EVENT_RESUME);
   USBD_LL_Resume(hpcd->pData);
 }
 
@@ -294,6 +335,7 @@ void HAL_PCD_ResumeCallback(PCD_HandleTypeDef *hpcd)
   */
 void HAL_PCD_ISOOUTIncompleteCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 {
+  CLI_UsbStatIsoIncomplete(epnum);
   USBD_LL_IsoOUTIncomplete(hpcd->pData, epnum);
 }
 
@@ -305,6 +347,7 @@ void HAL_PCD_ISOOUTIncompleteCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
   */
 void HAL_PCD_ISOINIncompleteCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 {
+  CLI_UsbStatIsoIncomplete(epnum | 0x80);
   USBD_LL_IsoINIncomplete(hpcd->pData, epnum);
 }
 
@@ -315,6 +358,7 @@ void HAL_PCD_ISOINIncompleteCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
   */
 void HAL_PCD_ConnectCallback(PCD_HandleTypeDef *hpcd)
 {
+  CLI_UsbStatEvent(CLI_USB_EVENT_CONNECT);
   USBD_LL_DevConnected(hpcd->pData);
 }
 
@@ -325,6 +369,7 @@ void HAL_PCD_ConnectCallback(PCD_HandleTypeDef *hpcd)
   */
 void HAL_PCD_DisconnectCallback(PCD_HandleTypeDef *hpcd)
 {
+  CLI_UsbStatEvent(CLI_USB_EVENT_DISCONNECT);
   USBD_LL_DevDisconnected(hpcd->pData);
 }
 
@@ -350,7 +395,7 @@ USBD_StatusTypeDef  USBD_LL_Init (USBD_HandleTypeDef *pdev)
   hpcd.Init.dma_enable = 0;
   hpcd.Init.low_power_enable = 0;
   hpcd.Init.phy_itface = PCD_PHY_EMBEDDED; 
-  hpcd.Init.Sof_enable = 0;
+  hpcd.Init.Sof_enable = 1;           /* SOF interrupt for time synchronization */
   hpcd.Init.speed = PCD_SPEED_FULL;
   hpcd.Init.vbus_sensing_enable = 1;
   /* Link The driver to the stack */
@@ -381,7 +426,7 @@ USBD_StatusTypeDef  USBD_LL_Init (USBD_HandleTypeDef *pdev)
   
   hpcd.Init.low_power_enable = 0;
   hpcd.Init.phy_itface = PCD_PHY_ULPI; 
-  hpcd.Init.Sof_enable = 0;
+  hpcd.Init.Sof_enable = 1;           /* SOF interrupt for time synchronization */
   hpcd.Init.speed = PCD_SPEED_HIGH;
   hpcd.Init.vbus_sensing_enable = 1;
   /* Link The driver to the stack */
@@ -481,6 +526,7 @@ USBD_StatusTypeDef USBD_LL_FlushEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
   */
 USBD_StatusTypeDef USBD_LL_StallEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)   
 {
+  CLI_UsbStatStall(ep_addr);
   HAL_PCD_EP_SetStall(pdev->pData, ep_addr);
   return USBD_OK; 
 }
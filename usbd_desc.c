@@ -46,6 +46,8 @@
 #include "usbd_core.h"
 #include "usbd_desc.h"
 #include "usbd_conf.h"
+#include "usbd_cli_enum.h"
+#include "usbd_cli_time.h"
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
@@ -61,6 +63,23 @@
 #define USBD_INTERFACE_FS_STRING      "VCP Interface"
 
 /* Private macro -------------------------------------------------------------*/
+/* String descriptor built at compile time from a string literal.
+   u"..." gives the UTF-16 code units, its terminating null is not stored.
+   u"" literals need a C11 compiler (e.g. -std=gnu11, IAR with C11 enabled). */
+#define USBD_STRING_DESC(__NAME__, __STRING__)  USBD_STRING_DESC_(__NAME__, __STRING__)
+#define USBD_STRING_DESC_(__NAME__, __STRING__)                               \
+  __ALIGN_BEGIN static const struct                                           \
+  {                                                                           \
+    uint8_t  bLength;                                                         \
+    uint8_t  bDescriptorType;                                                 \
+    uint16_t wString[sizeof(u##__STRING__) / 2 - 1];                          \
+  } __NAME__ __ALIGN_END =                                                    \
+  {                                                                           \
+    sizeof(u##__STRING__),      /* 2 + 2 * number of characters */            \
+    USB_DESC_TYPE_STRING,                                                     \
+    u##__STRING__                                                             \
+  }
+
 /* Private function prototypes -----------------------------------------------*/
 uint8_t *USBD_VCP_DeviceDescriptor(USBD_SpeedTypeDef speed, uint16_t *length);
 uint8_t *USBD_VCP_LangIDStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length);
@@ -120,16 +139,44 @@ __ALIGN_BEGIN uint8_t USBD_LangIDDesc[USB_LEN_LANGID_STR_DESC] __ALIGN_END = {
   HIBYTE(USBD_LANGID_STRING), 
 };
 
-uint8_t USBD_StringSerial[USB_SIZ_STRING_SERIAL] =
+#if defined ( __ICCARM__ ) /*!< IAR Compiler */
+  #pragma data_alignment=4   
+#endif
+__ALIGN_BEGIN uint8_t USBD_StringSerial[USB_SIZ_STRING_SERIAL] __ALIGN_END =
 {
   USB_SIZ_STRING_SERIAL,      
   USB_DESC_TYPE_STRING,    
 };
 
+/* USB String Descriptors (constant, sent directly from flash) */
 #if defined ( __ICCARM__ ) /*!< IAR Compiler */
   #pragma data_alignment=4   
 #endif
-__ALIGN_BEGIN uint8_t USBD_StrDesc[USBD_MAX_STR_DESC_SIZ] __ALIGN_END;
+USBD_STRING_DESC(USBD_ManufacturerStrDesc, USBD_MANUFACTURER_STRING);
+#if defined ( __ICCARM__ ) /*!< IAR Compiler */
+  #pragma data_alignment=4   
+#endif
+USBD_STRING_DESC(USBD_ProductHSStrDesc, USBD_PRODUCT_HS_STRING);
+#if defined ( __ICCARM__ ) /*!< IAR Compiler */
+  #pragma data_alignment=4   
+#endif
+USBD_STRING_DESC(USBD_ProductFSStrDesc, USBD_PRODUCT_FS_STRING);
+#if defined ( __ICCARM__ ) /*!< IAR Compiler */
+  #pragma data_alignment=4   
+#endif
+USBD_STRING_DESC(USBD_ConfigHSStrDesc, USBD_CONFIGURATION_HS_STRING);
+#if defined ( __ICCARM__ ) /*!< IAR Compiler */
+  #pragma data_alignment=4   
+#endif
+USBD_STRING_DESC(USBD_ConfigFSStrDesc, USBD_CONFIGURATION_FS_STRING);
+#if defined ( __ICCARM__ ) /*!< IAR Compiler */
+  #pragma data_alignment=4   
+#endif
+USBD_STRING_DESC(USBD_InterfaceHSStrDesc, USBD_INTERFACE_HS_STRING);
+#if defined ( __ICCARM__ ) /*!< IAR Compiler */
+  #pragma data_alignment=4   
+#endif
+USBD_STRING_DESC(USBD_InterfaceFSStrDesc, USBD_INTERFACE_FS_STRING);
 
 /* Private functions ---------------------------------------------------------*/
 static void IntToUnicode (uint32_t value , uint8_t *pbuf , uint8_t len);
@@ -143,7 +190,11 @@ static void Get_SerialNum(void);
   */
 uint8_t *USBD_VCP_DeviceDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
 {
+  uint32_t start = CLI_TimeNow32();
+  
   *length = sizeof(USBD_DeviceDesc);
+  
+  CLI_EnumTraceDescriptor(start);
   return (uint8_t*)USBD_DeviceDesc;
 }
 
@@ -155,7 +206,11 @@ uint8_t *USBD_VCP_DeviceDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
   */
 uint8_t *USBD_VCP_LangIDStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
 {
+  uint32_t start = CLI_TimeNow32();
+  
   *length = sizeof(USBD_LangIDDesc);  
+  
+  CLI_EnumTraceDescriptor(start);
   return (uint8_t*)USBD_LangIDDesc;
 }
 
@@ -167,15 +222,22 @@ uint8_t *USBD_VCP_LangIDStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
   */
 uint8_t *USBD_VCP_ProductStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
 {
-  if(speed == 0)
-  {   
-    USBD_GetString((uint8_t *)USBD_PRODUCT_HS_STRING, USBD_StrDesc, length);
+  uint32_t start = CLI_TimeNow32();
+  uint8_t *pDesc;
+  
+  if(speed == USBD_SPEED_HIGH)
+  {
+    *length = sizeof(USBD_ProductHSStrDesc);
+    pDesc = (uint8_t*)&USBD_ProductHSStrDesc;
   }
   else
   {
-    USBD_GetString((uint8_t *)USBD_PRODUCT_FS_STRING, USBD_StrDesc, length);    
+    *length = sizeof(USBD_ProductFSStrDesc);
+    pDesc = (uint8_t*)&USBD_ProductFSStrDesc;
   }
-  return USBD_StrDesc;
+  
+  CLI_EnumTraceDescriptor(start);
+  return pDesc;
 }
 
 /**
@@ -186,8 +248,12 @@ uint8_t *USBD_VCP_ProductStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length
   */
 uint8_t *USBD_VCP_ManufacturerStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
 {
-  USBD_GetString((uint8_t *)USBD_MANUFACTURER_STRING, USBD_StrDesc, length);
-  return USBD_StrDesc;
+  uint32_t start = CLI_TimeNow32();
+  
+  *length = sizeof(USBD_ManufacturerStrDesc);
+  
+  CLI_EnumTraceDescriptor(start);
+  return (uint8_t*)&USBD_ManufacturerStrDesc;
 }
 
 /**
@@ -198,11 +264,11 @@ uint8_t *USBD_VCP_ManufacturerStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *l
   */
 uint8_t *USBD_VCP_SerialStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
 {
-  *length = USB_SIZ_STRING_SERIAL;
+  uint32_t start = CLI_TimeNow32();
   
-  /* Update the serial number string descriptor with the data from the unique ID*/
-  Get_SerialNum();
+  *length = USB_SIZ_STRING_SERIAL;
   
+  CLI_EnumTraceDescriptor(start);
   return (uint8_t*)USBD_StringSerial;
 }
 
@@ -214,15 +280,22 @@ uint8_t *USBD_VCP_SerialStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
   */
 uint8_t *USBD_VCP_ConfigStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
 {
+  uint32_t start = CLI_TimeNow32();
+  uint8_t *pDesc;
+  
   if(speed == USBD_SPEED_HIGH)
-  {  
-    USBD_GetString((uint8_t *)USBD_CONFIGURATION_HS_STRING, USBD_StrDesc, length);
+  {
+    *length = sizeof(USBD_ConfigHSStrDesc);
+    pDesc = (uint8_t*)&USBD_ConfigHSStrDesc;
   }
   else
   {
-    USBD_GetString((uint8_t *)USBD_CONFIGURATION_FS_STRING, USBD_StrDesc, length); 
+    *length = sizeof(USBD_ConfigFSStrDesc);
+    pDesc = (uint8_t*)&USBD_ConfigFSStrDesc;
   }
-  return USBD_StrDesc;  
+  
+  CLI_EnumTraceDescriptor(start);
+  return pDesc;
 }
 
 /**
@@ -233,15 +306,33 @@ uint8_t *USBD_VCP_ConfigStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
   */
 uint8_t *USBD_VCP_InterfaceStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
 {
-  if(speed == 0)
+  uint32_t start = CLI_TimeNow32();
+  uint8_t *pDesc;
+  
+  if(speed == USBD_SPEED_HIGH)
   {
-    USBD_GetString((uint8_t *)USBD_INTERFACE_HS_STRING, USBD_StrDesc, length);
+    *length = sizeof(USBD_InterfaceHSStrDesc);
+    pDesc = (uint8_t*)&USBD_InterfaceHSStrDesc;
   }
   else
   {
-    USBD_GetString((uint8_t *)USBD_INTERFACE_FS_STRING, USBD_StrDesc, length);
+    *length = sizeof(USBD_InterfaceFSStrDesc);
+    pDesc = (uint8_t*)&USBD_InterfaceFSStrDesc;
   }
-  return USBD_StrDesc;  
+  
+  CLI_EnumTraceDescriptor(start);
+  return pDesc;
+}
+
+/**
+  * @brief  Build the serial number string descriptor from the unique ID once
+  *         at startup (before USBD_Init), the ID never changes.
+  * @param  None
+  * @retval None
+  */
+void USBD_VCP_SerialInit(void)
+{
+  Get_SerialNum();
 }
 
 /**